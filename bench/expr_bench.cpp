@@ -0,0 +1,56 @@
+// Expression parse/codegen benchmark.
+//
+//   expr_bench [-depth N] [-width N]
+//
+// Builds one function holding a parenthesised expression nested N levels
+// deep (default 2000) and `width` flat Let statements (default 20000) that
+// mix every binary operator. Reports parse and codegen time separately.
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static const char *Ops[] = {"+", "-", "*", "/", "<", "<=", ">", ">=", "==", "!="};
+
+static std::string makeSource(int depth, int width) {
+    std::string src = "Func Kernel(a, b)\n    Let deep = ";
+    for (int i = 0; i < depth; i++) src += "(a " + std::string(Ops[i % 10]) + " ";
+    src += "b";
+    for (int i = 0; i < depth; i++) src += ")";
+    src += "\n";
+    for (int i = 0; i < width; i++) {
+        src += "    Let v" + std::to_string(i) + " = a";
+        for (int j = 0; j < 10; j++)
+            src += " " + std::string(Ops[(i + j) % 10]) + " b * " + std::to_string(j + 1);
+        src += "\n";
+    }
+    src += "    Return deep\nEnd\n";
+    return src;
+}
+
+int main(int argc, char **argv) {
+    int depth = 2000, width = 20000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-depth" && i + 1 < argc) depth = std::atoi(argv[++i]);
+        else if (arg == "-width" && i + 1 < argc) width = std::atoi(argv[++i]);
+    }
+
+    std::string source = makeSource(depth, width);
+
+    auto t0 = std::chrono::steady_clock::now();
+    Lexer lex(source.data(), source.data() + source.size());
+    Parser parser(lex);
+    ProgramAST program = parser.parseProgram();
+    auto t1 = std::chrono::steady_clock::now();
+    program.codegen();
+    auto t2 = std::chrono::steady_clock::now();
+
+    std::cout << "input:    " << source.size() << " bytes (depth " << depth
+              << ", " << width << " flat statements)\n";
+    std::cout << "parse:    " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+    std::cout << "codegen:  " << std::chrono::duration<double, std::milli>(t2 - t1).count() << " ms\n";
+    return 0;
+}
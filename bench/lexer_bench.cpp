@@ -0,0 +1,94 @@
+// Lexer throughput micro-benchmark.
+//
+//   lexer_bench [file.strict] [-mb N] [-iters N] [-stream]
+//
+// Without a file, lexes a synthetic program of roughly N MB (default 16)
+// shaped like our machine-generated sources. A file is memory-mapped, as
+// strictc does. -stream feeds the input through the chunked istream mode
+// instead. Reports tokens and MB/s.
+#include "lexer.hpp"
+#include "source.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static std::string makeSource(size_t bytes) {
+    std::string src;
+    src.reserve(bytes + 256);
+    for (size_t i = 0; src.size() < bytes; i++) {
+        std::string n = std::to_string(i);
+        src += "-- generated unit " + n + "\n";
+        src += "Func Compute_" + n + "(alpha, beta, gamma)\n";
+        src += "    Let total_" + n + " = alpha * 31 + beta / 7 - gamma\n";
+        src += "    If total_" + n + " >= 1000 Then\n";
+        src += "        Print \"overflow in unit " + n + "\"\n";
+        src += "    Else\n";
+        src += "        total_" + n + " = total_" + n + " + " + n + "\n";
+        src += "    End\n";
+        src += "    For i = 0..(alpha + 16) Then\n";
+        src += "        total_" + n + " = total_" + n + " + i\n";
+        src += "    End\n";
+        src += "    Return total_" + n + "\n";
+        src += "End\n\n";
+    }
+    return src;
+}
+
+int main(int argc, char **argv) {
+    std::string file;
+    size_t mb = 16;
+    int iters = 5;
+    bool streaming = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-mb" && i + 1 < argc) mb = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "-iters" && i + 1 < argc) iters = std::atoi(argv[++i]);
+        else if (arg == "-stream") streaming = true;
+        else file = arg;
+    }
+
+    std::string generated;
+    SourceFile mapped;
+    const char *begin, *end;
+    if (!file.empty()) {
+        if (!mapped.open(file)) {
+            std::cerr << "Error: cannot map " << file << "\n";
+            return 1;
+        }
+        begin = mapped.begin();
+        end = mapped.end();
+    } else {
+        generated = makeSource(mb << 20);
+        begin = generated.data();
+        end = begin + generated.size();
+    }
+    size_t bytes = end - begin;
+
+    double best = 0;
+    size_t tokens = 0;
+    for (int it = 0; it < iters; it++) {
+        auto t0 = std::chrono::steady_clock::now();
+        size_t count = 0;
+        if (streaming) {
+            std::istringstream in(std::string(begin, end));
+            t0 = std::chrono::steady_clock::now();
+            Lexer lex(in);
+            while (lex.nextToken().type != TOK_EOF) count++;
+        } else {
+            Lexer lex(begin, end);
+            while (lex.nextToken().type != TOK_EOF) count++;
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+        double mbps = (bytes / 1048576.0) / secs;
+        if (mbps > best) best = mbps;
+        tokens = count;
+    }
+
+    std::cout << "input:      " << bytes << " bytes\n";
+    std::cout << "tokens:     " << tokens << "\n";
+    std::cout << "throughput: " << best << " MB/s (best of " << iters << ")\n";
+    return 0;
+}
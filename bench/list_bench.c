@@ -0,0 +1,86 @@
+// StrictList allocation benchmark.
+//
+//   list_bench [-lists N] [-max N]
+//
+// Builds N short lists (default 2000000) of 0..max elements (default 12,
+// lengths cycling), the way generated programs do: once by appending one
+// element at a time, once with a reserve up front, once by bulk-appending.
+// The runtime is built with counting allocators (see STRICT_MALLOC in
+// runtime.c); reports allocator calls per list and ns per list.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct StrictList StrictList;
+StrictList* __list_new(void);
+void __list_free(StrictList *list);
+void __list_reserve(StrictList *list, size_t count);
+void __list_append(StrictList *list, int value);
+void __list_append_bulk(StrictList *list, const int *values, size_t count);
+size_t __list_size(StrictList *list);
+
+static size_t Allocs, Reallocs;
+
+void *bench_malloc(size_t size) {
+    Allocs++;
+    return malloc(size);
+}
+
+void *bench_realloc(void *p, size_t size) {
+    Reallocs++;
+    return realloc(p, size);
+}
+
+void bench_free(void *p) {
+    free(p);
+}
+
+static double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+enum Mode { Append, Reserve, Bulk };
+
+static void run(const char *label, enum Mode mode, int lists, int max) {
+    int values[256];
+    for (int i = 0; i < 256; i++) values[i] = i * 7;
+    Allocs = Reallocs = 0;
+    size_t total = 0;
+    double t0 = now();
+    for (int i = 0; i < lists; i++) {
+        int length = i % (max + 1);
+        StrictList *list = __list_new();
+        if (mode == Bulk) {
+            __list_append_bulk(list, values, (size_t)length);
+        } else {
+            if (mode == Reserve) __list_reserve(list, (size_t)length);
+            for (int k = 0; k < length; k++) __list_append(list, values[k]);
+        }
+        total += __list_size(list);
+        __list_free(list);
+    }
+    double t = now() - t0;
+    printf("%-8s  %9.3f  %9.3f  %9.1f  (%zu elements)\n", label, (double)Allocs / lists,
+           (double)Reallocs / lists, t * 1e9 / lists, total);
+}
+
+int main(int argc, char **argv) {
+    int lists = 2000000, max = 12;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-lists")) lists = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-max")) max = atoi(argv[i + 1]);
+    }
+    if (lists < 1 || max < 0 || max > 256) {
+        fprintf(stderr, "usage: list_bench [-lists N] [-max 0..256]\n");
+        return 1;
+    }
+    printf("%d lists of 0..%d elements\n", lists, max);
+    printf("mode      mallocs/l  reallocs/l  ns/list\n");
+    run("append", Append, lists, max);
+    run("reserve", Reserve, lists, max);
+    run("bulk", Bulk, lists, max);
+    return 0;
+}
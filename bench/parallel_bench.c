@@ -0,0 +1,90 @@
+// Parallel For scaling benchmark.
+//
+//   parallel_bench [-n N] [-work N] [-threads N]
+//
+// Runs the same loop through __parallel_for, as a `Parallel For` compiles
+// to, with the runtime pool restarted at 1, 2, ... up to N threads
+// (default: one per core). Every iteration spins `work` rounds of an
+// integer hash (default 64) and stores the result, so the loop is compute
+// bound. Reports time and speedup over one thread, and checks every run
+// against the single-threaded result.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+void __parallel_for(int start, int end, void (*body)(void *env, int lo, int hi), void *env);
+void __parallel_set_threads(int workers);
+
+typedef struct {
+    int *out;
+    int work;
+} Kernel;
+
+static void kernel(void *env, int lo, int hi) {
+    Kernel *k = (Kernel*)env;
+    for (int i = lo; i <= hi; i++) {
+        unsigned h = (unsigned)i;
+        for (int r = 0; r < k->work; r++) h = (h ^ (h >> 15)) * 2246822519u + (unsigned)r;
+        k->out[i] = (int)h;
+    }
+}
+
+static double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int cores(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+int main(int argc, char **argv) {
+    int n = 10000000, work = 64, maxThreads = cores();
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "-n")) n = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-work")) work = atoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "-threads")) maxThreads = atoi(argv[i + 1]);
+    }
+    if (n < 1 || maxThreads < 1) {
+        fprintf(stderr, "usage: parallel_bench [-n N] [-work N] [-threads N]\n");
+        return 1;
+    }
+
+    int *expected = (int*)malloc((size_t)n * sizeof(int));
+    Kernel k = {(int*)malloc((size_t)n * sizeof(int)), work};
+    double base = 0;
+    printf("%d iterations x %d rounds\n", n, work);
+    printf("threads     time(s)   speedup\n");
+    for (int threads = 1; threads <= maxThreads; threads++) {
+        __parallel_set_threads(threads);
+        memset(k.out, 0, (size_t)n * sizeof(int));
+        double t0 = now();
+        __parallel_for(0, n - 1, kernel, &k);
+        double t = now() - t0;
+        if (threads == 1) {
+            base = t;
+            memcpy(expected, k.out, (size_t)n * sizeof(int));
+        } else if (memcmp(expected, k.out, (size_t)n * sizeof(int)) != 0) {
+            fprintf(stderr, "mismatch at %d threads\n", threads);
+            return 1;
+        }
+        printf("%7d  %10.4f  %8.2fx\n", threads, t, base / t);
+    }
+    free(expected);
+    free(k.out);
+    return 0;
+}
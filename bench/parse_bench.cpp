@@ -0,0 +1,72 @@
+// Parser time / peak memory benchmark.
+//
+//   parse_bench [-nodes N]
+//
+// Generates a synthetic program with roughly N AST nodes (default 1M):
+// functions full of arithmetic Let/If statements. Reports parse time and
+// the process's peak RSS after parsing.
+#include "lexer.hpp"
+#include "parser.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Each Let below is 14 nodes and each If 8 (counting its two Prints).
+static std::string makeSource(size_t nodes) {
+    std::string src;
+    size_t count = 0;
+    for (size_t f = 0; count < nodes; f++) {
+        std::string fn = std::to_string(f);
+        src += "Func Unit_" + fn + "(alpha, beta, gamma)\n";
+        count++;
+        for (int i = 0; i < 100 && count < nodes; i++) {
+            std::string v = "v" + std::to_string(i);
+            src += "    Let " + v + " = alpha * 3 + beta - (gamma / 2) * alpha + " + std::to_string(i) + "\n";
+            src += "    If " + v + " > beta Print \"big\" Else Print \"small\" End\n";
+            count += 22;
+        }
+        src += "    Return alpha\nEnd\n";
+        count += 2;
+    }
+    return src;
+}
+
+static long peakRSSKiB() {
+#ifndef _WIN32
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+int main(int argc, char **argv) {
+    size_t nodes = 1000000;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-nodes" && i + 1 < argc) nodes = std::strtoul(argv[++i], nullptr, 10);
+    }
+
+    std::string source = makeSource(nodes);
+    long rssBefore = peakRSSKiB();
+
+    auto t0 = std::chrono::steady_clock::now();
+    Lexer lex(source.data(), source.data() + source.size());
+    Parser parser(lex);
+    ProgramAST program = parser.parseProgram();
+    auto t1 = std::chrono::steady_clock::now();
+
+    std::cout << "input:       " << source.size() << " bytes, ~" << nodes << " nodes\n";
+    std::cout << "statements:  " << program.statements.size() << "\n";
+    std::cout << "symbols:     " << program.symbols.size() << "\n";
+    std::cout << "arena:       " << program.arena.bytesUsed() / 1024 << " KiB used, "
+              << program.arena.bytesReserved() / 1024 << " KiB reserved\n";
+    std::cout << "parse time:  " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+    std::cout << "peak RSS:    " << peakRSSKiB() << " KiB (" << rssBefore << " KiB before parsing)\n";
+    return 0;
+}
@@ -0,0 +1,66 @@
+// Print throughput benchmark.
+//
+//   print_bench [-lines N] > /dev/null
+//
+// Writes N lines (default 5000000) to stdout per mode: the old `puts`
+// path, strict_print (strlen), strict_print_str (known length, as
+// literals compile to), and integers through printf("%d\n") and through
+// strict_print_i32. Reports million lines per second on stderr; redirect
+// stdout to a file or /dev/null.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void strict_print(const char *s);
+void strict_print_str(const char *s, int len);
+void strict_print_i32(int value);
+void strict_flush(void);
+
+static const char Line[] = "The quick brown fox jumps over the lazy dog";
+
+static double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *label, int lines, double t) {
+    fprintf(stderr, "%-18s %8.3f s  %8.2f M lines/s\n", label, t, lines / t / 1e6);
+}
+
+int main(int argc, char **argv) {
+    int lines = 5000000;
+    for (int i = 1; i + 1 < argc; i += 2)
+        if (!strcmp(argv[i], "-lines")) lines = atoi(argv[i + 1]);
+    if (lines < 1) {
+        fprintf(stderr, "usage: print_bench [-lines N] > /dev/null\n");
+        return 1;
+    }
+
+    double t0 = now();
+    for (int i = 0; i < lines; i++) puts(Line);
+    fflush(stdout);
+    report("puts", lines, now() - t0);
+
+    t0 = now();
+    for (int i = 0; i < lines; i++) strict_print(Line);
+    strict_flush();
+    report("strict_print", lines, now() - t0);
+
+    t0 = now();
+    for (int i = 0; i < lines; i++) strict_print_str(Line, (int)sizeof(Line) - 1);
+    strict_flush();
+    report("strict_print_str", lines, now() - t0);
+
+    t0 = now();
+    for (int i = 0; i < lines; i++) printf("%d\n", (int)((unsigned)i * 7919u));
+    fflush(stdout);
+    report("printf %d", lines, now() - t0);
+
+    t0 = now();
+    for (int i = 0; i < lines; i++) strict_print_i32((int)((unsigned)i * 7919u));
+    strict_flush();
+    report("strict_print_i32", lines, now() - t0);
+    return 0;
+}
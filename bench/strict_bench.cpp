@@ -0,0 +1,386 @@
+// Compiler benchmark suite.
+//
+//   strict_bench [-filter S] [-repeat N] [-scale F] [-json FILE] [-baseline FILE]
+//
+// Generates synthetic programs — one expression nested deep, 10k small
+// functions, a long Match chain, nested loops — and times each compiler
+// stage over each of them: lexing, parsing, codegen, the -O2 pipeline
+// (the DGM backend's, as strictc runs it by default), DGM translation and
+// NASM emission. Then it runs compiled programs through the JIT at -O2
+// (the time includes the JIT's own compile, a few ms against runs of
+// 100 ms and up), and the call-heavy ones again built with --profile's
+// instrumentation, to keep its overhead in view. Every benchmark runs
+// `repeat` times (default 5) after its setup; the median and the minimum
+// are reported, with throughput. -scale multiplies every program's size.
+// -filter keeps benchmarks whose name contains S. -json writes the
+// results, one benchmark per line, and -baseline reads such a file back
+// and shows each median against it.
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "codegen.hpp"
+#include "dgm.hpp"
+#include "jit.hpp"
+#include "native.hpp"
+#include "optimizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/Target/TargetMachine.h>
+
+// --- Synthetic programs ---
+
+static const char *Ops[] = {"+", "-", "*", "<", "<=", ">", ">=", "==", "!="};
+
+// One expression nested `depth` parentheses deep, `count` times over
+static std::string deepExpr(int depth, int count) {
+    std::string src;
+    for (int f = 0; f < count; f++) {
+        src += "Func Deep_" + std::to_string(f) + "(a, b)\n    Return ";
+        for (int i = 0; i < depth; i++) src += "(a " + std::string(Ops[i % 9]) + " ";
+        src += "b";
+        src += std::string(size_t(depth), ')');
+        src += "\nEnd\n";
+    }
+    return src + "Return Deep_0(3, 4)\n";
+}
+
+// `count` small functions, each calling the next-but-nine one, so the
+// inliner has work but no chain through all of them
+static std::string manyFuncs(int count) {
+    std::string src;
+    for (int f = 0; f < count; f++) {
+        std::string n = std::to_string(f);
+        src += "Func F_" + n + "(x, y)\n";
+        src += "    Let t = x * " + std::to_string(f % 13 + 1) + " + y\n";
+        src += "    If t > 1000\n        t = t - 1000\n    End\n";
+        if (f % 10 != 9 && f + 9 < count) src += "    t = t + F_" + std::to_string(f + 9) + "(y, 1)\n";
+        src += "    Return t\nEnd\n";
+    }
+    return src + "Return F_0(1, 2)\n";
+}
+
+// One Match over `cases` integer and range cases, and a loop driving it
+static std::string matchChain(int cases, int iterations) {
+    std::string src = "Func Classify(x)\n    Let r = 0\n    Match x\n";
+    for (int c = 0; c < cases; c++) {
+        if (c % 4 == 3) {
+            int low = cases + c * 10;
+            src += "        Case " + std::to_string(low) + ".." + std::to_string(low + 9) +
+                   ": r = " + std::to_string(c) + "\n";
+        } else {
+            src += "        Case " + std::to_string(c * 3) + ": r = " + std::to_string(c % 17) + "\n";
+        }
+    }
+    src += "        Case *: r = 1\n    End\n    Return r\nEnd\n";
+    src += "Let s = 0\nFor i = 0.." + std::to_string(iterations - 1) + "\n";
+    src += "    s = s + Classify(i / 7)\nEnd\nReturn s / 1000\n";
+    return src;
+}
+
+// Nested counted loops over scalar arithmetic
+static std::string bigLoop(int outer, int inner) {
+    return "Func Mix(n)\n"
+           "    Let s = 0\n"
+           "    For i = 0..n\n"
+           "        s = s + (i * i) / 7 + i\n"
+           "        If s > 100000\n            s = s - 99991\n        End\n"
+           "    End\n"
+           "    Return s\n"
+           "End\n"
+           "Let total = 0\n"
+           "For k = 1.." + std::to_string(outer) + "\n"
+           "    total = total + Mix(" + std::to_string(inner) + " + k)\n"
+           "    If total > 1000000\n        total = total - 999983\n    End\n"
+           "End\n"
+           "Return total / 1000\n";
+}
+
+// Array kernel: builtins, checked and unchecked element access
+static std::string arrayKernel(int length, int rounds) {
+    std::string n = std::to_string(length);
+    return "Let a = Array(" + n + ")\n"
+           "Let total = 0\n"
+           "For r = 1.." + std::to_string(rounds) + "\n"
+           "    For i = 0..Size(a) - 1\n"
+           "        Set(a, i, Get(a, i) + i * r)\n"
+           "    End\n"
+           "    total = total + Sum(a) / 1000\n"
+           "    AddEach(a, 0 - r)\n"
+           "End\n"
+           "Return total / 1000\n";
+}
+
+static std::string fib(int n) {
+    return "Func Fib(n)\n"
+           "    If n < 2\n        Return n\n    End\n"
+           "    Return Fib(n - 1) + Fib(n - 2)\n"
+           "End\n"
+           "Return Fib(" + std::to_string(n) + ") / 1000\n";
+}
+
+struct Program {
+    const char *name;
+    std::string source;
+};
+
+// --- Harness ---
+
+struct Result {
+    std::string name;
+    unsigned repeat;
+    double medianMs;
+    double minMs;
+    double items;               // per run, in `unit`
+    const char *unit;
+};
+
+static double nowMs() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+struct Suite {
+    std::string filter;
+    unsigned repeat = 5;
+    std::vector<Result> results;
+
+    bool wanted(const std::string &name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    // `setup` runs untimed before every timed `body`
+    void run(const std::string &name, double items, const char *unit,
+             const std::function<void()> &setup, const std::function<void()> &body) {
+        if (!wanted(name)) return;
+        std::vector<double> times;
+        for (unsigned r = 0; r < repeat; r++) {
+            setup();
+            double t0 = nowMs();
+            body();
+            times.push_back(nowMs() - t0);
+        }
+        std::sort(times.begin(), times.end());
+        Result result{name, repeat, times[times.size() / 2], times[0], items, unit};
+        results.push_back(result);
+        print(result);
+    }
+
+    static void print(const Result &r) {
+        std::cout << std::left << std::setw(28) << r.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(12) << r.medianMs << std::setw(12) << r.minMs;
+        if (r.items > 0 && r.medianMs > 0)
+            std::cout << std::setw(12) << std::setprecision(2) << r.items / r.medianMs / 1e3
+                      << " M " << r.unit << "/s";
+        std::cout << "\n";
+    }
+};
+
+static ProgramAST parse(const std::string &source, size_t *tokens = nullptr) {
+    Lexer lex(source.data(), source.data() + source.size());
+    Parser parser(lex);
+    ProgramAST program = parser.parseProgram();
+    if (tokens) *tokens = parser.tokenCount();
+    return program;
+}
+
+// Parses, generates and runs the -O2 DGM pipeline, as strictc would
+static bool lowerForDGM(ProgramAST &program, llvm::TargetMachine &TM) {
+    program.codegen();
+    llvm::Module &M = *program.getModule();
+    configureModuleForTarget(M, TM);
+    std::string err;
+    return optimizeModule(M, 2, err, &TM, true);
+}
+
+static void compileBenchmarks(Suite &suite, const Program &p, llvm::TargetMachine &TM,
+                              const std::string &dir) {
+    const std::string &src = p.source;
+    std::string prefix = std::string(p.name) + "/";
+    double bytes = double(src.size());
+    auto none = [] {};
+
+    size_t tokens = 0;
+    parse(src, &tokens);
+    suite.run(prefix + "lex", double(tokens), "tokens", none, [&] {
+        Lexer lex(src.data(), src.data() + src.size());
+        while (lex.nextToken().type != TOK_EOF) {}
+    });
+    suite.run(prefix + "parse", bytes, "bytes", none, [&] { parse(src); });
+
+    ProgramAST program;
+    suite.run(prefix + "codegen", double(tokens), "tokens",
+              [&] { program = parse(src); }, [&] { program.codegen(); });
+    suite.run(prefix + "optimize", double(tokens), "tokens",
+              [&] {
+                  program = parse(src);
+                  program.codegen();
+                  configureModuleForTarget(*program.getModule(), TM);
+              },
+              [&] {
+                  std::string err;
+                  optimizeModule(*program.getModule(), 2, err, &TM, true);
+              });
+
+    std::string dgmFile = dir + "/" + p.name + ".dgm";
+    std::string nasmFile = dir + "/" + p.name + ".s";
+    bool lowered = false;
+    auto lower = [&] {
+        if (lowered) return;
+        program = parse(src);
+        lowered = lowerForDGM(program, TM);
+    };
+    auto translate = [&] {
+        std::string err;
+        if (lowered) translateModuleToDGM(*program.getModule(), dgmFile, err, 1);
+    };
+    suite.run(prefix + "dgm_translate", double(tokens), "tokens", lower, translate);
+    suite.run(prefix + "nasm_emit", double(tokens), "tokens",
+              [&] {
+                  if (!lowered) {
+                      lower();
+                      translate();
+                  }
+              },
+              [&] {
+                  std::string err;
+                  if (lowered) emitDGMtoNASM(dgmFile, nasmFile, err, 1);
+              });
+}
+
+static void runBenchmark(Suite &suite, const Program &p, llvm::TargetMachine &TM, bool profile) {
+    std::string name = std::string("run/") + p.name + (profile ? "+profile" : "");
+    ProgramAST program;
+    std::unique_ptr<llvm::Module> module;
+    std::unique_ptr<llvm::LLVMContext> context;
+    suite.run(name, 0, "", [&] {
+        program = parse(p.source);
+        program.codegen();
+        if (profile) instrumentProfile(*program.getModule());
+        configureModuleForTarget(*program.getModule(), TM);
+        std::string err;
+        optimizeModule(*program.getModule(), 2, err, &TM);
+        module = program.takeModule(context);
+    }, [&] {
+        std::string err;
+        runJIT(std::move(module), std::move(context), 2, err);
+        if (!err.empty()) std::cerr << name << ": " << err << "\n";
+    });
+}
+
+// --- Results files ---
+
+static void writeJSON(const std::vector<Result> &results, unsigned repeat, double scale,
+                      std::ostream &out) {
+    out << "{\n  \"repeat\": " << repeat << ",\n  \"scale\": " << scale << ",\n  \"benchmarks\": [\n";
+    out << std::fixed << std::setprecision(4);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"median_ms\": " << r.medianMs
+            << ", \"min_ms\": " << r.minMs << ", \"items\": " << std::setprecision(0) << r.items
+            << std::setprecision(4) << ", \"unit\": \"" << r.unit << "\"}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// Reads back what writeJSON wrote: name -> median
+static std::map<std::string, double> readBaseline(const std::string &path) {
+    std::map<std::string, double> medians;
+    std::ifstream in(path);
+    std::string line;
+    const std::string nameKey = "\"name\": \"", medianKey = "\"median_ms\": ";
+    while (std::getline(in, line)) {
+        size_t n = line.find(nameKey), m = line.find(medianKey);
+        if (n == std::string::npos || m == std::string::npos) continue;
+        n += nameKey.size();
+        std::string name = line.substr(n, line.find('"', n) - n);
+        medians[name] = std::strtod(line.c_str() + m + medianKey.size(), nullptr);
+    }
+    return medians;
+}
+
+int main(int argc, char **argv) {
+    Suite suite;
+    double scale = 1;
+    std::string jsonFile, baselineFile;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "-filter") suite.filter = argv[i + 1];
+        else if (arg == "-repeat") suite.repeat = unsigned(std::atoi(argv[i + 1]));
+        else if (arg == "-scale") scale = std::atof(argv[i + 1]);
+        else if (arg == "-json") jsonFile = argv[i + 1];
+        else if (arg == "-baseline") baselineFile = argv[i + 1];
+    }
+    if (suite.repeat < 1 || scale <= 0 || argc % 2 == 0) {
+        std::cerr << "usage: strict_bench [-filter S] [-repeat N] [-scale F] [-json FILE] [-baseline FILE]\n";
+        return 1;
+    }
+    auto scaled = [&](int n) { return std::max(1, int(n * scale)); };
+
+    std::string err;
+    std::unique_ptr<llvm::TargetMachine> TM = createHostTargetMachine(2, err);
+    if (!TM) {
+        std::cerr << "Error: " << err << "\n";
+        return 1;
+    }
+    namespace fs = std::filesystem;
+    fs::path dir = fs::temp_directory_path() / "strict_bench";
+    fs::create_directories(dir);
+    // Where the +profile runs' reports go (and are removed with the rest)
+    std::string profilePrefix = (dir / "profile").string();
+#ifdef _WIN32
+    _putenv_s("STRICT_PROFILE", profilePrefix.c_str());
+#else
+    setenv("STRICT_PROFILE", profilePrefix.c_str(), 1);
+#endif
+
+    const Program compiled[] = {
+        {"deep_expr", deepExpr(500, scaled(20))},
+        {"many_funcs", manyFuncs(scaled(10000))},
+        {"match_chain", matchChain(scaled(2000), 1000)},
+        {"big_loop", bigLoop(scaled(200), 1000)},
+    };
+    const Program runs[] = {
+        {"big_loop", bigLoop(scaled(5000), 10000)},
+        {"match_chain", matchChain(200, scaled(20000000))},
+        {"array_kernel", arrayKernel(100000, scaled(500))},
+        {"fib", fib(std::min(40, 31 + int(scale)))},
+    };
+
+    std::cout << "benchmark                     median(ms)     min(ms)   throughput\n";
+    for (const Program &p : compiled) compileBenchmarks(suite, p, *TM, dir.string());
+    for (const Program &p : runs) runBenchmark(suite, p, *TM, false);
+    runBenchmark(suite, runs[0], *TM, true);
+    runBenchmark(suite, runs[3], *TM, true);
+
+    if (!jsonFile.empty()) {
+        std::ofstream out(jsonFile);
+        writeJSON(suite.results, suite.repeat, scale, out);
+        if (!out) {
+            std::cerr << "Error: cannot write " << jsonFile << "\n";
+            return 1;
+        }
+    }
+    if (!baselineFile.empty()) {
+        std::map<std::string, double> base = readBaseline(baselineFile);
+        std::cout << "\nagainst " << baselineFile << " (median ratio; < 1 is faster)\n";
+        for (const Result &r : suite.results) {
+            auto it = base.find(r.name);
+            if (it == base.end() || it->second <= 0) continue;
+            std::cout << std::left << std::setw(28) << r.name << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(10) << r.medianMs / it->second << "x\n";
+        }
+    }
+    fs::remove_all(dir);
+    return 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// === Arena List ===
+// Fixed-size array living in an Arena. Range-for compatible so AST walks
+// read the same as they did over std::vector.
+template <typename T>
+struct ArenaList {
+    T *items;
+    size_t count;
+
+    ArenaList() : items(nullptr), count(0) {}
+    ArenaList(T *i, size_t n) : items(i), count(n) {}
+
+    T *begin() const { return items; }
+    T *end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T &operator[](size_t i) const { return items[i]; }
+};
+
+// === Arena ===
+// Bump allocator for AST nodes. Allocations are carved out of large blocks
+// and released in one shot when the arena dies; destructors of objects
+// placed here never run, so they must not own heap memory.
+class Arena {
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char *ptr;
+    char *limit;
+    size_t used;
+    size_t reserved;
+
+public:
+    static const size_t BlockSize = 256 * 1024;
+
+    Arena() : ptr(nullptr), limit(nullptr), used(0), reserved(0) {}
+    Arena(Arena &&o) noexcept
+        : blocks(std::move(o.blocks)), ptr(o.ptr), limit(o.limit),
+          used(o.used), reserved(o.reserved) {
+        o.ptr = o.limit = nullptr;
+        o.used = o.reserved = 0;
+    }
+    Arena &operator=(Arena &&o) noexcept {
+        blocks = std::move(o.blocks);
+        ptr = o.ptr;
+        limit = o.limit;
+        used = o.used;
+        reserved = o.reserved;
+        o.ptr = o.limit = nullptr;
+        o.used = o.reserved = 0;
+        return *this;
+    }
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    void *allocate(size_t size, size_t align) {
+        size_t pad = (align - reinterpret_cast<uintptr_t>(ptr) % align) % align;
+        if (!ptr || size + pad > size_t(limit - ptr)) {
+            grow(size + align);
+            pad = (align - reinterpret_cast<uintptr_t>(ptr) % align) % align;
+        }
+        char *p = ptr + pad;
+        ptr = p + size;
+        used += size + pad;
+        return p;
+    }
+
+    template <typename T, typename... Args>
+    T *make(Args &&...args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    ArenaList<T> copyList(const std::vector<T> &v) {
+        if (v.empty()) return ArenaList<T>();
+        T *items = static_cast<T*>(allocate(sizeof(T) * v.size(), alignof(T)));
+        for (size_t i = 0; i < v.size(); i++) new (&items[i]) T(v[i]);
+        return ArenaList<T>(items, v.size());
+    }
+
+    std::string_view copyString(std::string_view s) {
+        if (s.empty()) return std::string_view();
+        char *p = static_cast<char*>(allocate(s.size(), 1));
+        std::memcpy(p, s.data(), s.size());
+        return std::string_view(p, s.size());
+    }
+
+    size_t bytesUsed() const { return used; }
+    size_t bytesReserved() const { return reserved; }
+
+private:
+    void grow(size_t minSize) {
+        // Oversized requests get a dedicated block of their own.
+        size_t size = minSize > BlockSize ? minSize : BlockSize;
+        blocks.emplace_back(new char[size]);
+        ptr = blocks.back().get();
+        limit = ptr + size;
+        reserved += size;
+    }
+};
@@ -1,21 +1,63 @@
 #pragma once
+#include "arena.hpp"
+#include "operators.hpp"
+#include "symbol.hpp"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
 #include <llvm/IR/Value.h>
 
+namespace llvm { class Function; class LLVMContext; class Module; }
+struct CodegenContext;
+
+// Every node is placed in its ProgramAST's Arena (see Arena::make) and
+// freed with it; names are interned Symbols and lists are ArenaLists, so
+// no node owns heap memory of its own.
+
+// === Structural Hashing ===
+// FNV-1a over a subtree's node kinds, names and constants. Symbols hash by
+// spelling, so the value is stable across runs and can key the on-disk
+// build cache (see incremental.hpp). Callees met along the way are
+// collected for dependency tracking.
+class ASTHasher {
+    uint64_t state = 14695981039346656037ull;
+
+public:
+    std::vector<Symbol> calls;
+
+    void bytes(const void *data, size_t size) {
+        const unsigned char *p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            state ^= p[i];
+            state *= 1099511628211ull;
+        }
+    }
+    void add(uint64_t v) { bytes(&v, sizeof(v)); }
+    void add(std::string_view s) {
+        add(uint64_t(s.size()));
+        bytes(s.data(), s.size());
+    }
+    void add(Symbol s) { add(s.str()); }
+    uint64_t value() const { return state; }
+};
+
 // === Base Classes ===
 
 struct ExprAST {
     virtual ~ExprAST();
     virtual void print(int indent = 0) const = 0;
-    virtual llvm::Value* codegen() = 0;
+    virtual void hash(ASTHasher &h) const = 0;
+    virtual llvm::Value* codegen(CodegenContext &cg) = 0;
 };
 
 struct StmtAST {
     virtual ~StmtAST();
     virtual void print(int indent = 0) const = 0;
-    virtual llvm::Value* codegen() = 0;
+    virtual void hash(ASTHasher &h) const = 0;
+    virtual llvm::Value* codegen(CodegenContext &cg) = 0;
 };
 
 // === Expressions ===
@@ -24,46 +66,78 @@ struct NumberExprAST : public ExprAST {
     int value;
     NumberExprAST(int v);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct StringExprAST : public ExprAST {
-    std::string value;
-    StringExprAST(const std::string &s);
+    std::string_view value;
+    StringExprAST(std::string_view s);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct VarExprAST : public ExprAST {
-    std::string name;
-    VarExprAST(const std::string &n);
+    Symbol name;
+    VarExprAST(Symbol n);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct UnaryExprAST : public ExprAST {
-    std::string op;
+    UnaryOp op;
     ExprAST *expr;
-    UnaryExprAST(const std::string &o, ExprAST *e);
+    UnaryExprAST(UnaryOp o, ExprAST *e);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct BinaryExprAST : public ExprAST {
-    std::string op;
+    BinaryOp op;
     ExprAST *lhs;
     ExprAST *rhs;
-    BinaryExprAST(const std::string &o, ExprAST *l, ExprAST *r);
+    BinaryExprAST(BinaryOp o, ExprAST *l, ExprAST *r);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct CallExprAST : public ExprAST {
-    std::string callee;
-    std::vector<ExprAST*> args;
-    CallExprAST(const std::string &c, const std::vector<ExprAST*> &a);
+    Symbol callee;
+    ArenaList<ExprAST*> args;
+    CallExprAST(Symbol c, ArenaList<ExprAST*> a);
+    void print(int indent) const override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
+};
+
+// `Future Call f(args)`: runs the call as a task on the runtime's pool and
+// yields a handle to it (see __future_spawn in runtime.c)
+struct FutureExprAST : public ExprAST {
+    CallExprAST *call;
+    FutureExprAST(CallExprAST *c);
+    void print(int indent) const override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
+};
+
+// `Sync f`: waits for a Future and yields its call's result
+struct SyncExprAST : public ExprAST {
+    ExprAST *future;
+    SyncExprAST(ExprAST *f);
+    void print(int indent) const override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
+};
+
+// `Input`: reads one integer from stdin (strict_input in runtime.c)
+struct InputExprAST : public ExprAST {
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 // === Statements ===
@@ -72,103 +146,152 @@ struct ExprStmtAST : public StmtAST {
     ExprAST *expr;
     ExprStmtAST(ExprAST *e);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct VarDeclAST : public StmtAST {
-    std::string name;
+    Symbol name;
     ExprAST *init;
-    VarDeclAST(const std::string &n, ExprAST *i);
+    VarDeclAST(Symbol n, ExprAST *i);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
+};
+
+struct AssignStmtAST : public StmtAST {
+    Symbol name;
+    ExprAST *value;
+    AssignStmtAST(Symbol n, ExprAST *v);
+    void print(int indent) const override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct IfStmtAST : public StmtAST {
     ExprAST *cond;
-    std::vector<StmtAST*> thenBody;
-    std::vector<StmtAST*> elseBody;
-    IfStmtAST(ExprAST *c, const std::vector<StmtAST*> &t,
-              const std::vector<StmtAST*> &e);
+    ArenaList<StmtAST*> thenBody;
+    ArenaList<StmtAST*> elseBody;
+    IfStmtAST(ExprAST *c, ArenaList<StmtAST*> t, ArenaList<StmtAST*> e);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
+};
+
+// Loop hints, written after a For's range or a While's condition
+// (`For i = 0..n Unroll 4 Vectorize`) or as `Parallel For`. They become
+// llvm.loop metadata on the loop's latch.
+struct LoopHints {
+    bool parallel = false;      // Parallel For: iterations never depend on each other
+    int unroll = -1;            // -1 no hint, 0 let LLVM pick, 1 never, n unroll by n
+    int vectorize = -1;         // -1 no hint, 0 let LLVM pick, 1 never, n width n
 };
 
 struct ForStmtAST : public StmtAST {
-    std::string var;
+    Symbol var;                 // read-only in the body
     ExprAST *start;
-    ExprAST *end;
-    std::vector<StmtAST*> body;
-    ForStmtAST(const std::string &v, ExprAST *s, ExprAST *e,
-               const std::vector<StmtAST*> &b);
+    ExprAST *end;               // inclusive
+    ArenaList<StmtAST*> body;
+    LoopHints hints;
+    ForStmtAST(Symbol v, ExprAST *s, ExprAST *e, ArenaList<StmtAST*> b, LoopHints h);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct WhileStmtAST : public StmtAST {
     ExprAST *cond;
-    std::vector<StmtAST*> body;
-    WhileStmtAST(ExprAST *c, const std::vector<StmtAST*> &b);
+    ArenaList<StmtAST*> body;
+    LoopHints hints;
+    WhileStmtAST(ExprAST *c, ArenaList<StmtAST*> b, LoopHints h);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct PrintStmtAST : public StmtAST {
     ExprAST *expr;
     PrintStmtAST(ExprAST *e);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct ReturnStmtAST : public StmtAST {
     ExprAST *expr;
     ReturnStmtAST(ExprAST *e);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 struct FuncDeclAST : public StmtAST {
-    std::string name;
-    std::vector<std::string> params;
-    std::vector<StmtAST*> body;
-    FuncDeclAST(const std::string &n,
-                const std::vector<std::string> &p,
-                const std::vector<StmtAST*> &b);
+    Symbol name;
+    ArenaList<Symbol> params;
+    ArenaList<StmtAST*> body;
+    FuncDeclAST(Symbol n, ArenaList<Symbol> p, ArenaList<StmtAST*> b);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
+    llvm::Function* prototype(CodegenContext &cg);
 };
 
 struct ClassDeclAST : public StmtAST {
-    std::string name;
-    std::string base;
-    std::vector<StmtAST*> body;
-    ClassDeclAST(const std::string &n, const std::string &b,
-                 const std::vector<StmtAST*> &bd);
+    Symbol name;
+    Symbol base;
+    ArenaList<StmtAST*> body;
+    ClassDeclAST(Symbol n, Symbol b, ArenaList<StmtAST*> bd);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
+};
+
+// How a Case tests the Match subject. Cases are tried in order and the
+// first that matches runs; patterns made of integer or string literals
+// let codegen replace the tests with a switch or decision tree.
+enum class CaseKind : uint8_t {
+    Value,                              // Case 3:  Case "stop":
+    Range,                              // Case 1..9:  (inclusive)
+    Less, LessEq, Greater, GreaterEq,   // Case <0:
+    Default                             // Case *:
 };
 
 struct CaseAST {
-    ExprAST *pattern;
-    std::vector<StmtAST*> body;
-    CaseAST(ExprAST *p, const std::vector<StmtAST*> &b);
+    CaseKind kind;
+    ExprAST *pattern;   // value, bound or lower end of a Range; null for Default
+    ExprAST *high;      // upper end of a Range
+    ArenaList<StmtAST*> body;
+    CaseAST(CaseKind k, ExprAST *p, ExprAST *h, ArenaList<StmtAST*> b);
     void print(int indent) const;
+    void hash(ASTHasher &h) const;
 };
 
 struct MatchStmtAST : public StmtAST {
     ExprAST *expr;
-    std::vector<CaseAST*> cases;
-    MatchStmtAST(ExprAST *e, const std::vector<CaseAST*> &c);
+    ArenaList<CaseAST*> cases;
+    MatchStmtAST(ExprAST *e, ArenaList<CaseAST*> c);
     void print(int indent) const override;
-    llvm::Value* codegen() override;
+    void hash(ASTHasher &h) const override;
+    llvm::Value* codegen(CodegenContext &cg) override;
 };
 
 // === Program Root ===
 
 struct ProgramAST {
+    Arena arena;          // owns every node reachable from `statements`
+    SymbolTable symbols;  // owns every identifier spelling
     std::vector<StmtAST*> statements;
+    std::unique_ptr<CodegenContext> cg;  // set by codegen()
     ProgramAST();
+    ProgramAST(ProgramAST &&);
+    ProgramAST &operator=(ProgramAST &&);
+    ~ProgramAST();
     void print() const;
-    llvm::Value* codegen();
+    // False if codegen recorded errors (see CodegenContext::errors)
+    bool codegen();
     void emitIR(const std::string &filename);
     llvm::Module* getModule();
+    // Transfers the generated module, and the context that owns it, to the
+    // caller (e.g. the JIT). getModule() returns nullptr afterwards.
+    std::unique_ptr<llvm::Module> takeModule(std::unique_ptr<llvm::LLVMContext> &context);
 };
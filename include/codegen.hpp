@@ -1,8 +1,73 @@
 #pragma once
+#include "symbol.hpp"
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
 #include <llvm/IR/Value.h>
 
 struct ProgramAST;
+struct StmtAST;
+struct FuncDeclAST;
+
+// A named variable's storage: an alloca of the current function, or, in
+// an outlined Parallel For body, a pointer into the parent's frame
+struct Variable {
+    llvm::Value *slot = nullptr;
+    llvm::Type *type = nullptr;
+};
+
+// A range fact for bounds-check elimination: while the For loop whose
+// variable lives in `index` runs, index + c is a valid position in the
+// List/Array held by `seq` for every c with low + c >= 0 and c <= slack
+struct InBoundsFact {
+    llvm::Value *index = nullptr;
+    llvm::Value *seq = nullptr;
+    int64_t low = 0;            // the loop variable is >= low
+    int64_t slack = 0;          // and <= Size(seq) - 1 - slack
+};
+
+// === Codegen Context ===
+// Everything one compilation's IR generation touches. Each ProgramAST owns
+// its own, so separate compilations (or threads) never share LLVM state.
+// The context outlives the module, which refers into it; both can be handed
+// off together (see ProgramAST::takeModule).
+struct CodegenContext {
+    std::unique_ptr<llvm::LLVMContext> context;
+    std::unique_ptr<llvm::Module> module;
+    llvm::IRBuilder<> builder;
+    std::unordered_map<Symbol, Variable> namedValues;         // current Func's scope
+    std::unordered_map<Symbol, llvm::Function*> functions;
+    std::unordered_set<llvm::Value*> loopVariables;           // For slots; not assignable
+    std::vector<InBoundsFact> inBounds;                       // of the enclosing For loops
+    std::vector<std::string> errors;                          // codegen errors, in order
+
+    CodegenContext()
+        : context(std::make_unique<llvm::LLVMContext>()),
+          module(std::make_unique<llvm::Module>("strict", *context)),
+          builder(*context) {}
+
+    llvm::LLVMContext &ctx() { return *context; }
+};
+
+// === Compilation Units ===
+// A slice of the program generated into a module of its own, for the
+// incremental build (see incremental.hpp).
+struct CodegenUnit {
+    std::vector<StmtAST*> definitions;      // top-level Funcs/Classes defined here
+    std::vector<FuncDeclAST*> inlineable;   // available_externally: inlined, never emitted
+    std::vector<FuncDeclAST*> declared;     // called here, defined in another unit
+    bool hasMain = false;                   // top-level statements become main
+};
+
+// Generates `unit` into `cg`, a fresh context. Returns false if any
+// error was recorded in cg.errors.
+bool codegenUnit(ProgramAST &program, const CodegenUnit &unit, CodegenContext &cg);
 
 // === Codegen API ===
 
@@ -12,3 +77,8 @@ llvm::Value* codegenProgram(ProgramAST &program);
 
 // Emit LLVM IR to a file (.ll)
 void emitIR(ProgramAST &program, const std::string &filename);
+
+// `--profile`: brackets every Func and main (not outlined loop bodies or
+// Future thunks) with calls to __prof_enter(name) / __prof_exit(), before
+// optimization, so inlined bodies still count as their own Func
+void instrumentProfile(llvm::Module &M);
@@ -1,13 +1,206 @@
 #pragma once
+#include "source.hpp"
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <llvm/IR/Module.h>
 
+// === DGM Opcodes ===
+// The 144-entry Dodecagram table. Codes are two base-12 digits (00–BB),
+// stored as one byte holding their value (0–143):
+//   00–4B  core LLVM instructions
+//   50–7B  safety & arithmetic extensions
+//   80–9B  data structures
+//   A0–BB  CIAM extensions
+constexpr uint8_t dgm(unsigned hi, unsigned lo) { return uint8_t(hi * 12 + lo); }
+
+constexpr unsigned DGMOpcodeCount = 144;
+
+enum class DGMOp : uint8_t {
+    Nop = dgm(0, 0),       Alloca = dgm(0, 1),     Load = dgm(0, 2),
+    Store = dgm(0, 3),     GEP = dgm(0, 4),        Fence = dgm(0, 5),
+    CmpXchg = dgm(0, 6),   AtomicRMW = dgm(0, 7),  Trunc = dgm(0, 8),
+    ZExt = dgm(0, 9),      SExt = dgm(0, 10),      FPTrunc = dgm(0, 11),
+    FPExt = dgm(1, 0),     FPToUI = dgm(1, 1),     FPToSI = dgm(1, 2),
+    UIToFP = dgm(1, 3),    SIToFP = dgm(1, 4),     ICmp = dgm(1, 5),
+    FCmp = dgm(1, 6),      Add = dgm(1, 7),        Sub = dgm(1, 8),
+    Mul = dgm(1, 9),       UDiv = dgm(1, 10),      SDiv = dgm(1, 11),
+    URem = dgm(2, 0),      SRem = dgm(2, 1),       Shl = dgm(2, 2),
+    LShr = dgm(2, 3),      AShr = dgm(2, 4),       And = dgm(2, 5),
+    Or = dgm(2, 6),        Xor = dgm(2, 7),        FAdd = dgm(2, 8),
+    FSub = dgm(2, 9),      FMul = dgm(2, 10),      Call = dgm(2, 11),
+    Br = dgm(3, 0),        Switch = dgm(3, 1),     IndirectBr = dgm(3, 2),
+    Ret = dgm(3, 3),       Unreachable = dgm(3, 4), Invoke = dgm(3, 5),
+    Resume = dgm(3, 6),    Phi = dgm(3, 7),        Select = dgm(3, 8),
+    PtrToInt = dgm(3, 9),  IntToPtr = dgm(3, 10),  BitCast = dgm(3, 11),
+    AddrSpaceCast = dgm(4, 0), FDiv = dgm(4, 1),   FRem = dgm(4, 2),
+    FNeg = dgm(4, 3),      ExtractValue = dgm(4, 4), InsertValue = dgm(4, 5),
+    ExtractElement = dgm(4, 6), InsertElement = dgm(4, 7), ShuffleVector = dgm(4, 8),
+    Freeze = dgm(4, 9),    VAArg = dgm(4, 10),     LandingPad = dgm(4, 11),
+
+    Assert = dgm(7, 11),   // language.assert
+
+    // Not part of the table: an LLVM instruction with no DGM equivalent.
+    // Its only operand is the LLVM opcode name, as a symbol.
+    Unmapped = 0xFF
+};
+
+// Mnemonic for an opcode ("add", "icmp", ...), or nullptr for unassigned codes.
+const char *dgmOpName(uint8_t op);
+// The two base-12 digits of an opcode ("17" for Add).
+std::string dgmOpCode(uint8_t op);
+
+// === Binary DGM Container ===
+// Little-endian, laid out so a reader can map the file and seek straight to
+// any function or block without decoding what comes before it:
+//
+//   DGMHeader
+//   DGMFunctionEntry[functionCount]   fixed-size function index
+//   DGMBlockEntry[blockCount]         fixed-size block index
+//   DGMGlobalEntry[globalCount]       module data (string literals, ...)
+//   strings                           varint length + bytes each
+//   code                              instruction stream
+//
+// Instruction: opcode byte, then varint (operandCount << 4 | type << 1 | defines),
+// then the operands. `defines` means the instruction produces the next SSA
+// value number of its function (arguments are numbered first). `type` is
+// the result type, or the stored value's type for a store. Each operand is
+// one varint (payload << 2 | kind); immediates are zigzag-encoded.
+//
+// Operand order follows LLVM's (a call ends with its callee), except:
+// icmp/fcmp lead with the predicate as an immediate, alloca leads with the
+// allocation size in bytes, br lists its condition and then its successors
+// in order, phi lists (value, block) pairs, and getelementptr is lowered to
+// byte arithmetic: base, constant offset, then (index, scale) pairs. A
+// constant address at an offset from a global has no operand form; each
+// one is defined by a getelementptr at the top of the entry block.
+constexpr char DGMMagic[4] = {'D', 'G', 'M', 'B'};
+constexpr uint32_t DGMVersion = 3;
+
+struct DGMHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t functionCount;
+    uint32_t blockCount;
+    uint32_t globalCount;
+    uint32_t functionIndexOffset;
+    uint32_t blockIndexOffset;
+    uint32_t globalIndexOffset;
+    uint32_t stringsOffset;
+    uint32_t codeOffset;
+};
+
+struct DGMFunctionEntry {
+    uint32_t name;          // string offset
+    uint32_t signature;     // string offset: return DGMType, then one per argument
+    uint32_t firstBlock;    // index into the block index
+    uint32_t blockCount;
+    uint32_t codeOffset;    // relative to the code section
+    uint32_t codeSize;
+    uint32_t argCount;
+    uint32_t valueCount;    // arguments + value-defining instructions
+    uint32_t exported;      // 1 if other objects may link against it
+};
+
+struct DGMBlockEntry {
+    uint32_t name;          // string offset
+    uint32_t codeOffset;    // relative to the code section
+    uint32_t instCount;
+};
+
+constexpr uint32_t DGMZeroInit = UINT32_MAX;
+
+struct DGMGlobalEntry {
+    uint32_t name;          // string offset
+    uint32_t data;          // string offset of the initializer, or DGMZeroInit
+    uint32_t size;
+    uint32_t constant;      // 1 if read-only
+};
+
+enum class DGMType : uint8_t { Void, I1, I8, I16, I32, I64, Ptr, Other };
+
+// Width in bits of an integer/pointer type (I1 travels as a byte)
+inline unsigned dgmTypeBits(DGMType t) {
+    switch (t) {
+        case DGMType::I1: case DGMType::I8: return 8;
+        case DGMType::I16: return 16;
+        case DGMType::I32: return 32;
+        default: return 64;
+    }
+}
+
+enum class DGMOperandKind : uint8_t {
+    Value,   // SSA value number within the function
+    Imm,     // signed integer
+    Block,   // block index within the function
+    Symbol   // string offset of a global's name
+};
+
+struct DGMOperand {
+    DGMOperandKind kind;
+    int64_t value;
+};
+
+struct DGMInst {
+    uint8_t op;
+    DGMType type;
+    bool defines;
+    std::vector<DGMOperand> operands;
+};
+
+// Read-only view of a binary .dgm file. The file is mapped, not read; all
+// accessors decode directly out of the mapping.
+class DGMReader {
+    SourceFile file;
+    const uint8_t *base = nullptr;
+    size_t size = 0;
+    DGMHeader header{};
+
+public:
+    bool open(const std::string &path, std::string &err);
+
+    uint32_t functionCount() const { return header.functionCount; }
+    uint32_t globalCount() const { return header.globalCount; }
+    DGMFunctionEntry function(uint32_t index) const;
+    DGMGlobalEntry global(uint32_t index) const;
+    DGMBlockEntry block(const DGMFunctionEntry &fn, uint32_t index) const;
+    std::string_view string(uint32_t offset) const;
+
+    // Decodes up to `limit` instructions from [begin, end) of the code section.
+    class Cursor {
+        const uint8_t *cur;
+        const uint8_t *end;
+        uint32_t remaining;
+    public:
+        Cursor(const uint8_t *b, const uint8_t *e, uint32_t limit = UINT32_MAX)
+            : cur(b), end(e), remaining(limit) {}
+        bool next(DGMInst &inst);
+    };
+    Cursor code(const DGMFunctionEntry &fn) const;
+    Cursor code(const DGMFunctionEntry &fn, const DGMBlockEntry &bb) const;
+};
+
 // === DGM Translator ===
-// Takes an LLVM module and writes out a .dgm file
-// with 144-opcode mapped instruction stream.
-void translateModuleToDGM(llvm::Module &M, const std::string &filename);
+// Takes an LLVM module and writes out a binary .dgm file
+// with 144-opcode mapped instruction stream. Functions are encoded on up
+// to `jobs` threads (0 = one per core); the file is identical for any count.
+// Fails, with the reason in `err` and no file left at `filename`, on a
+// value or global initializer DGM cannot spell, or when the write fails.
+bool translateModuleToDGM(llvm::Module &M, const std::string &filename, std::string &err,
+                          unsigned jobs = 0);
+
+// Writes a readable listing of a binary .dgm file (`strictc --dgm-text`).
+void dumpDGMText(const std::string &dgmFile, const std::string &textFile);
 
 // === DGM Emitter ===
 // Reads a .dgm file and produces NASM x64 assembly
-// ready for `nasm -f win64`.
-void emitDGMtoNASM(const std::string &dgmFile, const std::string &nasmFile);
+// ready for `nasm -f win64` (or `-f elf64` off Windows). Functions are
+// lowered on up to `jobs` threads and written out in file order. Returns
+// false with `err` set, writing nothing, if an instruction has no lowering.
+bool emitDGMtoNASM(const std::string &dgmFile, const std::string &nasmFile, std::string &err,
+                   unsigned jobs = 0);
+
+// Shell command assembling emitDGMtoNASM output into a host object file.
+std::string nasmAssembleCommand(const std::string &nasmFile, const std::string &objFile);
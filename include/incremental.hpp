@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct ProgramAST;
+struct PGOProfile;
+
+// === Incremental Build Cache ===
+// `strictc --cache` splits the program into units — each top-level Func,
+// each Class, and the top-level statements (main) — and compiles every
+// unit into an object of its own under the cache directory. A unit's key
+// hashes its AST subtree (see ASTHasher) together with the compiler flags
+// and target, and with what its code depends on in other units: the
+// arity of each callee at -O0, or the subtrees of every Func it can
+// transitively inline from at -O1 and above (those bodies are given to
+// the optimizer as available_externally copies, so inlining still works
+// across units). Unchanged units reuse the cached object and skip codegen,
+// optimization, DGM translation and assembly entirely; the cached .ll and
+// .dgm sit next to each object for auditing, and so do its function and
+// instruction counts, which --stats sums over all units.
+// What --stats reports for the module; a cache entry keeps its unit's
+struct UnitCounts {
+    size_t functions = 0;
+    size_t irBefore = 0;                // instructions before optimization
+    size_t irAfter = 0;
+};
+
+struct CacheStats {
+    unsigned hits = 0;
+    unsigned misses = 0;
+    UnitCounts total;                   // over every unit, cached or rebuilt
+    std::vector<std::string> rebuilt;   // units compiled this run
+    std::vector<std::string> stalePGO;  // functions left unannotated by --pgo-use
+};
+
+struct IncrementalOptions {
+    std::string cacheDir = ".strict-cache";
+    unsigned optLevel = 0;
+    bool nativeBackend = false;         // --backend=llvm
+    unsigned jobs = 0;                  // units compiled in parallel; 0 = one per core
+    bool profile = false;               // --profile instrumentation
+    bool pgoGen = false;                // --pgo-gen instrumentation
+    const PGOProfile *pgoProfile = nullptr; // --pgo-use; its digest is part of every key
+};
+
+// Compiles or reuses every unit; `objects` receives the object files to
+// link, in program order. Returns false with `err` set on failure.
+bool buildUnits(ProgramAST &program, const IncrementalOptions &options,
+                std::vector<std::string> &objects, CacheStats &stats, std::string &err);
@@ -0,0 +1,19 @@
+#pragma once
+#include <memory>
+#include <string>
+
+namespace llvm { class LLVMContext; class Module; }
+
+// === JIT ===
+// Runs a program in-process with ORC's LLJIT (`strictc --run`), skipping the
+// object file, the external link and the process spawn. The runtime
+// (runtime.c) is compiled into strictc itself and bound to the JIT'd code
+// through an explicit symbol table, so jitted programs call the same
+// strict_* / __list_* / __array_* / __match_* entry points a linked
+// executable does.
+
+// Compiles the module at the given -O level's codegen setting and calls its
+// `main`. Returns main's result, or -1 with `err` filled if the module could
+// not be compiled or has no `main`.
+int runJIT(std::unique_ptr<llvm::Module> M, std::unique_ptr<llvm::LLVMContext> context,
+           unsigned optLevel, std::string &err);
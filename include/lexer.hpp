@@ -1,5 +1,8 @@
 #pragma once
+#include "operators.hpp"
+#include <iosfwd>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // === Token Types ===
@@ -34,9 +37,12 @@ enum TokenType {
     TOK_ASSERT,
     TOK_DEFER,
     TOK_INTERFACE,
+    TOK_UNROLL,
+    TOK_VECTORIZE,
+    TOK_SYNC,
 
     // Operators & symbols
-    TOK_OP,
+    TOK_OP,       // see Token::op
     TOK_ASSIGN,   // "="
     TOK_LPAREN,   // "("
     TOK_RPAREN,   // ")"
@@ -51,27 +57,57 @@ enum TokenType {
 };
 
 // === Token Struct ===
+// `text` is a view, not a copy: it points into the lexer's source buffer
+// (or at a static spelling for operators). For in-memory and mapped input
+// it stays valid while the source is alive; for streamed input it is only
+// valid until the next call to nextToken(). TOK_OP tokens also carry their
+// operator in `op`, so the parser never compares spellings.
 struct Token {
     TokenType type;
-    std::string text;
+    std::string_view text;
     int intVal;
+    OpToken op;
 
-    Token(TokenType t = TOK_EOF, const std::string &s = "", int v = 0)
-        : type(t), text(s), intVal(v) {}
+    Token(TokenType t = TOK_EOF, std::string_view s = {}, int v = 0)
+        : type(t), text(s), intVal(v), op(OpToken::None) {}
+    Token(OpToken o, std::string_view s)
+        : type(TOK_OP), text(s), intVal(0), op(o) {}
 };
 
 // === Lexer ===
+// Scans the buffer with a pair of raw pointers; characters are classified
+// through a 256-entry table and keywords resolved with a compile-time
+// perfect hash (see lexer.cpp).
+//
+// Three input modes:
+//   Lexer(std::string)       owns a copy of the source
+//   Lexer(begin, end)        runs over caller-owned bytes (e.g. a SourceFile
+//                            mapping); nothing is copied
+//   Lexer(std::istream&)     reads the stream in chunks into a sliding
+//                            window, so memory is bounded by the chunk size
+//                            and the longest token rather than the input
 class Lexer {
     std::string source;
-    size_t pos;
+    const char *cur;
+    const char *end;
+
+    // Streaming mode only
+    std::istream *stream;
+    std::vector<char> window;
+    size_t chunkSize;
 
 public:
+    static const size_t DefaultChunkSize = 64 * 1024;
+
     Lexer(const std::string &src);
+    Lexer(const char *begin, const char *end);
+    Lexer(std::istream &in, size_t chunk = DefaultChunkSize);
+    Lexer(const Lexer &) = delete;
+    Lexer &operator=(const Lexer &) = delete;
 
     Token nextToken();
 
 private:
-    char peek() const;
-    char get();
     void skipWhitespace();
+    bool refill(const char *&keep);
 };
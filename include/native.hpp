@@ -0,0 +1,28 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <llvm/IR/Module.h>
+#include <llvm/Target/TargetMachine.h>
+
+// === Native Backend ===
+// In-process object emission through LLVM's own instruction selection and
+// register allocation (`strictc --backend=llvm`), replacing the
+// DGM → NASM → nasm → link text path.
+
+// The code generator's optimization level for strictc's -O0..-O3; shared
+// by object emission and the JIT.
+llvm::CodeGenOpt::Level toCodeGenLevel(unsigned optLevel);
+
+// Creates a TargetMachine for the host. Returns nullptr and fills `err`
+// if the host target is not linked in.
+std::unique_ptr<llvm::TargetMachine> createHostTargetMachine(unsigned optLevel,
+                                                             std::string &err);
+
+// Stamps the target triple and data layout on the module. Must run before
+// optimization so the passes see the real type sizes.
+void configureModuleForTarget(llvm::Module &M, llvm::TargetMachine &TM);
+
+// Writes the module as a native object file. Returns false with `err` set
+// if the file cannot be written.
+bool emitObjectFile(llvm::Module &M, llvm::TargetMachine &TM,
+                    const std::string &objFile, std::string &err);
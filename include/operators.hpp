@@ -0,0 +1,43 @@
+#pragma once
+
+// === Operators ===
+// Operator tokens as produced by the lexer. The parser's precedence table
+// is indexed by these values, so keep OpToken::Count last.
+enum class OpToken : unsigned char {
+    Plus, Minus, Star, Slash,
+    Less, LessEq, Greater, GreaterEq,
+    EqEq, NotEq, Bang,
+    None,
+    Count = None
+};
+
+// Compact operator codes carried by the AST in place of spelled strings.
+enum class BinaryOp : unsigned char {
+    Add, Sub, Mul, Div,
+    Lt, Le, Gt, Ge,
+    Eq, Ne
+};
+
+enum class UnaryOp : unsigned char {
+    Neg, Not
+};
+
+inline const char *opSpelling(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::Add: return "+";
+        case BinaryOp::Sub: return "-";
+        case BinaryOp::Mul: return "*";
+        case BinaryOp::Div: return "/";
+        case BinaryOp::Lt:  return "<";
+        case BinaryOp::Le:  return "<=";
+        case BinaryOp::Gt:  return ">";
+        case BinaryOp::Ge:  return ">=";
+        case BinaryOp::Eq:  return "==";
+        case BinaryOp::Ne:  return "!=";
+    }
+    return "?";
+}
+
+inline const char *opSpelling(UnaryOp op) {
+    return op == UnaryOp::Neg ? "-" : "!";
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <string>
+#include <llvm/IR/Module.h>
+
+namespace llvm { class TargetMachine; }
+class PassTimer;
+
+// === Optimizer ===
+// Verifies the module, then runs LLVM's new-pass-manager default pipeline
+// for the given -O level (0-3) over it in place: mem2reg/SROA,
+// instcombine, GVN, loop passes and inlining at -O1 and above. A target
+// machine, when given, supplies the cost models used by the loop
+// vectorizer and inliner. With `forDGM` the pipeline keeps to what the DGM
+// lowering handles: scalar code only (no loop or SLP vectorizer, and loop
+// Vectorize hints turned off) and no switches turned into lookup tables of
+// pointers (the DGM emitter builds its own jump tables). A `timer` is told
+// when every pass starts and ends (--time-passes). Returns false with the
+// verifier's findings in `err` if the module fails verification.
+bool optimizeModule(llvm::Module &M, unsigned optLevel, std::string &err,
+                    llvm::TargetMachine *TM = nullptr, bool forDGM = false,
+                    PassTimer *timer = nullptr);
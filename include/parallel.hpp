@@ -0,0 +1,44 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// === Parallel Loops ===
+// Used by the DGM translator and emitter to spread functions over cores.
+// Results are written to per-index slots and merged by the caller in
+// index order, so output never depends on scheduling.
+
+// Worker threads for `count` items with `jobs` requested (0 = one per
+// hardware thread); never more workers than items, never fewer than one.
+inline unsigned workerCount(size_t count, unsigned jobs) {
+    if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+    return unsigned(std::max<size_t>(1, std::min<size_t>(jobs, count)));
+}
+
+// Calls body(states[w], i) for every i in [0, count), one worker thread per
+// element of `states` (the calling thread is worker 0). Indices are handed
+// out in chunks from a shared counter, so a few large functions don't stall
+// one worker while the others idle.
+template <typename State, typename Fn>
+void parallelFor(size_t count, std::vector<State> &states, Fn body) {
+    size_t workers = std::max<size_t>(1, states.size());
+    size_t chunk = std::max<size_t>(1, count / (workers * 8));
+    std::atomic<size_t> next{0};
+
+    auto work = [&](State &state) {
+        for (;;) {
+            size_t begin = next.fetch_add(chunk, std::memory_order_relaxed);
+            if (begin >= count) return;
+            size_t end = std::min(count, begin + chunk);
+            for (size_t i = begin; i < end; i++) body(state, i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < workers; w++) threads.emplace_back(work, std::ref(states[w]));
+    work(states[0]);
+    for (std::thread &t : threads) t.join();
+}
@@ -8,17 +8,37 @@
 class Parser {
     Lexer &lexer;
     Token current;
+    ProgramAST *program; // arena + symbol table of the program being parsed
+    size_t tokens = 0;   // for --stats
+    size_t nodes = 0;
 
 public:
     Parser(Lexer &lex);
 
     ProgramAST parseProgram();
 
+    size_t tokenCount() const { return tokens; }
+    size_t nodeCount() const { return nodes; }
+
 private:
     void advance();
     bool match(TokenType type);
     void expect(TokenType type, const std::string &err);
 
+    // Arena helpers
+    template <typename T, typename... Args>
+    T* make(Args &&...args) {
+        nodes++;
+        return program->arena.make<T>(std::forward<Args>(args)...);
+    }
+    template <typename T>
+    ArenaList<T> list(const std::vector<T> &items) {
+        return program->arena.copyList(items);
+    }
+    Symbol intern(std::string_view text) {
+        return program->symbols.intern(text);
+    }
+
     // Statements
     StmtAST* parseStatement();
     StmtAST* parseVarDecl();
@@ -27,20 +47,22 @@ private:
     StmtAST* parseIf();
     StmtAST* parseFor();
     StmtAST* parseWhile();
+    StmtAST* parseParallel();
     StmtAST* parseMatch();
+    CaseAST* parseCase();
     StmtAST* parsePrint();
     StmtAST* parseReturn();
     StmtAST* parseExprStmt();
 
     // Helpers
-    std::vector<StmtAST*> parseBlock();
+    LoopHints parseLoopHints();
+    ArenaList<StmtAST*> parseStatements();
+    ArenaList<StmtAST*> parseBlock();
 
     // Expressions
     ExprAST* parseExpression();
-    ExprAST* parseEquality();
-    ExprAST* parseComparison();
-    ExprAST* parseTerm();
-    ExprAST* parseFactor();
+    ExprAST* parseBinary(int minPrec);
     ExprAST* parseUnary();
     ExprAST* parsePrimary();
+    ExprAST* parseNamed(Symbol name);
 };
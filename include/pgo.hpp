@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace llvm { class Module; }
+
+// === Profile-Guided Optimization ===
+// `--pgo-gen` builds a program that counts how often each function is
+// entered and how often each way out of every conditional branch and
+// Match switch is taken; at exit the runtime adds the counts to
+// profile.data ($STRICT_PGO_FILE overrides). `--pgo-use=FILE` reads them
+// back as function entry counts, branch_weights and a profile summary, so
+// block placement, the inliner's hot/cold thresholds and switch lowering
+// follow what the program actually did. Both run straight after codegen,
+// on the same IR, so counters line up with the branches they describe.
+
+struct PGOProfile {
+    struct Counts {
+        uint64_t hash = 0;              // shape of the function's branches
+        std::vector<uint64_t> counts;   // entry, then each branch's successors in order
+    };
+    std::unordered_map<std::string, Counts> functions;
+    uint64_t digest = 0;                // of the whole file, for the --cache key
+};
+
+// Returns false with `err` set when the file cannot be read or is not a
+// Strict profile
+bool readPGOProfile(const std::string &path, PGOProfile &profile, std::string &err);
+
+// `--pgo-gen`: adds the counters to every function defined in `M`
+void instrumentPGO(llvm::Module &M);
+
+// `--pgo-use`: annotates every function the profile covers. Functions
+// whose branches changed since the profile was taken are left alone;
+// their names are returned in `stale`.
+void annotatePGO(llvm::Module &M, const PGOProfile &profile, std::vector<std::string> &stale);
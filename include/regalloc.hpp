@@ -0,0 +1,74 @@
+#pragma once
+#include "dgm.hpp"
+#include <cstdint>
+#include <vector>
+
+// === x86-64 Registers ===
+// Hardware encoding order.
+enum X86Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+    NoReg = 0xFF
+};
+
+constexpr uint32_t regBit(X86Reg r) { return 1u << r; }
+
+// Register name at the given width (8, 16, 32 or 64 bits)
+const char *x86RegName(X86Reg r, unsigned bits);
+
+// Calling convention targeted by the NASM emitter. rax, r10 and r11 are
+// never allocated: the lowering uses them for return values, dividends and
+// operand scratch.
+struct X86ABI {
+    X86Reg argRegs[6];
+    unsigned argRegCount;
+    unsigned shadowSpace;       // bytes the caller reserves below stack args
+    uint32_t calleeSaved;
+    X86Reg allocOrder[13];      // caller-saved first, so short-lived values
+    unsigned allocCount;        // don't force a save in the prologue
+};
+
+extern const X86ABI Win64ABI;
+extern const X86ABI SysVABI;
+
+// === Decoded Function ===
+// One function of a binary .dgm, decoded once for lowering.
+struct DGMFunctionBody {
+    DGMFunctionEntry entry{};
+    DGMType returnType = DGMType::Void;
+    std::vector<DGMInst> insts;         // layout order
+    std::vector<uint32_t> blockStart;   // first instruction of each block, plus an end sentinel
+    std::vector<DGMType> valueTypes;    // per SSA value
+
+    void load(const DGMReader &dgm, uint32_t index);
+    uint32_t blockCount() const { return uint32_t(blockStart.size()) - 1; }
+};
+
+// === Linear-Scan Register Allocation ===
+// Live intervals come from block-level liveness over the linearized
+// function (so values live around a loop's back edge cover the whole
+// loop), then Poletto–Sarkar linear scan assigns registers. Values live
+// across a call only get callee-saved registers; values live across a
+// division or a variable shift avoid rdx/rcx. Under pressure the interval
+// ending last is spilled to a stack slot for its whole lifetime.
+struct ValueLocation {
+    enum Kind : uint8_t {
+        None,   // dead, or a compare folded into its branch
+        Reg,
+        Slot,   // spilled: [rbp + offset]
+        Frame   // alloca: the value is the address rbp + offset
+    };
+    Kind kind = None;
+    X86Reg reg = NoReg;
+    int32_t offset = 0;
+};
+
+struct RegAllocation {
+    std::vector<ValueLocation> values;
+    std::vector<bool> fusedCompare;     // per instruction: icmp folded into the next br
+    uint32_t calleeSavedUsed = 0;       // saved below rbp, lowest register first
+    uint32_t frameBytes = 0;            // saves + allocas + spill slots
+    unsigned spilled = 0;
+};
+
+RegAllocation allocateRegisters(const DGMFunctionBody &fn, const X86ABI &abi);
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// === Source File ===
+// Read-only memory mapping of a .strict input. The Lexer runs directly over
+// the mapped bytes, so the file is never copied into a std::string.
+// open() fails for anything that cannot be mapped (pipes, FIFOs, character
+// devices); callers fall back to the streaming Lexer in that case.
+class SourceFile {
+    const char *data;
+    size_t length;
+#ifdef _WIN32
+    void *fileHandle;
+    void *mapHandle;
+#endif
+
+public:
+    SourceFile();
+    ~SourceFile();
+    SourceFile(const SourceFile &) = delete;
+    SourceFile &operator=(const SourceFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+
+    const char *begin() const { return data; }
+    const char *end() const { return data + length; }
+    size_t size() const { return length; }
+};
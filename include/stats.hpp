@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// === Compile Statistics ===
+// What `--stats`, `--time-passes` and `--stats-json=FILE` report for each
+// input: every phase of the build with its wall time, the CPU time of the
+// whole process over it (worker threads and finished child tools included,
+// and other files' work too in a batch) and the compiler's peak resident
+// set size when it ended, plus the size of what the phases produced and,
+// under --time-passes, the time spent in each LLVM optimization pass.
+
+struct PhaseStats {
+    std::string name;
+    double wallMs = 0;
+    double cpuMs = 0;
+    size_t peakRSSKb = 0;   // process high-water mark at the end of the phase
+    size_t rssGrowthKb = 0; // how far the phase raised it
+};
+
+struct PassStats {
+    std::string name;
+    unsigned runs = 0;
+    double wallMs = 0;      // excluding passes nested inside it
+};
+
+struct CompileStats {
+    std::string input;
+    std::vector<PhaseStats> phases;
+    std::vector<PassStats> passes;  // --time-passes, slowest first
+    size_t tokens = 0;
+    size_t astNodes = 0;
+    size_t astBytes = 0;            // arena bytes in use
+    size_t functions = 0;           // defined in the module
+    size_t irBefore = 0;            // instructions before optimization
+    size_t irAfter = 0;
+    unsigned cacheHits = 0;         // --cache
+    unsigned cacheMisses = 0;
+};
+
+// Times one phase from construction to stop(), which appends it to
+// `stats`; a timer that is never stopped (the phase failed) records nothing
+class PhaseTimer {
+    CompileStats &stats;
+    std::string name;
+    double wall0, cpu0;
+    size_t rss0;
+
+public:
+    PhaseTimer(CompileStats &s, std::string phase);
+    void stop();
+};
+
+// Collects per-pass times from the new pass manager's instrumentation
+// (see optimizeModule)
+class PassTimer {
+    struct Running {
+        std::string name;
+        double start;
+        double nested;              // time in passes run inside this one
+    };
+    std::vector<Running> stack;
+    std::vector<PassStats> totals;
+
+public:
+    void begin(const std::string &pass);
+    void end();
+    // Adds the totals to `out`, slowest first, leaving out pass managers
+    // and adaptors (their own time is bookkeeping)
+    void report(std::vector<PassStats> &out) const;
+};
+
+double wallClockMs();
+double processCPUMs();
+size_t peakRSSKb();
+
+void printStatsTable(const CompileStats &stats, std::ostream &out);
+// One JSON document for the whole build: {"files": [...], "wall_ms": total}
+void writeStatsJSON(const std::vector<const CompileStats*> &files, double wallMs, std::ostream &out);
@@ -0,0 +1,60 @@
+#pragma once
+#include "arena.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// === Symbols ===
+// Interned identifier. Every spelling is stored once in its SymbolTable, so
+// two Symbols are equal exactly when they point at the same entry and
+// comparison/hashing never touch the characters.
+struct SymbolEntry {
+    std::string_view text;
+    unsigned id;
+};
+
+class Symbol {
+    const SymbolEntry *entry;
+
+public:
+    Symbol() : entry(nullptr) {}
+    explicit Symbol(const SymbolEntry *e) : entry(e) {}
+
+    std::string_view str() const { return entry ? entry->text : std::string_view(); }
+    std::string string() const { return std::string(str()); }
+    unsigned id() const { return entry ? entry->id : ~0u; }
+    bool empty() const { return !entry; }
+
+    bool operator==(Symbol o) const { return entry == o.entry; }
+    bool operator!=(Symbol o) const { return entry != o.entry; }
+    bool operator<(Symbol o) const { return str() < o.str(); }
+
+    friend struct std::hash<Symbol>;
+};
+
+namespace std {
+template <>
+struct hash<Symbol> {
+    size_t operator()(Symbol s) const { return std::hash<const void*>()(s.entry); }
+};
+}
+
+// === Symbol Table ===
+class SymbolTable {
+    Arena storage;
+    std::unordered_map<std::string_view, const SymbolEntry*> entries;
+
+public:
+    Symbol intern(std::string_view text) {
+        auto it = entries.find(text);
+        if (it != entries.end()) return Symbol(it->second);
+        std::string_view owned = storage.copyString(text);
+        const SymbolEntry *e = storage.make<SymbolEntry>(SymbolEntry{owned, unsigned(entries.size())});
+        entries.emplace(owned, e);
+        return Symbol(e);
+    }
+
+    size_t size() const { return entries.size(); }
+};
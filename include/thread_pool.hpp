@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// === Work-Stealing Thread Pool ===
+// Schedules the per-file jobs of a batch compile. Every worker owns a
+// deque: jobs it submits itself go on the back and it pops from the back
+// (so a file's follow-up stage, like assembling and linking, tends to run
+// right after its compile, on warm caches), while idle workers steal from
+// the front of someone else's deque. Jobs submitted from outside the pool
+// are dealt round-robin onto the fronts, and so start in order.
+class WorkStealingPool {
+public:
+    using Job = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned threads);    // 0 = one per hardware thread
+    ~WorkStealingPool();                            // waits, then joins
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    void submit(Job job);
+    // Blocks until every submitted job, including jobs submitted by jobs,
+    // has finished
+    void wait();
+
+    unsigned size() const { return unsigned(queues.size()); }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<Job> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex sleepLock;
+    std::condition_variable wake;       // new work or shutdown
+    std::condition_variable drained;    // pending reached zero
+    std::atomic<size_t> pending{0};     // submitted and not yet finished
+    std::atomic<long> queued{0};        // sitting in some deque (briefly -1 when a
+                                        // job is taken before its submit finishes)
+    std::atomic<unsigned> nextQueue{0};
+    bool stopping = false;
+
+    bool take(unsigned self, Job &job);
+    void workerLoop(unsigned self);
+};
@@ -13,38 +13,54 @@ void NumberExprAST::print(int indent) const {
     std::cout << std::string(indent, ' ') << "Number(" << value << ")\n";
 }
 
-StringExprAST::StringExprAST(const std::string &s) : value(s) {}
+StringExprAST::StringExprAST(std::string_view s) : value(s) {}
 void StringExprAST::print(int indent) const {
     std::cout << std::string(indent, ' ') << "String(\"" << value << "\")\n";
 }
 
-VarExprAST::VarExprAST(const std::string &n) : name(n) {}
+VarExprAST::VarExprAST(Symbol n) : name(n) {}
 void VarExprAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Var(" << name << ")\n";
+    std::cout << std::string(indent, ' ') << "Var(" << name.str() << ")\n";
 }
 
-UnaryExprAST::UnaryExprAST(const std::string &o, ExprAST *e)
+UnaryExprAST::UnaryExprAST(UnaryOp o, ExprAST *e)
     : op(o), expr(e) {}
 void UnaryExprAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Unary(" << op << ")\n";
+    std::cout << std::string(indent, ' ') << "Unary(" << opSpelling(op) << ")\n";
     expr->print(indent + 2);
 }
 
-BinaryExprAST::BinaryExprAST(const std::string &o, ExprAST *l, ExprAST *r)
+BinaryExprAST::BinaryExprAST(BinaryOp o, ExprAST *l, ExprAST *r)
     : op(o), lhs(l), rhs(r) {}
 void BinaryExprAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Binary(" << op << ")\n";
+    std::cout << std::string(indent, ' ') << "Binary(" << opSpelling(op) << ")\n";
     lhs->print(indent + 2);
     rhs->print(indent + 2);
 }
 
-CallExprAST::CallExprAST(const std::string &c, const std::vector<ExprAST*> &a)
+CallExprAST::CallExprAST(Symbol c, ArenaList<ExprAST*> a)
     : callee(c), args(a) {}
 void CallExprAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Call(" << callee << ")\n";
+    std::cout << std::string(indent, ' ') << "Call(" << callee.str() << ")\n";
     for (auto *arg : args) arg->print(indent + 2);
 }
 
+FutureExprAST::FutureExprAST(CallExprAST *c) : call(c) {}
+void FutureExprAST::print(int indent) const {
+    std::cout << std::string(indent, ' ') << "Future\n";
+    call->print(indent + 2);
+}
+
+SyncExprAST::SyncExprAST(ExprAST *f) : future(f) {}
+void SyncExprAST::print(int indent) const {
+    std::cout << std::string(indent, ' ') << "Sync\n";
+    future->print(indent + 2);
+}
+
+void InputExprAST::print(int indent) const {
+    std::cout << std::string(indent, ' ') << "Input\n";
+}
+
 // ===== Statement AST =====
 
 ExprStmtAST::ExprStmtAST(ExprAST *e) : expr(e) {}
@@ -53,16 +69,21 @@ void ExprStmtAST::print(int indent) const {
     expr->print(indent + 2);
 }
 
-VarDeclAST::VarDeclAST(const std::string &n, ExprAST *i)
+VarDeclAST::VarDeclAST(Symbol n, ExprAST *i)
     : name(n), init(i) {}
 void VarDeclAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "VarDecl(" << name << ")\n";
+    std::cout << std::string(indent, ' ') << "VarDecl(" << name.str() << ")\n";
     if (init) init->print(indent + 2);
 }
 
-IfStmtAST::IfStmtAST(ExprAST *c,
-                     const std::vector<StmtAST*> &t,
-                     const std::vector<StmtAST*> &e)
+AssignStmtAST::AssignStmtAST(Symbol n, ExprAST *v)
+    : name(n), value(v) {}
+void AssignStmtAST::print(int indent) const {
+    std::cout << std::string(indent, ' ') << "Assign(" << name.str() << ")\n";
+    value->print(indent + 2);
+}
+
+IfStmtAST::IfStmtAST(ExprAST *c, ArenaList<StmtAST*> t, ArenaList<StmtAST*> e)
     : cond(c), thenBody(t), elseBody(e) {}
 void IfStmtAST::print(int indent) const {
     std::cout << std::string(indent, ' ') << "If\n";
@@ -75,20 +96,28 @@ void IfStmtAST::print(int indent) const {
     }
 }
 
-ForStmtAST::ForStmtAST(const std::string &v, ExprAST *s, ExprAST *e,
-                       const std::vector<StmtAST*> &b)
-    : var(v), start(s), end(e), body(b) {}
+static void printHints(const LoopHints &hints) {
+    if (hints.unroll >= 0) std::cout << " Unroll " << hints.unroll;
+    if (hints.vectorize >= 0) std::cout << " Vectorize " << hints.vectorize;
+    std::cout << "\n";
+}
+
+ForStmtAST::ForStmtAST(Symbol v, ExprAST *s, ExprAST *e, ArenaList<StmtAST*> b, LoopHints h)
+    : var(v), start(s), end(e), body(b), hints(h) {}
 void ForStmtAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "For(" << var << ")\n";
+    std::cout << std::string(indent, ' ') << (hints.parallel ? "Parallel " : "")
+              << "For(" << var.str() << ")";
+    printHints(hints);
     start->print(indent + 2);
     end->print(indent + 2);
     for (auto *s : body) s->print(indent + 2);
 }
 
-WhileStmtAST::WhileStmtAST(ExprAST *c, const std::vector<StmtAST*> &b)
-    : cond(c), body(b) {}
+WhileStmtAST::WhileStmtAST(ExprAST *c, ArenaList<StmtAST*> b, LoopHints h)
+    : cond(c), body(b), hints(h) {}
 void WhileStmtAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "While\n";
+    std::cout << std::string(indent, ' ') << "While";
+    printHints(hints);
     cond->print(indent + 2);
     for (auto *s : body) s->print(indent + 2);
 }
@@ -105,32 +134,31 @@ void ReturnStmtAST::print(int indent) const {
     expr->print(indent + 2);
 }
 
-FuncDeclAST::FuncDeclAST(const std::string &n,
-                         const std::vector<std::string> &p,
-                         const std::vector<StmtAST*> &b)
+FuncDeclAST::FuncDeclAST(Symbol n, ArenaList<Symbol> p, ArenaList<StmtAST*> b)
     : name(n), params(p), body(b) {}
 void FuncDeclAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Func(" << name << ")\n";
+    std::cout << std::string(indent, ' ') << "Func(" << name.str() << ")\n";
     for (auto *s : body) s->print(indent + 2);
 }
 
-ClassDeclAST::ClassDeclAST(const std::string &n, const std::string &b,
-                           const std::vector<StmtAST*> &bd)
+ClassDeclAST::ClassDeclAST(Symbol n, Symbol b, ArenaList<StmtAST*> bd)
     : name(n), base(b), body(bd) {}
 void ClassDeclAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Class(" << name << " : " << base << ")\n";
+    std::cout << std::string(indent, ' ') << "Class(" << name.str() << " : " << base.str() << ")\n";
     for (auto *s : body) s->print(indent + 2);
 }
 
-CaseAST::CaseAST(ExprAST *p, const std::vector<StmtAST*> &b)
-    : pattern(p), body(b) {}
+CaseAST::CaseAST(CaseKind k, ExprAST *p, ExprAST *h, ArenaList<StmtAST*> b)
+    : kind(k), pattern(p), high(h), body(b) {}
 void CaseAST::print(int indent) const {
-    std::cout << std::string(indent, ' ') << "Case\n";
-    pattern->print(indent + 2);
+    static const char *const Kinds[] = {"", "..", "<", "<=", ">", ">=", "*"};
+    std::cout << std::string(indent, ' ') << "Case " << Kinds[size_t(kind)] << "\n";
+    if (pattern) pattern->print(indent + 2);
+    if (high) high->print(indent + 2);
     for (auto *s : body) s->print(indent + 2);
 }
 
-MatchStmtAST::MatchStmtAST(ExprAST *e, const std::vector<CaseAST*> &c)
+MatchStmtAST::MatchStmtAST(ExprAST *e, ArenaList<CaseAST*> c)
     : expr(e), cases(c) {}
 void MatchStmtAST::print(int indent) const {
     std::cout << std::string(indent, ' ') << "Match\n";
@@ -138,9 +166,164 @@ void MatchStmtAST::print(int indent) const {
     for (auto *c : cases) c->print(indent + 2);
 }
 
+// ===== Structural Hashing =====
+// Every node leads with its own tag, and lists with their length, so
+// different shapes never feed the hasher the same stream.
+
+namespace {
+
+enum class HashTag : uint8_t {
+    Number = 1, String, Var, Unary, Binary, Call,
+    ExprStmt, VarDecl, If, For, While, Print, Return,
+    FuncDecl, ClassDecl, Case, Match, Assign, Future, Sync, Input
+};
+
+void hashBody(ASTHasher &h, const ArenaList<StmtAST*> &body) {
+    h.add(uint64_t(body.size()));
+    for (auto *s : body) s->hash(h);
+}
+
+void hashHints(ASTHasher &h, const LoopHints &hints) {
+    h.add(uint64_t(hints.parallel));
+    h.add(uint64_t(int64_t(hints.unroll)));
+    h.add(uint64_t(int64_t(hints.vectorize)));
+}
+
+} // namespace
+
+void NumberExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Number));
+    h.add(uint64_t(int64_t(value)));
+}
+
+void StringExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::String));
+    h.add(value);
+}
+
+void VarExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Var));
+    h.add(name);
+}
+
+void UnaryExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Unary));
+    h.add(uint64_t(op));
+    expr->hash(h);
+}
+
+void BinaryExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Binary));
+    h.add(uint64_t(op));
+    lhs->hash(h);
+    rhs->hash(h);
+}
+
+void CallExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Call));
+    h.add(callee);
+    h.add(uint64_t(args.size()));
+    for (auto *arg : args) arg->hash(h);
+    h.calls.push_back(callee);
+}
+
+void FutureExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Future));
+    call->hash(h);
+}
+
+void SyncExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Sync));
+    future->hash(h);
+}
+
+void InputExprAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Input));
+}
+
+void ExprStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::ExprStmt));
+    expr->hash(h);
+}
+
+void VarDeclAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::VarDecl));
+    h.add(name);
+    h.add(uint64_t(init != nullptr));
+    if (init) init->hash(h);
+}
+
+void AssignStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Assign));
+    h.add(name);
+    value->hash(h);
+}
+
+void IfStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::If));
+    cond->hash(h);
+    hashBody(h, thenBody);
+    hashBody(h, elseBody);
+}
+
+void ForStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::For));
+    h.add(var);
+    start->hash(h);
+    end->hash(h);
+    hashHints(h, hints);
+    hashBody(h, body);
+}
+
+void WhileStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::While));
+    cond->hash(h);
+    hashHints(h, hints);
+    hashBody(h, body);
+}
+
+void PrintStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Print));
+    expr->hash(h);
+}
+
+void ReturnStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Return));
+    expr->hash(h);
+}
+
+void FuncDeclAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::FuncDecl));
+    h.add(name);
+    h.add(uint64_t(params.size()));
+    for (Symbol p : params) h.add(p);
+    hashBody(h, body);
+}
+
+void ClassDeclAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::ClassDecl));
+    h.add(name);
+    h.add(base);
+    hashBody(h, body);
+}
+
+void CaseAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Case));
+    h.add(uint64_t(kind));
+    if (pattern) pattern->hash(h);
+    if (high) high->hash(h);
+    hashBody(h, body);
+}
+
+void MatchStmtAST::hash(ASTHasher &h) const {
+    h.add(uint64_t(HashTag::Match));
+    expr->hash(h);
+    h.add(uint64_t(cases.size()));
+    for (auto *c : cases) c->hash(h);
+}
+
 // ===== Program Root =====
 
-ProgramAST::ProgramAST() {}
 void ProgramAST::print() const {
     std::cout << "Program:\n";
     for (auto *s : statements) s->print(2);
@@ -1,209 +1,1467 @@
 #include "codegen.hpp"
 #include "ast.hpp"
+#include <llvm/IR/CFG.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/FileSystem.h>
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 
 using namespace llvm;
 
-static LLVMContext TheContext;
-static IRBuilder<> Builder(TheContext);
-static std::unique_ptr<Module> TheModule;
-static std::map<std::string, Value*> NamedValues;
-static std::map<std::string, Function*> FunctionTable;
-
 // === Helpers ===
 
-Value* logError(const std::string &msg) {
-    errs() << "Codegen error: " << msg << "\n";
+// Errors are recorded on the context; the driver reports them with the
+// file's other messages and fails the build
+Value* logError(CodegenContext &cg, const std::string &msg) {
+    cg.errors.push_back(msg);
     return nullptr;
 }
 
 // === Expr Codegen ===
 
-Value* NumberExprAST::codegen() {
-    return ConstantInt::get(Type::getInt32Ty(TheContext), value);
+Value* NumberExprAST::codegen(CodegenContext &cg) {
+    return ConstantInt::get(Type::getInt32Ty(cg.ctx()), value);
 }
 
-Value* StringExprAST::codegen() {
-    return Builder.CreateGlobalStringPtr(value, "str");
+Value* StringExprAST::codegen(CodegenContext &cg) {
+    return cg.builder.CreateGlobalStringPtr(value, "str");
 }
 
-Value* VarExprAST::codegen() {
-    if (NamedValues.count(name))
-        return NamedValues[name];
-    return logError("Unknown variable: " + name);
+Value* VarExprAST::codegen(CodegenContext &cg) {
+    auto it = cg.namedValues.find(name);
+    if (it == cg.namedValues.end())
+        return logError(cg, "Unknown variable: " + name.string());
+    const Variable &var = it->second;
+    return cg.builder.CreateLoad(var.type, var.slot, name.str());
 }
 
-Value* UnaryExprAST::codegen() {
-    Value* val = expr->codegen();
+Value* UnaryExprAST::codegen(CodegenContext &cg) {
+    Value* val = expr->codegen(cg);
     if (!val) return nullptr;
 
-    if (op == "-")
-        return Builder.CreateNeg(val, "negtmp");
-    if (op == "!")
-        return Builder.CreateNot(val, "nottmp");
-
-    return logError("Invalid unary operator: " + op);
+    switch (op) {
+        case UnaryOp::Neg:
+            return cg.builder.CreateNeg(val, "negtmp");
+        case UnaryOp::Not: {
+            // Logical not: 0 -> 1, anything else -> 0
+            Value* isZero = cg.builder.CreateICmpEQ(val, Constant::getNullValue(val->getType()), "nottmp");
+            return cg.builder.CreateZExt(isZero, Type::getInt32Ty(cg.ctx()), "booltmp");
+        }
+    }
+    return logError(cg, std::string("Invalid unary operator: ") + opSpelling(op));
 }
 
-Value* BinaryExprAST::codegen() {
-    Value* L = lhs->codegen();
-    Value* R = rhs->codegen();
+Value* BinaryExprAST::codegen(CodegenContext &cg) {
+    Value* L = lhs->codegen(cg);
+    Value* R = rhs->codegen(cg);
     if (!L || !R) return nullptr;
 
-    if (op == "+") return Builder.CreateAdd(L, R, "addtmp");
-    if (op == "-") return Builder.CreateSub(L, R, "subtmp");
-    if (op == "*") return Builder.CreateMul(L, R, "multmp");
-    if (op == "/") return Builder.CreateSDiv(L, R, "divtmp");
+    CmpInst::Predicate pred;
+    switch (op) {
+        case BinaryOp::Add: return cg.builder.CreateAdd(L, R, "addtmp");
+        case BinaryOp::Sub: return cg.builder.CreateSub(L, R, "subtmp");
+        case BinaryOp::Mul: return cg.builder.CreateMul(L, R, "multmp");
+        case BinaryOp::Div: return cg.builder.CreateSDiv(L, R, "divtmp");
+        case BinaryOp::Lt:  pred = CmpInst::ICMP_SLT; break;
+        case BinaryOp::Le:  pred = CmpInst::ICMP_SLE; break;
+        case BinaryOp::Gt:  pred = CmpInst::ICMP_SGT; break;
+        case BinaryOp::Ge:  pred = CmpInst::ICMP_SGE; break;
+        case BinaryOp::Eq:  pred = CmpInst::ICMP_EQ;  break;
+        case BinaryOp::Ne:  pred = CmpInst::ICMP_NE;  break;
+        default:
+            return logError(cg, std::string("Unknown binary operator: ") + opSpelling(op));
+    }
+
+    // Comparisons yield an i32 0/1, Strict's boolean representation
+    Value* cmp = cg.builder.CreateICmp(pred, L, R, "cmptmp");
+    return cg.builder.CreateZExt(cmp, Type::getInt32Ty(cg.ctx()), "booltmp");
+}
+
+// Allocas go in the entry block, where mem2reg/SROA can promote them.
+static AllocaInst* createEntryAlloca(Function* F, Type* T, StringRef name) {
+    IRBuilder<> entry(&F->getEntryBlock(), F->getEntryBlock().begin());
+    return entry.CreateAlloca(T, nullptr, name);
+}
+
+// Pointer to one of the runtime's opaque records (StrictFuture,
+// StrictList, StrictArray); each kind of handle is a type of its own, so a value of one
+// kind can't be passed where another is expected
+static PointerType* handleType(CodegenContext &cg, StringRef name) {
+    StructType* T = StructType::getTypeByName(cg.ctx(), name);
+    if (!T) T = StructType::create(cg.ctx(), name);
+    return T->getPointerTo();
+}
+
+static PointerType* futureType(CodegenContext &cg) { return handleType(cg, "StrictFuture"); }
+static PointerType* listType(CodegenContext &cg) { return handleType(cg, "StrictList"); }
+static PointerType* arrayType(CodegenContext &cg) { return handleType(cg, "StrictArray"); }
+
+// === Builtins ===
+// Calls to these names go straight to the runtime, unless the program
+// defines a Func of the same name. A name may have several entries; the
+// first whose parameters match the argument types is called. Index
+// arguments are sign-extended to size_t, so a negative index is out of
+// range like any other. `Seq` takes a List or an Array: both start with
+// the same {data, count} header (StrictSeq in runtime.c).
+namespace {
+
+enum class BuiltinArg : uint8_t { Int, Index, List, Array, Seq };
+enum class BuiltinResult : uint8_t { None, Int, Size, List, Array };
+// Element reads and writes and Size are generated inline (see
+// emitSeqAccess); the runtime function does the same, out of line
+enum class BuiltinLowering : uint8_t { Call, Load, Store, Count };
+
+struct Builtin {
+    const char *name;
+    const char *runtime;
+    BuiltinResult result;
+    std::vector<BuiltinArg> args;
+    BuiltinLowering lowering = BuiltinLowering::Call;
+};
+
+using BA = BuiltinArg;
+using BR = BuiltinResult;
+
+const Builtin Builtins[] = {
+    {"List", "__list_new", BR::List, {}},
+    {"Append", "__list_append", BR::None, {BA::List, BA::Int}},
+    {"Extend", "__list_extend", BR::None, {BA::List, BA::List}},
+    {"Reserve", "__list_reserve", BR::None, {BA::List, BA::Index}},
+    {"Get", "__list_get", BR::Int, {BA::List, BA::Index}, BuiltinLowering::Load},
+    {"Set", "__list_set", BR::None, {BA::List, BA::Index, BA::Int}, BuiltinLowering::Store},
+    {"Size", "__list_size", BR::Size, {BA::List}, BuiltinLowering::Count},
+    {"Remove", "__list_remove", BR::None, {BA::List, BA::Int}},
+    {"RemoveAt", "__list_remove_at", BR::Int, {BA::List, BA::Index}},
+    {"SwapRemove", "__list_swap_remove", BR::Int, {BA::List, BA::Index}},
+
+    {"Array", "__array_new", BR::Array, {BA::Index}},
+    {"Get", "__array_load", BR::Int, {BA::Array, BA::Index}, BuiltinLowering::Load},
+    {"Set", "__array_store", BR::None, {BA::Array, BA::Index, BA::Int}, BuiltinLowering::Store},
+    {"Size", "__array_length", BR::Size, {BA::Array}, BuiltinLowering::Count},
+
+    // Bulk operations (SIMD kernels in the runtime)
+    {"Fill", "__bulk_fill", BR::None, {BA::Seq, BA::Int}},
+    {"Copy", "__bulk_copy", BR::None, {BA::Seq, BA::Seq}},
+    {"Sum", "__bulk_sum", BR::Int, {BA::Seq}},
+    {"Min", "__bulk_min", BR::Int, {BA::Seq}},
+    {"Max", "__bulk_max", BR::Int, {BA::Seq}},
+    {"Find", "__bulk_find", BR::Int, {BA::Seq, BA::Int}},
+    {"Count", "__bulk_count", BR::Int, {BA::Seq, BA::Int}},
+    {"AddEach", "__bulk_add", BR::None, {BA::Seq, BA::Int}},
+    {"MulEach", "__bulk_mul", BR::None, {BA::Seq, BA::Int}},
+    {"Dot", "__bulk_dot", BR::Int, {BA::Seq, BA::Seq}},
+
+    // Fills the array from stdin; yields how many integers were read
+    {"InputAll", "__input_bulk", BR::Int, {BA::Array}},
+};
+
+bool isBuiltin(Symbol name) {
+    for (const Builtin &b : Builtins)
+        if (name.str() == b.name) return true;
+    return false;
+}
+
+// Builtins that change a List's length
+const char *const Resizing[] = {"Append", "Extend", "Remove", "RemoveAt", "SwapRemove"};
+
+// The variables a loop body assigns and the functions it calls, nested
+// statements included; Funcs and Classes declared inside are skipped.
+// Only enclosing-scope variables count as assigned: a name the body has
+// declared by then (Let, or a nested For's variable) is the body's own.
+struct BodyEffects {
+    std::vector<Symbol> assigned;
+    std::vector<Symbol> calls;
+    std::vector<Symbol> declared;
+
+    bool local(Symbol name) const {
+        return std::find(declared.begin(), declared.end(), name) != declared.end();
+    }
+
+    void expr(const ExprAST* e) {
+        if (auto *u = dynamic_cast<const UnaryExprAST*>(e)) {
+            expr(u->expr);
+        } else if (auto *b = dynamic_cast<const BinaryExprAST*>(e)) {
+            expr(b->lhs);
+            expr(b->rhs);
+        } else if (auto *c = dynamic_cast<const CallExprAST*>(e)) {
+            calls.push_back(c->callee);
+            for (auto *arg : c->args) expr(arg);
+        } else if (auto *f = dynamic_cast<const FutureExprAST*>(e)) {
+            expr(f->call);
+        } else if (auto *sy = dynamic_cast<const SyncExprAST*>(e)) {
+            expr(sy->future);
+        }
+    }
+
+    void stmt(const StmtAST* s) {
+        if (auto *es = dynamic_cast<const ExprStmtAST*>(s)) {
+            expr(es->expr);
+        } else if (auto *v = dynamic_cast<const VarDeclAST*>(s)) {
+            if (v->init) expr(v->init);
+            declared.push_back(v->name);
+        } else if (auto *a = dynamic_cast<const AssignStmtAST*>(s)) {
+            if (!local(a->name)) assigned.push_back(a->name);
+            expr(a->value);
+        } else if (auto *i = dynamic_cast<const IfStmtAST*>(s)) {
+            expr(i->cond);
+            body(i->thenBody);
+            body(i->elseBody);
+        } else if (auto *f = dynamic_cast<const ForStmtAST*>(s)) {
+            expr(f->start);
+            expr(f->end);
+            // The loop variable is scoped to the loop; Lets in it are not
+            size_t at = declared.size();
+            declared.push_back(f->var);
+            body(f->body);
+            declared.erase(declared.begin() + at);
+        } else if (auto *w = dynamic_cast<const WhileStmtAST*>(s)) {
+            expr(w->cond);
+            body(w->body);
+        } else if (auto *p = dynamic_cast<const PrintStmtAST*>(s)) {
+            expr(p->expr);
+        } else if (auto *r = dynamic_cast<const ReturnStmtAST*>(s)) {
+            expr(r->expr);
+        } else if (auto *m = dynamic_cast<const MatchStmtAST*>(s)) {
+            expr(m->expr);
+            for (auto *c : m->cases) {
+                if (c->pattern) expr(c->pattern);
+                if (c->high) expr(c->high);
+                body(c->body);
+            }
+        }
+    }
+
+    void body(const ArenaList<StmtAST*> &stmts) {
+        for (auto *s : stmts) stmt(s);
+    }
+};
+
+} // namespace
+
+// --- Bounds checks ---
+// Get and Set read the {data, count} header and index `data` directly;
+// Size reads `count`.
+// An index outside [0, count) reads 0 and drops the write, as the runtime
+// functions do, unless the range analysis below has proven it in bounds.
+//
+// The analysis looks at counted loops `For i = c..Size(s) - k` (c >= 0,
+// k >= 1) whose body neither assigns `s` nor, for a List, calls anything
+// that resizes a List (any List: another variable may hold the same one).
+// Since the bounds are evaluated once, i + d is in bounds for the whole
+// loop whenever c + d >= 0 and d < k, so Get(s, i), Get(s, i + 1) in
+// `For i = 0..Size(s) - 2` and the like need no check (see InBoundsFact).
+// The checks that remain are loop-invariant whenever their index is:
+// header loads carry their own TBAA type, so element stores don't clobber
+// them, and an Array's header never changes (!invariant.load), so LICM
+// hoists the length load and the comparison out of the loop.
+
+static MDNode* tbaaTag(CodegenContext &cg, StringRef type) {
+    MDBuilder md(cg.ctx());
+    MDNode* root = md.createTBAARoot("Strict TBAA");
+    MDNode* scalar = md.createTBAAScalarTypeNode(type, root);
+    return md.createTBAAStructTagNode(scalar, scalar, 0);
+}
 
-    if (op == "<") {
-        Value* cmp = Builder.CreateICmpSLT(L, R, "cmptmp");
-        return Builder.CreateZExt(cmp, Type::getInt32Ty(TheContext), "booltmp");
+// Loop variable plus constant: `i`, `i + d`, `d + i`, `i - d`
+static bool affineIndex(ExprAST* e, Symbol &var, int64_t &offset) {
+    if (auto *v = dynamic_cast<VarExprAST*>(e)) {
+        var = v->name;
+        offset = 0;
+        return true;
     }
-    if (op == ">") {
-        Value* cmp = Builder.CreateICmpSGT(L, R, "cmptmp");
-        return Builder.CreateZExt(cmp, Type::getInt32Ty(TheContext), "booltmp");
+    auto *bin = dynamic_cast<BinaryExprAST*>(e);
+    if (!bin || (bin->op != BinaryOp::Add && bin->op != BinaryOp::Sub)) return false;
+    auto *lv = dynamic_cast<VarExprAST*>(bin->lhs);
+    auto *rv = dynamic_cast<VarExprAST*>(bin->rhs);
+    auto *ln = dynamic_cast<NumberExprAST*>(bin->lhs);
+    auto *rn = dynamic_cast<NumberExprAST*>(bin->rhs);
+    if (lv && rn) {
+        var = lv->name;
+        offset = bin->op == BinaryOp::Add ? rn->value : -int64_t(rn->value);
+        return true;
+    }
+    if (ln && rv && bin->op == BinaryOp::Add) {
+        var = rv->name;
+        offset = ln->value;
+        return true;
+    }
+    return false;
+}
+
+static bool provenInBounds(CodegenContext &cg, ExprAST* seq, ExprAST* index) {
+    auto *s = dynamic_cast<VarExprAST*>(seq);
+    Symbol var;
+    int64_t offset;
+    if (!s || !affineIndex(index, var, offset)) return false;
+    auto seqIt = cg.namedValues.find(s->name);
+    auto varIt = cg.namedValues.find(var);
+    if (seqIt == cg.namedValues.end() || varIt == cg.namedValues.end()) return false;
+    for (const InBoundsFact &f : cg.inBounds)
+        if (f.index == varIt->second.slot && f.seq == seqIt->second.slot &&
+            f.low + offset >= 0 && offset <= f.slack)
+            return true;
+    return false;
+}
+
+// The sequence and slack of `For var = start..end` when the analysis
+// applies; see above
+static bool loopIndexBound(CodegenContext &cg, ExprAST* start, ExprAST* end,
+                           const ArenaList<StmtAST*> &body, InBoundsFact &fact, Symbol &seq) {
+    auto *low = dynamic_cast<NumberExprAST*>(start);
+    auto *bin = dynamic_cast<BinaryExprAST*>(end);
+    if (!low || low->value < 0 || !bin || bin->op != BinaryOp::Sub) return false;
+    auto *size = dynamic_cast<CallExprAST*>(bin->lhs);
+    auto *k = dynamic_cast<NumberExprAST*>(bin->rhs);
+    if (!size || !k || k->value < 1 || size->callee.str() != "Size" || size->args.size() != 1 ||
+        cg.module->getFunction("Size"))
+        return false;
+    auto *s = dynamic_cast<VarExprAST*>(size->args[0]);
+    if (!s) return false;
+    auto it = cg.namedValues.find(s->name);
+    if (it == cg.namedValues.end()) return false;
+    Type* T = it->second.type;
+    if (T != listType(cg) && T != arrayType(cg)) return false;
+
+    BodyEffects effects;
+    effects.body(body);
+    for (Symbol name : effects.assigned)
+        if (name == s->name) return false;
+    if (T == listType(cg)) {
+        for (Symbol callee : effects.calls)
+            for (const char *r : Resizing)
+                if (callee.str() == r) return false;
     }
-    if (op == "==") {
-        Value* cmp = Builder.CreateICmpEQ(L, R, "cmptmp");
-        return Builder.CreateZExt(cmp, Type::getInt32Ty(TheContext), "booltmp");
+    seq = s->name;
+    fact.low = low->value;
+    fact.slack = int64_t(k->value) - 1;
+    return true;
+}
+
+// Field 0 (data) or 1 (count) of a List's or Array's header
+static LoadInst* loadSeqHeader(CodegenContext &cg, Value* seq, unsigned field, const char *name) {
+    LLVMContext &ctx = cg.ctx();
+    Type* sizeTy = cg.builder.getIntPtrTy(cg.module->getDataLayout());
+    StructType* headerTy = StructType::get(ctx, {Type::getInt32PtrTy(ctx), sizeTy});
+    Value* header = cg.builder.CreateBitCast(seq, headerTy->getPointerTo(), "seq");
+    LoadInst* load = cg.builder.CreateLoad(headerTy->getElementType(field),
+                                           cg.builder.CreateStructGEP(headerTy, header, field), name);
+    load->setMetadata(LLVMContext::MD_tbaa, tbaaTag(cg, "strict header"));
+    if (seq->getType() == arrayType(cg))
+        load->setMetadata(LLVMContext::MD_invariant_load, MDNode::get(ctx, {}));
+    return load;
+}
+
+// Get (value == nullptr) or Set of seq[index]
+static Value* emitSeqAccess(CodegenContext &cg, Value* seq, Value* index, Value* value, bool checked) {
+    LLVMContext &ctx = cg.ctx();
+    Type* i32 = Type::getInt32Ty(ctx);
+    Type* sizeTy = cg.builder.getIntPtrTy(cg.module->getDataLayout());
+    Value* idx = cg.builder.CreateSExt(index, sizeTy, "idx");
+    auto access = [&]() -> Value* {
+        Value* data = loadSeqHeader(cg, seq, 0, "data");
+        Value* slot = cg.builder.CreateInBoundsGEP(i32, data, idx, "elem");
+        Instruction* I = value ? static_cast<Instruction*>(cg.builder.CreateStore(value, slot))
+                               : cg.builder.CreateLoad(i32, slot, "elem.val");
+        I->setMetadata(LLVMContext::MD_tbaa, tbaaTag(cg, "int"));
+        return I;
+    };
+    if (!checked) {
+        Value* loaded = access();
+        return value ? ConstantInt::get(i32, 0) : loaded;
     }
 
-    return logError("Unknown binary operator: " + op);
+    Function* F = cg.builder.GetInsertBlock()->getParent();
+    Value* count = loadSeqHeader(cg, seq, 1, "count");
+    Value* inside = cg.builder.CreateICmpULT(idx, count, "inbounds");
+    BasicBlock* from = cg.builder.GetInsertBlock();
+    BasicBlock* okBB = BasicBlock::Create(ctx, "bounds.ok", F);
+    BasicBlock* joinBB = BasicBlock::Create(ctx, "bounds.join", F);
+    cg.builder.CreateCondBr(inside, okBB, joinBB);
+    cg.builder.SetInsertPoint(okBB);
+    Value* loaded = access();
+    cg.builder.CreateBr(joinBB);
+    cg.builder.SetInsertPoint(joinBB);
+    if (value) return ConstantInt::get(i32, 0);
+    PHINode* phi = cg.builder.CreatePHI(i32, 2, "get");
+    phi->addIncoming(loaded, okBB);
+    phi->addIncoming(ConstantInt::get(i32, 0), from);
+    return phi;
+}
+
+static bool builtinAccepts(CodegenContext &cg, BuiltinArg kind, Type* T) {
+    switch (kind) {
+        case BA::Int:
+        case BA::Index: return T == Type::getInt32Ty(cg.ctx());
+        case BA::List: return T == listType(cg);
+        case BA::Array: return T == arrayType(cg);
+        case BA::Seq: return T == listType(cg) || T == arrayType(cg);
+    }
+    return false;
 }
 
-Value* CallExprAST::codegen() {
-    Function* calleeF = TheModule->getFunction(callee);
-    if (!calleeF) return logError("Unknown function: " + callee);
+// Builtins without a result yield 0, so every call is an expression
+static Value* codegenBuiltin(CodegenContext &cg, Symbol name, const ArenaList<ExprAST*> &args) {
+    std::vector<Value*> values;
+    for (auto *arg : args) {
+        Value* v = arg->codegen(cg);
+        if (!v) return nullptr;
+        values.push_back(v);
+    }
+    const Builtin* b = nullptr;
+    for (const Builtin &candidate : Builtins) {
+        if (name.str() != candidate.name || candidate.args.size() != values.size()) continue;
+        bool fits = true;
+        for (size_t k = 0; k < values.size() && fits; k++)
+            fits = builtinAccepts(cg, candidate.args[k], values[k]->getType());
+        if (fits) {
+            b = &candidate;
+            break;
+        }
+    }
+    if (!b) return logError(cg, "Invalid arguments to " + name.string());
+    if (b->lowering == BuiltinLowering::Count)
+        return cg.builder.CreateTrunc(loadSeqHeader(cg, values[0], 1, "count"), Type::getInt32Ty(cg.ctx()));
+    if (b->lowering != BuiltinLowering::Call) {
+        bool checked = !provenInBounds(cg, args[0], args[1]);
+        return emitSeqAccess(cg, values[0], values[1],
+                             b->lowering == BuiltinLowering::Store ? values[2] : nullptr, checked);
+    }
+
+    Type* i32 = Type::getInt32Ty(cg.ctx());
+    Type* sizeTy = cg.builder.getIntPtrTy(cg.module->getDataLayout());
+    std::vector<Type*> types;
+    for (size_t k = 0; k < values.size(); k++) {
+        if (b->args[k] == BA::Index)
+            values[k] = cg.builder.CreateSExt(values[k], sizeTy);
+        else if (b->args[k] == BA::Seq)
+            values[k] = cg.builder.CreateBitCast(values[k], Type::getInt8PtrTy(cg.ctx()));
+        types.push_back(values[k]->getType());
+    }
+
+    Type* resultTy = b->result == BR::None ? Type::getVoidTy(cg.ctx())
+                   : b->result == BR::Int ? i32
+                   : b->result == BR::Size ? sizeTy
+                   : b->result == BR::List ? static_cast<Type*>(listType(cg))
+                   : arrayType(cg);
+    FunctionCallee fn = cg.module->getOrInsertFunction(
+        b->runtime, FunctionType::get(resultTy, types, false));
+    Value* call = cg.builder.CreateCall(fn, values);
+    switch (b->result) {
+        case BR::None: return ConstantInt::get(i32, 0);
+        case BR::Size: return cg.builder.CreateTrunc(call, i32);
+        default: return call;
+    }
+}
+
+Value* CallExprAST::codegen(CodegenContext &cg) {
+    Function* calleeF = cg.module->getFunction(callee.str());
+    if (!calleeF) {
+        if (isBuiltin(callee)) return codegenBuiltin(cg, callee, args);
+        return logError(cg, "Unknown function: " + callee.string());
+    }
 
     std::vector<Value*> argsV;
     for (auto *arg : args) {
-        Value* a = arg->codegen();
+        Value* a = arg->codegen(cg);
+        if (!a) return nullptr;
+        argsV.push_back(a);
+    }
+
+    return cg.builder.CreateCall(calleeF, argsV, "calltmp");
+}
+
+// `<f>.future(i8* frame)`: unpacks f's arguments from frame[1..n], calls f
+// and stores the result in frame[0]. One per callee and module.
+static Function* futureThunk(CodegenContext &cg, Function* callee, ArrayType* frameTy) {
+    std::string name = callee->getName().str() + ".future";
+    if (Function* F = cg.module->getFunction(name)) return F;
+    Type* i32 = Type::getInt32Ty(cg.ctx());
+    FunctionType* thunkTy = FunctionType::get(Type::getVoidTy(cg.ctx()), {Type::getInt8PtrTy(cg.ctx())}, false);
+    Function* thunk = Function::Create(thunkTy, Function::InternalLinkage, name, cg.module.get());
+    thunk->getArg(0)->setName("frame");
+
+    IRBuilderBase::InsertPointGuard guard(cg.builder);
+    cg.builder.SetInsertPoint(BasicBlock::Create(cg.ctx(), "entry", thunk));
+    Value* frame = cg.builder.CreateBitCast(thunk->getArg(0), frameTy->getPointerTo(), "slots");
+    std::vector<Value*> args;
+    for (unsigned k = 1; k <= callee->arg_size(); k++)
+        args.push_back(cg.builder.CreateLoad(i32, cg.builder.CreateConstInBoundsGEP2_32(frameTy, frame, 0, k)));
+    Value* result = cg.builder.CreateCall(callee, args, "result");
+    cg.builder.CreateStore(result, cg.builder.CreateConstInBoundsGEP2_32(frameTy, frame, 0, 0));
+    cg.builder.CreateRetVoid();
+    return thunk;
+}
+
+// The arguments are evaluated here, in the caller, into a frame of i32s
+// [result, args...] that __future_spawn copies into a pooled task record
+Value* FutureExprAST::codegen(CodegenContext &cg) {
+    Function* calleeF = cg.module->getFunction(call->callee.str());
+    if (!calleeF) return logError(cg, "Unknown function: " + call->callee.string());
+    if (calleeF->arg_size() != call->args.size())
+        return logError(cg, "Wrong number of arguments to " + call->callee.string());
+
+    Type* i32 = Type::getInt32Ty(cg.ctx());
+    std::vector<Value*> argsV;
+    for (auto *arg : call->args) {
+        Value* a = arg->codegen(cg);
         if (!a) return nullptr;
+        if (a->getType() != i32) return logError(cg, "Future arguments must be integers");
         argsV.push_back(a);
     }
 
-    return Builder.CreateCall(calleeF, argsV, "calltmp");
+    ArrayType* frameTy = ArrayType::get(i32, argsV.size() + 1);
+    Function* thunk = futureThunk(cg, calleeF, frameTy);
+    Function* F = cg.builder.GetInsertBlock()->getParent();
+    AllocaInst* frame = createEntryAlloca(F, frameTy, "future.frame");
+    for (unsigned k = 0; k < argsV.size(); k++)
+        cg.builder.CreateStore(argsV[k], cg.builder.CreateConstInBoundsGEP2_32(frameTy, frame, 0, k + 1));
+
+    PointerType* i8p = Type::getInt8PtrTy(cg.ctx());
+    FunctionCallee spawn = cg.module->getOrInsertFunction(
+        "__future_spawn", futureType(cg), thunk->getType(), i8p, i32);
+    Value* size = ConstantInt::get(i32, 4 * (argsV.size() + 1));
+    return cg.builder.CreateCall(spawn, {thunk, cg.builder.CreateBitCast(frame, i8p), size}, "future");
+}
+
+Value* SyncExprAST::codegen(CodegenContext &cg) {
+    Value* f = future->codegen(cg);
+    if (!f) return nullptr;
+    if (f->getType() != futureType(cg)) return logError(cg, "Sync expects a Future");
+    FunctionCallee sync = cg.module->getOrInsertFunction(
+        "__future_sync", Type::getInt32Ty(cg.ctx()), futureType(cg));
+    return cg.builder.CreateCall(sync, {f}, "sync");
+}
+
+Value* InputExprAST::codegen(CodegenContext &cg) {
+    FunctionCallee input = cg.module->getOrInsertFunction("strict_input", Type::getInt32Ty(cg.ctx()));
+    return cg.builder.CreateCall(input, {}, "input");
 }
 
 // === Statement Codegen ===
 
-Value* ExprStmtAST::codegen() {
-    return expr->codegen();
+// Emits a statement list, stopping at the first terminator (code after a
+// Return is unreachable and would otherwise follow a terminator).
+static void codegenBlock(CodegenContext &cg, const ArenaList<StmtAST*> &body) {
+    for (auto *s : body) {
+        if (cg.builder.GetInsertBlock()->getTerminator()) break;
+        s->codegen(cg);
+    }
+}
+
+Value* ExprStmtAST::codegen(CodegenContext &cg) {
+    return expr->codegen(cg);
 }
 
-Value* VarDeclAST::codegen() {
-    Value* initVal = init ? init->codegen()
-                          : ConstantInt::get(Type::getInt32Ty(TheContext), 0);
-    AllocaInst* alloc = Builder.CreateAlloca(Type::getInt32Ty(TheContext), 0, name.c_str());
-    Builder.CreateStore(initVal, alloc);
-    NamedValues[name] = alloc;
+Value* VarDeclAST::codegen(CodegenContext &cg) {
+    Value* initVal = init ? init->codegen(cg) : nullptr;
+    if (!initVal)
+        initVal = ConstantInt::get(Type::getInt32Ty(cg.ctx()), 0);
+
+    // The slot takes the initializer's type, so strings live in ptr slots
+    Function* F = cg.builder.GetInsertBlock()->getParent();
+    AllocaInst* alloc = createEntryAlloca(F, initVal->getType(), name.str());
+    cg.builder.CreateStore(initVal, alloc);
+    cg.namedValues[name] = {alloc, initVal->getType()};
     return alloc;
 }
 
-Value* IfStmtAST::codegen() {
-    Value* condV = cond->codegen();
+Value* AssignStmtAST::codegen(CodegenContext &cg) {
+    auto it = cg.namedValues.find(name);
+    if (it == cg.namedValues.end())
+        return logError(cg, "Assignment to undeclared variable: " + name.string());
+    const Variable var = it->second;
+    if (cg.loopVariables.count(var.slot))
+        return logError(cg, "Cannot assign to loop variable: " + name.string());
+    Value* val = value->codegen(cg);
+    if (!val) return nullptr;
+    if (val->getType() != var.type)
+        return logError(cg, "Assignment changes the type of " + name.string());
+    return cg.builder.CreateStore(val, var.slot);
+}
+
+Value* IfStmtAST::codegen(CodegenContext &cg) {
+    Value* condV = cond->codegen(cg);
     if (!condV) return nullptr;
 
-    condV = Builder.CreateICmpNE(condV,
-                                 ConstantInt::get(Type::getInt32Ty(TheContext), 0),
+    condV = cg.builder.CreateICmpNE(condV,
+                                 Constant::getNullValue(condV->getType()),
                                  "ifcond");
 
-    Function* parentF = Builder.GetInsertBlock()->getParent();
+    Function* parentF = cg.builder.GetInsertBlock()->getParent();
 
-    BasicBlock* thenBB = BasicBlock::Create(TheContext, "then", parentF);
-    BasicBlock* elseBB = BasicBlock::Create(TheContext, "else");
-    BasicBlock* mergeBB = BasicBlock::Create(TheContext, "ifcont");
+    BasicBlock* thenBB = BasicBlock::Create(cg.ctx(), "then", parentF);
+    BasicBlock* elseBB = BasicBlock::Create(cg.ctx(), "else");
+    BasicBlock* mergeBB = BasicBlock::Create(cg.ctx(), "ifcont");
 
-    Builder.CreateCondBr(condV, thenBB, elseBB);
+    cg.builder.CreateCondBr(condV, thenBB, elseBB);
 
     // Then
-    Builder.SetInsertPoint(thenBB);
-    for (auto *s : thenBody) s->codegen();
-    Builder.CreateBr(mergeBB);
-    thenBB = Builder.GetInsertBlock();
+    cg.builder.SetInsertPoint(thenBB);
+    codegenBlock(cg, thenBody);
+    if (!cg.builder.GetInsertBlock()->getTerminator())
+        cg.builder.CreateBr(mergeBB);
 
     // Else
     parentF->getBasicBlockList().push_back(elseBB);
-    Builder.SetInsertPoint(elseBB);
-    for (auto *s : elseBody) s->codegen();
-    Builder.CreateBr(mergeBB);
-    elseBB = Builder.GetInsertBlock();
+    cg.builder.SetInsertPoint(elseBB);
+    codegenBlock(cg, elseBody);
+    if (!cg.builder.GetInsertBlock()->getTerminator())
+        cg.builder.CreateBr(mergeBB);
 
     // Merge
     parentF->getBasicBlockList().push_back(mergeBB);
-    Builder.SetInsertPoint(mergeBB);
+    cg.builder.SetInsertPoint(mergeBB);
+
+    return nullptr;
+}
+
+// === Loops ===
+// Both loop forms are emitted the way LoopSimplify would leave them: a
+// dedicated preheader, a single latch holding the back edge, and dedicated
+// exits. The back edge carries the loop's llvm.loop metadata.
+
+// Self-referential loop ID with the program's hints. `accesses` is the
+// access group of a Parallel For's memory operations.
+static MDNode* loopMetadata(CodegenContext &cg, const LoopHints &hints, bool counted,
+                            MDNode* accesses) {
+    LLVMContext &ctx = cg.ctx();
+    auto flag = [&](const char* name) -> Metadata* {
+        return MDNode::get(ctx, MDString::get(ctx, name));
+    };
+    auto value = [&](const char* name, Constant* v) -> Metadata* {
+        return MDNode::get(ctx, {MDString::get(ctx, name), ConstantAsMetadata::get(v)});
+    };
+    Type* i32 = Type::getInt32Ty(ctx);
+
+    SmallVector<Metadata*, 6> ops = {nullptr};
+    // A counted loop always terminates
+    if (counted) ops.push_back(flag("llvm.loop.mustprogress"));
+    if (hints.unroll == 0) ops.push_back(flag("llvm.loop.unroll.enable"));
+    if (hints.unroll == 1) ops.push_back(flag("llvm.loop.unroll.disable"));
+    if (hints.unroll > 1) ops.push_back(value("llvm.loop.unroll.count", ConstantInt::get(i32, hints.unroll)));
+    if (hints.vectorize == 1) {
+        ops.push_back(value("llvm.loop.vectorize.width", ConstantInt::get(i32, 1)));
+    } else if (hints.vectorize >= 0 || hints.parallel) {
+        ops.push_back(value("llvm.loop.vectorize.enable", ConstantInt::getTrue(ctx)));
+        if (hints.vectorize > 1)
+            ops.push_back(value("llvm.loop.vectorize.width", ConstantInt::get(i32, hints.vectorize)));
+    }
+    if (accesses)
+        ops.push_back(MDNode::get(ctx, {MDString::get(ctx, "llvm.loop.parallel_accesses"), accesses}));
+    if (ops.size() == 1) return nullptr;
+
+    MDNode* id = MDNode::getDistinct(ctx, ops);
+    id->replaceOperandWith(0, id);
+    return id;
+}
+
+// Counted loop over [startV, endV] with `var` bound to the induction slot.
+// `seq`, when given, is the sequence `var` indexes by loopIndexBound.
+static void emitCountedLoop(CodegenContext &cg, Symbol var, Value* startV, Value* endV,
+                            const ArenaList<StmtAST*> &body, const LoopHints &hints,
+                            const Symbol* seq = nullptr, InBoundsFact fact = {}) {
+    Type* i32 = Type::getInt32Ty(cg.ctx());
+    Function* F = cg.builder.GetInsertBlock()->getParent();
+    AllocaInst* slot = createEntryAlloca(F, i32, var.str());
+    cg.builder.CreateStore(startV, slot);
+
+    BasicBlock* preheader = BasicBlock::Create(cg.ctx(), "for.preheader", F);
+    BasicBlock* bodyBB = BasicBlock::Create(cg.ctx(), "for.body", F);
+    BasicBlock* latchBB = BasicBlock::Create(cg.ctx(), "for.latch");
+    BasicBlock* exitBB = BasicBlock::Create(cg.ctx(), "for.exit");
+    BasicBlock* endBB = BasicBlock::Create(cg.ctx(), "for.end");
+
+    // The range is inclusive; an empty one skips the loop, so the latch
+    // can test before incrementing and never overflows at INT_MAX
+    cg.builder.CreateCondBr(cg.builder.CreateICmpSLE(startV, endV, "for.guard"), preheader, endBB);
+    cg.builder.SetInsertPoint(preheader);
+    cg.builder.CreateBr(bodyBB);
+
+    // The variable is scoped to the body and read-only there, so the slot
+    // is the loop's only induction variable
+    auto outer = cg.namedValues.find(var);
+    bool shadows = outer != cg.namedValues.end();
+    Variable shadowed = shadows ? outer->second : Variable();
+    cg.namedValues[var] = {slot, i32};
+    cg.loopVariables.insert(slot);
+    // Looked up after binding `var`, which may shadow the sequence
+    auto seqIt = seq ? cg.namedValues.find(*seq) : cg.namedValues.end();
+    bool bounded = seqIt != cg.namedValues.end();
+    if (bounded) {
+        fact.index = slot;
+        fact.seq = seqIt->second.slot;
+        cg.inBounds.push_back(fact);
+    }
+
+    cg.builder.SetInsertPoint(bodyBB);
+    codegenBlock(cg, body);
+    if (!cg.builder.GetInsertBlock()->getTerminator())
+        cg.builder.CreateBr(latchBB);
+
+    if (bounded) cg.inBounds.pop_back();
+    cg.loopVariables.erase(slot);
+    if (shadows) cg.namedValues[var] = shadowed;
+    else cg.namedValues.erase(var);
+
+    // Parallel For: every memory access of the body joins one access
+    // group, declared free of loop-carried dependences
+    MDNode* accesses = nullptr;
+    if (hints.parallel) {
+        accesses = MDNode::getDistinct(cg.ctx(), {});
+        for (auto it = bodyBB->getIterator(); it != F->end(); ++it) {
+            for (Instruction &I : *it)
+                if (I.mayReadOrWriteMemory())
+                    I.setMetadata(LLVMContext::MD_access_group, accesses);
+        }
+    }
+
+    F->getBasicBlockList().push_back(latchBB);
+    cg.builder.SetInsertPoint(latchBB);
+    Value* iv = cg.builder.CreateLoad(i32, slot, var.str());
+    Value* more = cg.builder.CreateICmpSLT(iv, endV, "for.more");
+    cg.builder.CreateStore(cg.builder.CreateAdd(iv, ConstantInt::get(i32, 1), "for.next",
+                                                false, /*HasNSW=*/true), slot);
+    BranchInst* backedge = cg.builder.CreateCondBr(more, bodyBB, exitBB);
+    if (MDNode* id = loopMetadata(cg, hints, true, accesses))
+        backedge->setMetadata(LLVMContext::MD_loop, id);
+
+    F->getBasicBlockList().push_back(exitBB);
+    cg.builder.SetInsertPoint(exitBB);
+    cg.builder.CreateBr(endBB);
+
+    F->getBasicBlockList().push_back(endBB);
+    cg.builder.SetInsertPoint(endBB);
+}
+
+// Parallel For: the loop is outlined into
+//   void <parent>.parfor(i8* env, i32 lo, i32 hi)
+// which runs iterations [lo, hi], and the runtime's work-stealing pool
+// calls it on chunks of the range (see __parallel_for in runtime.c). `env`
+// holds pointers to the parent's variables the body uses, so it reads and
+// writes them exactly as the serial loop would.
+static void emitParallelFor(CodegenContext &cg, Symbol var, Value* startV, Value* endV,
+                            const ArenaList<StmtAST*> &body, const LoopHints &hints,
+                            const Symbol* seq, InBoundsFact fact) {
+    LLVMContext &ctx = cg.ctx();
+    Type* i32 = Type::getInt32Ty(ctx);
+    PointerType* i8p = Type::getInt8PtrTy(ctx);
+    Function* parent = cg.builder.GetInsertBlock()->getParent();
+    FunctionType* bodyTy = FunctionType::get(Type::getVoidTy(ctx), {i8p, i32, i32}, false);
+    Function* outlined = Function::Create(bodyTy, Function::InternalLinkage,
+                                          parent->getName() + ".parfor", cg.module.get());
+    Argument* envArg = outlined->getArg(0);
+    envArg->setName("env");
+    outlined->getArg(1)->setName("lo");
+    outlined->getArg(2)->setName("hi");
+
+    // Every visible variable gets an env slot, in a stable order; the ones
+    // the body never touches are dropped again below
+    std::vector<std::pair<Symbol, Variable>> captures(cg.namedValues.begin(), cg.namedValues.end());
+    std::sort(captures.begin(), captures.end(),
+              [](const auto &a, const auto &b) { return a.first < b.first; });
+    ArrayType* envTy = ArrayType::get(i8p, captures.size());
+
+    std::vector<Instruction*> refs;
+    {
+        IRBuilderBase::InsertPointGuard guard(cg.builder);
+        std::unordered_map<Symbol, Variable> outerScope = cg.namedValues;
+        std::unordered_set<Value*> outerLoops = cg.loopVariables;
+        cg.builder.SetInsertPoint(BasicBlock::Create(ctx, "entry", outlined));
+        Value* env = cg.builder.CreateBitCast(envArg, envTy->getPointerTo(), "env.slots");
+        for (size_t k = 0; k < captures.size(); k++) {
+            const auto &[name, outer] = captures[k];
+            Value* field = cg.builder.CreateConstInBoundsGEP2_32(envTy, env, 0, unsigned(k));
+            Value* raw = cg.builder.CreateLoad(i8p, field);
+            Value* ref = cg.builder.CreateBitCast(raw, outer.type->getPointerTo(), name.str() + ".ref");
+            refs.push_back(cast<Instruction>(ref));
+            cg.namedValues[name] = {ref, outer.type};
+            if (outerLoops.count(outer.slot)) cg.loopVariables.insert(ref);
+        }
+
+        // Chunks lie within the range, so the range's facts hold for them
+        emitCountedLoop(cg, var, outlined->getArg(1), outlined->getArg(2), body, hints, seq, fact);
+        if (!cg.builder.GetInsertBlock()->getTerminator())
+            cg.builder.CreateRetVoid();
+
+        cg.namedValues.swap(outerScope);
+        cg.loopVariables.swap(outerLoops);
+    }
 
+    Value* env = ConstantPointerNull::get(i8p);
+    if (!captures.empty()) {
+        AllocaInst* slots = createEntryAlloca(parent, envTy, "parfor.env");
+        for (size_t k = 0; k < captures.size(); k++) {
+            Instruction* ref = refs[k];
+            if (ref->use_empty()) {
+                // bitcast <- load <- gep, erased in use order
+                auto* raw = cast<Instruction>(ref->getOperand(0));
+                auto* field = dyn_cast<Instruction>(raw->getOperand(0));
+                ref->eraseFromParent();
+                raw->eraseFromParent();
+                if (field && field->use_empty()) field->eraseFromParent();
+                continue;
+            }
+            Value* field = cg.builder.CreateConstInBoundsGEP2_32(envTy, slots, 0, unsigned(k));
+            cg.builder.CreateStore(cg.builder.CreateBitCast(captures[k].second.slot, i8p), field);
+        }
+        env = cg.builder.CreateBitCast(slots, i8p, "parfor.envp");
+    }
+    verifyFunction(*outlined, &errs());
+
+    FunctionCallee run = cg.module->getOrInsertFunction(
+        "__parallel_for", Type::getVoidTy(ctx), i32, i32, bodyTy->getPointerTo(), i8p);
+    cg.builder.CreateCall(run, {startV, endV, outlined, env});
+}
+
+Value* ForStmtAST::codegen(CodegenContext &cg) {
+    // Bounds are evaluated once, before the loop: the trip count is known
+    // on entry
+    Value* startV = start->codegen(cg);
+    Value* endV = end->codegen(cg);
+    if (!startV || !endV) return nullptr;
+    Type* i32 = Type::getInt32Ty(cg.ctx());
+    if (startV->getType() != i32 || endV->getType() != i32)
+        return logError(cg, "For bounds must be integers");
+
+    // Every iteration of a Parallel For writes an enclosing-scope variable
+    // through the same env slot, so assigning one is a data race
+    if (hints.parallel) {
+        BodyEffects effects;
+        effects.declared.push_back(var);
+        effects.body(body);
+        for (Symbol name : effects.assigned)
+            if (cg.namedValues.count(name))
+                return logError(cg, "Parallel For body assigns '" + name.string() +
+                                    "' of the enclosing scope; its iterations would race on it");
+    }
+
+    Symbol seq;
+    InBoundsFact fact;
+    const Symbol* bound = loopIndexBound(cg, start, end, body, fact, seq) ? &seq : nullptr;
+    if (hints.parallel)
+        emitParallelFor(cg, var, startV, endV, body, hints, bound, fact);
+    else
+        emitCountedLoop(cg, var, startV, endV, body, hints, bound, fact);
+    return nullptr;
+}
+
+Value* WhileStmtAST::codegen(CodegenContext &cg) {
+    Function* F = cg.builder.GetInsertBlock()->getParent();
+    BasicBlock* condBB = BasicBlock::Create(cg.ctx(), "while.cond", F);
+    BasicBlock* bodyBB = BasicBlock::Create(cg.ctx(), "while.body");
+    BasicBlock* endBB = BasicBlock::Create(cg.ctx(), "while.end");
+
+    cg.builder.CreateBr(condBB);
+    cg.builder.SetInsertPoint(condBB);
+    Value* condV = cond->codegen(cg);
+    if (!condV) return nullptr;
+    condV = cg.builder.CreateICmpNE(condV, Constant::getNullValue(condV->getType()), "whilecond");
+    cg.builder.CreateCondBr(condV, bodyBB, endBB);
+
+    F->getBasicBlockList().push_back(bodyBB);
+    cg.builder.SetInsertPoint(bodyBB);
+    codegenBlock(cg, body);
+    if (!cg.builder.GetInsertBlock()->getTerminator()) {
+        BranchInst* backedge = cg.builder.CreateBr(condBB);
+        if (MDNode* id = loopMetadata(cg, hints, false, nullptr))
+            backedge->setMetadata(LLVMContext::MD_loop, id);
+    }
+
+    F->getBasicBlockList().push_back(endBB);
+    cg.builder.SetInsertPoint(endBB);
     return nullptr;
 }
 
-Value* PrintStmtAST::codegen() {
-    Function* printFn = TheModule->getFunction("strict_print");
-    if (!printFn) {
-        FunctionType* FT = FunctionType::get(Type::getVoidTy(TheContext),
-                                             {Type::getInt8PtrTy(TheContext)}, false);
-        printFn = Function::Create(FT, Function::ExternalLinkage,
-                                   "strict_print", TheModule.get());
+// === Match ===
+// Cases are tried in order and the first match wins. When every pattern is
+// a literal the tests go away entirely:
+//  - integer cases are flattened into disjoint intervals of the subject
+//    (an earlier case shadows a later one). Runs of small, dense intervals
+//    become one `switch`, which LLVM lowers to a jump table; everything else
+//    is found by a binary search over interval bounds;
+//  - string cases switch on an FNV-1a hash of the subject, computed inline
+//    together with its length, and confirm a hit with a length check and
+//    memcmp.
+// Any other pattern falls back to testing the cases one after another.
+
+namespace {
+
+constexpr int64_t MaxSwitchInterval = 64;   // widest interval a switch spells out
+constexpr int64_t MaxSwitchValues = 1024;   // case values per switch
+constexpr int64_t MinSwitchDensity = 40;    // % of a switch's span that must be covered
+
+// Subject values [lo, hi] that run one case body
+struct MatchInterval {
+    int64_t lo, hi;
+    BasicBlock* target;
+};
+
+// A leaf of the search: one interval, or a dense run of them as a switch
+struct MatchItem {
+    size_t first, last;     // intervals [first, last]
+    bool isSwitch;
+};
+
+// Integer literals, possibly negated or combined with + - *, wrapped to
+// i32 like the arithmetic they stand for
+bool foldConstant(const ExprAST* e, int64_t &out) {
+    if (auto *num = dynamic_cast<const NumberExprAST*>(e)) {
+        out = num->value;
+        return true;
+    }
+    if (auto *un = dynamic_cast<const UnaryExprAST*>(e)) {
+        if (un->op != UnaryOp::Neg || !foldConstant(un->expr, out)) return false;
+        out = int32_t(uint32_t(-out));
+        return true;
+    }
+    if (auto *bin = dynamic_cast<const BinaryExprAST*>(e)) {
+        int64_t l, r;
+        if (!foldConstant(bin->lhs, l) || !foldConstant(bin->rhs, r)) return false;
+        switch (bin->op) {
+            case BinaryOp::Add: out = l + r; break;
+            case BinaryOp::Sub: out = l - r; break;
+            case BinaryOp::Mul: out = l * r; break;
+            default: return false;
+        }
+        out = int32_t(uint32_t(out));
+        return true;
+    }
+    return false;
+}
+
+// Subject values an integer-literal case covers; false if it has none
+bool caseInterval(const CaseAST* c, int64_t &lo, int64_t &hi) {
+    int64_t v = 0;
+    foldConstant(c->pattern, v);
+    switch (c->kind) {
+        case CaseKind::Value:     lo = hi = v; break;
+        case CaseKind::Range:     lo = v; foldConstant(c->high, hi); break;
+        case CaseKind::Less:      lo = INT32_MIN; hi = v - 1; break;
+        case CaseKind::LessEq:    lo = INT32_MIN; hi = v; break;
+        case CaseKind::Greater:   lo = v + 1; hi = INT32_MAX; break;
+        case CaseKind::GreaterEq: lo = v; hi = INT32_MAX; break;
+        case CaseKind::Default:   lo = INT32_MIN; hi = INT32_MAX; break;
+    }
+    return lo <= hi;
+}
+
+// Gives `target` the part of [lo, hi] no earlier case took. `taken` stays
+// sorted and disjoint.
+void claim(std::vector<MatchInterval> &taken, int64_t lo, int64_t hi, BasicBlock* target) {
+    std::vector<MatchInterval> gaps;
+    int64_t next = lo;
+    for (const MatchInterval &t : taken) {
+        if (t.hi < next) continue;
+        if (t.lo > hi) break;
+        if (t.lo > next) gaps.push_back({next, t.lo - 1, target});
+        next = t.hi + 1;
+        if (next > hi) break;
     }
-    Value* strVal = expr->codegen();
-    return Builder.CreateCall(printFn, {strVal});
+    if (next <= hi) gaps.push_back({next, hi, target});
+    taken.insert(taken.end(), gaps.begin(), gaps.end());
+    std::sort(taken.begin(), taken.end(),
+              [](const MatchInterval &a, const MatchInterval &b) { return a.lo < b.lo; });
 }
 
-Value* ReturnStmtAST::codegen() {
-    Value* val = expr->codegen();
-    return Builder.CreateRet(val);
+class IntMatchLowering {
+    CodegenContext &cg;
+    Value* subject;
+    BasicBlock* fallback;
+    std::vector<MatchInterval> intervals;
+    std::vector<MatchItem> items;
+
+    static int64_t width(const MatchInterval &m) { return m.hi - m.lo + 1; }
+    Constant* constant(int64_t v) { return ConstantInt::get(subject->getType(), uint64_t(v)); }
+
+public:
+    IntMatchLowering(CodegenContext &c, Value* x, BasicBlock* other,
+                     std::vector<MatchInterval> taken)
+        : cg(c), subject(x), fallback(other) {
+        // Neighbours that run the same body become one interval
+        for (const MatchInterval &m : taken) {
+            if (!intervals.empty() && intervals.back().target == m.target &&
+                intervals.back().hi + 1 == m.lo) {
+                intervals.back().hi = m.hi;
+            } else {
+                intervals.push_back(m);
+            }
+        }
+
+        // Greedily grow each switch while the covered values stay dense
+        for (size_t i = 0; i < intervals.size(); i++) {
+            size_t j = i;
+            if (width(intervals[i]) <= MaxSwitchInterval) {
+                int64_t values = width(intervals[i]);
+                while (j + 1 < intervals.size()) {
+                    const MatchInterval &next = intervals[j + 1];
+                    int64_t grown = values + width(next);
+                    int64_t span = next.hi - intervals[i].lo + 1;
+                    if (width(next) > MaxSwitchInterval || grown > MaxSwitchValues ||
+                        grown * 100 < span * MinSwitchDensity)
+                        break;
+                    values = grown;
+                    j++;
+                }
+            }
+            items.push_back({i, j, j > i});
+            i = j;
+        }
+    }
+
+    void emit() {
+        if (items.empty()) {
+            cg.builder.CreateBr(fallback);
+            return;
+        }
+        tree(0, items.size(), INT32_MIN, INT32_MAX);
+    }
+
+private:
+    // Dispatches among items [l, r), knowing the subject is in [knownLo, knownHi]
+    void tree(size_t l, size_t r, int64_t knownLo, int64_t knownHi) {
+        if (r - l == 1) {
+            leaf(items[l], knownLo, knownHi);
+            return;
+        }
+        size_t mid = l + (r - l) / 2;
+        int64_t pivot = intervals[items[mid].first].lo;
+        Function* F = cg.builder.GetInsertBlock()->getParent();
+        BasicBlock* below = BasicBlock::Create(cg.ctx(), "match.lt", F);
+        BasicBlock* above = BasicBlock::Create(cg.ctx(), "match.ge", F);
+        cg.builder.CreateCondBr(cg.builder.CreateICmpSLT(subject, constant(pivot)), below, above);
+        cg.builder.SetInsertPoint(below);
+        tree(l, mid, knownLo, pivot - 1);
+        cg.builder.SetInsertPoint(above);
+        tree(mid, r, pivot, knownHi);
+    }
+
+    void leaf(const MatchItem &item, int64_t knownLo, int64_t knownHi) {
+        if (item.isSwitch) {
+            SwitchInst* sw = cg.builder.CreateSwitch(subject, fallback);
+            for (size_t i = item.first; i <= item.last; i++) {
+                const MatchInterval &m = intervals[i];
+                for (int64_t v = m.lo; v <= m.hi; v++)
+                    sw->addCase(cast<ConstantInt>(constant(v)), m.target);
+            }
+            return;
+        }
+
+        // Only the bounds the search has not already established are tested
+        const MatchInterval &m = intervals[item.first];
+        bool checkLo = m.lo > knownLo;
+        bool checkHi = m.hi < knownHi;
+        Value* in;
+        if (!checkLo && !checkHi) {
+            cg.builder.CreateBr(m.target);
+            return;
+        } else if (m.lo == m.hi) {
+            in = cg.builder.CreateICmpEQ(subject, constant(m.lo), "match.eq");
+        } else if (checkLo && checkHi) {
+            Value* offset = cg.builder.CreateSub(subject, constant(m.lo), "match.off");
+            in = cg.builder.CreateICmpULE(offset, constant(m.hi - m.lo), "match.in");
+        } else if (checkLo) {
+            in = cg.builder.CreateICmpSGE(subject, constant(m.lo), "match.in");
+        } else {
+            in = cg.builder.CreateICmpSLE(subject, constant(m.hi), "match.in");
+        }
+        cg.builder.CreateCondBr(in, m.target, fallback);
+    }
+};
+
+uint32_t fnv1a32(std::string_view s) {
+    uint32_t h = 2166136261u;
+    for (unsigned char c : s) {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+FunctionCallee declareLibc(CodegenContext &cg, const char* name, Type* sizeTy) {
+    Type* i8p = Type::getInt8PtrTy(cg.ctx());
+    std::vector<Type*> params = {i8p, i8p};
+    if (sizeTy) params.push_back(sizeTy);
+    FunctionType* FT = FunctionType::get(Type::getInt32Ty(cg.ctx()), params, false);
+    return cg.module->getOrInsertFunction(name, FT);
+}
+
+// `cases` holds each distinct string literal with its body, first case first
+void lowerStringMatch(CodegenContext &cg, Value* subject,
+                      const std::vector<std::pair<std::string_view, BasicBlock*>> &cases,
+                      BasicBlock* fallback) {
+    LLVMContext &ctx = cg.ctx();
+    Type* i8 = Type::getInt8Ty(ctx);
+    Type* i32 = Type::getInt32Ty(ctx);
+    Type* i64 = Type::getInt64Ty(ctx);
+    Function* F = cg.builder.GetInsertBlock()->getParent();
+
+    // Hash and length of the subject in one pass over its bytes
+    BasicBlock* pre = cg.builder.GetInsertBlock();
+    BasicBlock* loop = BasicBlock::Create(ctx, "match.hash", F);
+    BasicBlock* step = BasicBlock::Create(ctx, "match.hash.step", F);
+    BasicBlock* done = BasicBlock::Create(ctx, "match.hash.done", F);
+    cg.builder.CreateBr(loop);
+
+    cg.builder.SetInsertPoint(loop);
+    PHINode* index = cg.builder.CreatePHI(i64, 2, "match.len");
+    PHINode* hash = cg.builder.CreatePHI(i32, 2, "match.h");
+    index->addIncoming(ConstantInt::get(i64, 0), pre);
+    hash->addIncoming(ConstantInt::get(i32, 2166136261u), pre);
+    Value* byte = cg.builder.CreateLoad(i8, cg.builder.CreateGEP(i8, subject, index), "match.c");
+    cg.builder.CreateCondBr(cg.builder.CreateICmpEQ(byte, ConstantInt::get(i8, 0)), done, step);
+
+    cg.builder.SetInsertPoint(step);
+    Value* mixed = cg.builder.CreateXor(hash, cg.builder.CreateZExt(byte, i32));
+    hash->addIncoming(cg.builder.CreateMul(mixed, ConstantInt::get(i32, 16777619u)), step);
+    index->addIncoming(cg.builder.CreateAdd(index, ConstantInt::get(i64, 1)), step);
+    cg.builder.CreateBr(loop);
+
+    // One switch arm per hash value; colliding literals are confirmed in order
+    cg.builder.SetInsertPoint(done);
+    SwitchInst* sw = cg.builder.CreateSwitch(hash, fallback);
+    std::map<uint32_t, std::vector<size_t>> buckets;
+    for (size_t i = 0; i < cases.size(); i++)
+        buckets[fnv1a32(cases[i].first)].push_back(i);
+
+    FunctionCallee memcmpFn = declareLibc(cg, "memcmp", i64);
+    for (auto &bucket : buckets) {
+        BasicBlock* test = BasicBlock::Create(ctx, "match.str", F);
+        sw->addCase(ConstantInt::get(cast<IntegerType>(i32), bucket.first), test);
+        for (size_t k = 0; k < bucket.second.size(); k++) {
+            const auto &c = cases[bucket.second[k]];
+            BasicBlock* miss = k + 1 < bucket.second.size()
+                             ? BasicBlock::Create(ctx, "match.str", F) : fallback;
+            cg.builder.SetInsertPoint(test);
+            Value* sameLen = cg.builder.CreateICmpEQ(index, ConstantInt::get(i64, c.first.size()));
+            if (c.first.empty()) {
+                cg.builder.CreateCondBr(sameLen, c.second, miss);
+            } else {
+                BasicBlock* bytes = BasicBlock::Create(ctx, "match.memcmp", F);
+                cg.builder.CreateCondBr(sameLen, bytes, miss);
+                cg.builder.SetInsertPoint(bytes);
+                Value* literal = cg.builder.CreateGlobalStringPtr(c.first, "str");
+                Value* cmp = cg.builder.CreateCall(memcmpFn,
+                    {subject, literal, ConstantInt::get(i64, c.first.size())});
+                cg.builder.CreateCondBr(cg.builder.CreateICmpEQ(cmp, ConstantInt::get(i32, 0)),
+                                        c.second, miss);
+            }
+            test = miss;
+        }
+    }
 }
 
-Value* FuncDeclAST::codegen() {
-    std::vector<Type*> paramTypes(params.size(), Type::getInt32Ty(TheContext));
-    FunctionType* FT = FunctionType::get(Type::getInt32Ty(TheContext),
+// One case's test, for patterns that are not all literals
+Value* caseTest(CodegenContext &cg, Value* subject, const CaseAST* c) {
+    Value* v = c->pattern->codegen(cg);
+    if (!v) return nullptr;
+    if (v->getType() != subject->getType())
+        return logError(cg, "Case pattern does not match the type of the Match subject");
+
+    if (subject->getType()->isPointerTy()) {
+        if (c->kind != CaseKind::Value)
+            return logError(cg, "String cases can only match a value");
+        FunctionCallee strcmpFn = declareLibc(cg, "strcmp", nullptr);
+        Value* cmp = cg.builder.CreateCall(strcmpFn, {subject, v});
+        return cg.builder.CreateICmpEQ(cmp, ConstantInt::get(cmp->getType(), 0), "match.eq");
+    }
+
+    switch (c->kind) {
+        case CaseKind::Value:     return cg.builder.CreateICmpEQ(subject, v, "match.eq");
+        case CaseKind::Less:      return cg.builder.CreateICmpSLT(subject, v, "match.lt");
+        case CaseKind::LessEq:    return cg.builder.CreateICmpSLE(subject, v, "match.le");
+        case CaseKind::Greater:   return cg.builder.CreateICmpSGT(subject, v, "match.gt");
+        case CaseKind::GreaterEq: return cg.builder.CreateICmpSGE(subject, v, "match.ge");
+        case CaseKind::Range: {
+            Value* h = c->high->codegen(cg);
+            if (!h) return nullptr;
+            if (h->getType() != subject->getType())
+                return logError(cg, "Case pattern does not match the type of the Match subject");
+            return cg.builder.CreateAnd(cg.builder.CreateICmpSGE(subject, v),
+                                        cg.builder.CreateICmpSLE(subject, h), "match.in");
+        }
+        case CaseKind::Default: break;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+Value* MatchStmtAST::codegen(CodegenContext &cg) {
+    Value* subject = expr->codegen(cg);
+    if (!subject) return nullptr;
+    // List, Array and Future handles are pointers too, but not strings
+    bool isString = subject->getType() == Type::getInt8PtrTy(cg.ctx());
+    bool isInt = subject->getType()->isIntegerTy(32);
+    if (!isString && !isInt)
+        return logError(cg, "Match expects an integer or a string");
+
+    Function* F = cg.builder.GetInsertBlock()->getParent();
+    BasicBlock* endBB = BasicBlock::Create(cg.ctx(), "matchend");
+
+    // Cases after the first `Case *` can never run
+    std::vector<BasicBlock*> bodies;
+    BasicBlock* fallback = endBB;
+    for (auto *c : cases) {
+        bodies.push_back(BasicBlock::Create(cg.ctx(), "case"));
+        if (c->kind == CaseKind::Default) {
+            fallback = bodies.back();
+            break;
+        }
+    }
+    size_t tested = fallback == endBB ? bodies.size() : bodies.size() - 1;
+
+    bool literal = true;
+    for (size_t i = 0; i < tested; i++) {
+        const CaseAST* c = cases[i];
+        int64_t v;
+        if (isString) {
+            literal &= c->kind == CaseKind::Value &&
+                       dynamic_cast<const StringExprAST*>(c->pattern) != nullptr;
+        } else {
+            literal &= foldConstant(c->pattern, v) &&
+                       (c->kind != CaseKind::Range || foldConstant(c->high, v));
+        }
+    }
+
+    if (literal && isInt) {
+        std::vector<MatchInterval> taken;
+        for (size_t i = 0; i < tested; i++) {
+            int64_t lo = 0, hi = 0;
+            if (caseInterval(cases[i], lo, hi)) claim(taken, lo, hi, bodies[i]);
+        }
+        IntMatchLowering(cg, subject, fallback, std::move(taken)).emit();
+    } else if (literal) {
+        std::vector<std::pair<std::string_view, BasicBlock*>> strings;
+        for (size_t i = 0; i < tested; i++) {
+            std::string_view s = static_cast<const StringExprAST*>(cases[i]->pattern)->value;
+            bool shadowed = false;
+            for (auto &seen : strings) shadowed |= seen.first == s;
+            if (!shadowed) strings.push_back({s, bodies[i]});
+        }
+        lowerStringMatch(cg, subject, strings, fallback);
+    } else {
+        for (size_t i = 0; i < tested; i++) {
+            Value* hit = caseTest(cg, subject, cases[i]);
+            if (!hit) return nullptr;
+            BasicBlock* next = BasicBlock::Create(cg.ctx(), "match.next", F);
+            cg.builder.CreateCondBr(hit, bodies[i], next);
+            cg.builder.SetInsertPoint(next);
+        }
+        cg.builder.CreateBr(fallback);
+    }
+
+    // Bodies in source order; ones no value reaches are dropped
+    for (size_t i = 0; i < bodies.size(); i++) {
+        BasicBlock* bb = bodies[i];
+        if (pred_empty(bb)) {
+            delete bb;
+            continue;
+        }
+        F->getBasicBlockList().push_back(bb);
+        cg.builder.SetInsertPoint(bb);
+        codegenBlock(cg, cases[i]->body);
+        if (!cg.builder.GetInsertBlock()->getTerminator())
+            cg.builder.CreateBr(endBB);
+    }
+
+    F->getBasicBlockList().push_back(endBB);
+    cg.builder.SetInsertPoint(endBB);
+    return nullptr;
+}
+
+// Literals go to strict_print_str with their length and integers to
+// strict_print_i32, so neither pays for strlen or formatting; other
+// strings to strict_print
+Value* PrintStmtAST::codegen(CodegenContext &cg) {
+    Type* voidTy = Type::getVoidTy(cg.ctx());
+    Type* i32 = Type::getInt32Ty(cg.ctx());
+    PointerType* i8p = Type::getInt8PtrTy(cg.ctx());
+    Value* val = expr->codegen(cg);
+    if (!val) return nullptr;
+    if (auto *lit = dynamic_cast<StringExprAST*>(expr)) {
+        if (lit->value.size() <= size_t(INT_MAX)) {
+            FunctionCallee fn = cg.module->getOrInsertFunction("strict_print_str", voidTy, i8p, i32);
+            return cg.builder.CreateCall(fn, {val, ConstantInt::get(i32, lit->value.size())});
+        }
+    }
+    if (val->getType() == i32) {
+        FunctionCallee fn = cg.module->getOrInsertFunction("strict_print_i32", voidTy, i32);
+        return cg.builder.CreateCall(fn, {val});
+    }
+    if (val->getType() != i8p)
+        return logError(cg, "Print expects a string or an integer");
+    FunctionCallee fn = cg.module->getOrInsertFunction("strict_print", voidTy, i8p);
+    return cg.builder.CreateCall(fn, {val});
+}
+
+Value* ReturnStmtAST::codegen(CodegenContext &cg) {
+    Value* val = expr->codegen(cg);
+    if (!val) return nullptr;
+    Type* retTy = cg.builder.GetInsertBlock()->getParent()->getReturnType();
+    if (val->getType() != retTy)
+        return logError(cg, "Return value does not match the function's return type");
+    return cg.builder.CreateRet(val);
+}
+
+// Creates (or returns the already-declared) LLVM function for this Func,
+// so calls can be emitted before the definition is reached.
+Function* FuncDeclAST::prototype(CodegenContext &cg) {
+    auto it = cg.functions.find(name);
+    if (it != cg.functions.end())
+        return it->second;
+
+    std::vector<Type*> paramTypes(params.size(), Type::getInt32Ty(cg.ctx()));
+    FunctionType* FT = FunctionType::get(Type::getInt32Ty(cg.ctx()),
                                          paramTypes, false);
     Function* F = Function::Create(FT, Function::ExternalLinkage,
-                                   name, TheModule.get());
-    FunctionTable[name] = F;
+                                   name.str(), cg.module.get());
+    unsigned idx = 0;
+    for (auto &arg : F->args())
+        arg.setName(params[idx++].str());
+    cg.functions[name] = F;
+    return F;
+}
 
-    BasicBlock* BB = BasicBlock::Create(TheContext, "entry", F);
-    Builder.SetInsertPoint(BB);
+Value* FuncDeclAST::codegen(CodegenContext &cg) {
+    Function* F = prototype(cg);
+    if (!F->empty())
+        return logError(cg, "Redefinition of function: " + name.string());
+
+    // Function bodies get their own scope and must not disturb the
+    // enclosing insertion point (top-level code continues in main).
+    IRBuilderBase::InsertPointGuard guard(cg.builder);
+    std::unordered_map<Symbol, Variable> outerScope;
+    outerScope.swap(cg.namedValues);
+
+    BasicBlock* BB = BasicBlock::Create(cg.ctx(), "entry", F);
+    cg.builder.SetInsertPoint(BB);
 
     unsigned idx = 0;
     for (auto &arg : F->args()) {
-        AllocaInst* alloc = Builder.CreateAlloca(Type::getInt32Ty(TheContext), 0, params[idx].c_str());
-        Builder.CreateStore(&arg, alloc);
-        NamedValues[params[idx]] = alloc;
+        AllocaInst* alloc = cg.builder.CreateAlloca(Type::getInt32Ty(cg.ctx()), 0, params[idx].str());
+        cg.builder.CreateStore(&arg, alloc);
+        cg.namedValues[params[idx]] = {alloc, Type::getInt32Ty(cg.ctx())};
         idx++;
     }
 
-    for (auto *s : body) s->codegen();
+    codegenBlock(cg, body);
 
-    verifyFunction(*F);
+    // Falling off the end of a Func returns 0
+    if (!cg.builder.GetInsertBlock()->getTerminator())
+        cg.builder.CreateRet(ConstantInt::get(Type::getInt32Ty(cg.ctx()), 0));
+
+    verifyFunction(*F, &errs());
+    cg.namedValues.swap(outerScope);
     return F;
 }
 
-Value* ProgramAST::codegen() {
-    TheModule = std::make_unique<Module>("strict", TheContext);
+Value* ClassDeclAST::codegen(CodegenContext &cg) {
+    return logError(cg, "Class is not supported yet");
+}
 
+static void declareRuntime(CodegenContext &cg) {
     // Prototype for runtime input
-    FunctionType* inFT = FunctionType::get(Type::getInt32Ty(TheContext), false);
+    FunctionType* inFT = FunctionType::get(Type::getInt32Ty(cg.ctx()), false);
     Function::Create(inFT, Function::ExternalLinkage,
-                     "strict_input", TheModule.get());
+                     "strict_input", cg.module.get());
 
     // Prototype for runtime print
-    FunctionType* printFT = FunctionType::get(Type::getVoidTy(TheContext),
-                                              {Type::getInt8PtrTy(TheContext)}, false);
+    FunctionType* printFT = FunctionType::get(Type::getVoidTy(cg.ctx()),
+                                              {Type::getInt8PtrTy(cg.ctx())}, false);
     Function::Create(printFT, Function::ExternalLinkage,
-                     "strict_print", TheModule.get());
+                     "strict_print", cg.module.get());
+}
+
+// Top-level statements form the body of `int main()`. With `definitions`
+// false, top-level Funcs and Classes are left to their own units.
+static Function* codegenMain(CodegenContext &cg, const std::vector<StmtAST*> &statements,
+                             bool definitions) {
+    FunctionType* mainFT = FunctionType::get(Type::getInt32Ty(cg.ctx()), false);
+    Function* mainF = Function::Create(mainFT, Function::ExternalLinkage,
+                                       "main", cg.module.get());
+    cg.builder.SetInsertPoint(BasicBlock::Create(cg.ctx(), "entry", mainF));
 
     // Generate program body
     for (auto *s : statements) {
-        s->codegen();
+        bool isDefinition = dynamic_cast<FuncDeclAST*>(s) || dynamic_cast<ClassDeclAST*>(s);
+        if (isDefinition && !definitions) continue;
+        // After a top-level Return only Func definitions still matter
+        if (cg.builder.GetInsertBlock()->getTerminator() && !dynamic_cast<FuncDeclAST*>(s))
+            continue;
+        s->codegen(cg);
     }
 
-    return nullptr;
+    if (!cg.builder.GetInsertBlock()->getTerminator())
+        cg.builder.CreateRet(ConstantInt::get(Type::getInt32Ty(cg.ctx()), 0));
+    verifyFunction(*mainF, &errs());
+    return mainF;
+}
+
+bool ProgramAST::codegen() {
+    this->cg = std::make_unique<CodegenContext>();
+    CodegenContext &cg = *this->cg;
+    declareRuntime(cg);
+
+    // Declare every Func up front so calls may precede definitions
+    for (auto *s : statements) {
+        if (auto *fn = dynamic_cast<FuncDeclAST*>(s))
+            fn->prototype(cg);
+    }
+
+    codegenMain(cg, statements, true);
+    return cg.errors.empty();
+}
+
+bool codegenUnit(ProgramAST &program, const CodegenUnit &unit, CodegenContext &cg) {
+    declareRuntime(cg);
+    for (FuncDeclAST *fn : unit.declared) fn->prototype(cg);
+    for (FuncDeclAST *fn : unit.inlineable) fn->prototype(cg);
+    for (StmtAST *s : unit.definitions) {
+        if (auto *fn = dynamic_cast<FuncDeclAST*>(s))
+            fn->prototype(cg);
+    }
+
+    for (FuncDeclAST *fn : unit.inlineable) {
+        fn->codegen(cg);
+        cg.functions[fn->name]->setLinkage(GlobalValue::AvailableExternallyLinkage);
+    }
+    for (StmtAST *s : unit.definitions) s->codegen(cg);
+    if (unit.hasMain) codegenMain(cg, program.statements, false);
+    return cg.errors.empty();
+}
+
+// === Profiling ===
+
+void instrumentProfile(Module &M) {
+    LLVMContext &ctx = M.getContext();
+    FunctionCallee enter = M.getOrInsertFunction("__prof_enter", Type::getVoidTy(ctx),
+                                                 Type::getInt8PtrTy(ctx));
+    FunctionCallee exit = M.getOrInsertFunction("__prof_exit", Type::getVoidTy(ctx));
+    IRBuilder<> builder(ctx);
+    for (Function &F : M) {
+        if (F.isDeclaration() || F.hasLocalLinkage()) continue;
+        // After the entry block's allocas, which must stay together
+        BasicBlock &entry = F.getEntryBlock();
+        BasicBlock::iterator at = entry.begin();
+        while (isa<AllocaInst>(*at)) ++at;
+        builder.SetInsertPoint(&entry, at);
+        builder.CreateCall(enter, {builder.CreateGlobalStringPtr(F.getName(), "prof.name")});
+        for (BasicBlock &BB : F) {
+            if (auto *ret = dyn_cast<ReturnInst>(BB.getTerminator())) {
+                builder.SetInsertPoint(ret);
+                builder.CreateCall(exit, {});
+            }
+        }
+    }
 }
 
 // === Emit LLVM IR to file ===
@@ -215,5 +1473,23 @@ void ProgramAST::emitIR(const std::string &filename) {
         errs() << "Could not open file: " << EC.message();
         return;
     }
-    TheModule->print(dest, nullptr);
+    cg->module->print(dest, nullptr);
+}
+
+llvm::Module* ProgramAST::getModule() {
+    return cg ? cg->module.get() : nullptr;
 }
+
+std::unique_ptr<llvm::Module> ProgramAST::takeModule(std::unique_ptr<llvm::LLVMContext> &context) {
+    if (!cg) return nullptr;
+    std::unique_ptr<llvm::Module> module = std::move(cg->module);
+    context = std::move(cg->context);
+    cg.reset();
+    return module;
+}
+
+// Out of line: CodegenContext is incomplete where ProgramAST is declared
+ProgramAST::ProgramAST() = default;
+ProgramAST::ProgramAST(ProgramAST &&) = default;
+ProgramAST &ProgramAST::operator=(ProgramAST &&) = default;
+ProgramAST::~ProgramAST() = default;
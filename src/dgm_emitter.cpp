@@ -1,73 +1,929 @@
 #include "dgm.hpp"
+#include "parallel.hpp"
+#include "regalloc.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <unordered_map>
-
-// === DGM → NASM instruction map ===
-// NOTE: This is a small working subset. The full 144 entries
-// should be included for production, but we wire the core ones here.
-static std::unordered_map<std::string, std::string> NasmMap = {
-    {"17 add",  "add rax, rbx"},
-    {"18 sub",  "sub rax, rbx"},
-    {"19 mul",  "imul rax, rbx"},
-    {"1B sdiv", "idiv rbx"},
-    {"15 icmp", "cmp rax, rbx"},
-    {"30 br",   "jmp"},
-    {"2B call", "call"},
-    {"33 ret",  "ret"},
-    {"01 alloca","sub rsp, 8"},
-    {"02 load", "mov rax, [rbx]"},
-    {"03 store","mov [rax], rbx"}
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_set>
+
+// === DGM → NASM lowering ===
+// Each function is decoded, register-allocated (see regalloc.hpp) and then
+// lowered instruction by instruction against the assigned locations.
+// Compares feeding a branch become cmp + jcc, phis become parallel moves on
+// their incoming edges, and allocas become fixed rbp-relative slots.
+// Dense switches jump through a table; sparse ones compare case by case.
+
+#ifdef _WIN32
+static const X86ABI &TargetABI = Win64ABI;
+static const bool TargetELF = false;
+#else
+static const X86ABI &TargetABI = SysVABI;
+static const bool TargetELF = true;
+#endif
+
+namespace {
+
+// A switch gets a jump table from this many cases on, when they cover at
+// least MinJumpTableDensity percent of a span of at most MaxJumpTableSpan
+constexpr size_t MinJumpTableCases = 4;
+constexpr int64_t MinJumpTableDensity = 40;
+constexpr int64_t MaxJumpTableSpan = 4096;
+
+const char *sizeName(unsigned bits) {
+    switch (bits) {
+        case 8: return "byte";
+        case 16: return "word";
+        case 32: return "dword";
+        default: return "qword";
+    }
+}
+
+// Condition code for an icmp predicate (LLVM numbering, eq = 32 .. sle = 41)
+const char *condCode(int64_t pred, bool negate = false) {
+    static const char *const Codes[10] = {"e", "ne", "a", "ae", "b", "be", "g", "ge", "l", "le"};
+    static const char *const Negated[10] = {"ne", "e", "be", "b", "ae", "a", "le", "l", "ge", "g"};
+    if (pred < 32 || pred > 41) return negate ? "e" : "ne";
+    return negate ? Negated[pred - 32] : Codes[pred - 32];
+}
+
+bool fitsImm32(int64_t v) { return v >= INT32_MIN && v <= INT32_MAX; }
+
+// Arithmetic runs at 32 bits for anything narrower
+unsigned opBits(DGMType t) { return dgmTypeBits(t) < 32 ? 32 : dgmTypeBits(t); }
+
+struct MoveSrc {
+    enum Kind { Loc, Imm, Symbol } kind;
+    ValueLocation loc;
+    int64_t imm = 0;
+    uint32_t symbol = 0;
 };
 
-// === Emit NASM Assembly ===
-void emitDGMtoNASM(const std::string &dgmFile, const std::string &nasmFile) {
-    std::ifstream in(dgmFile);
-    if (!in.is_open()) {
-        std::cerr << "Error: cannot open " << dgmFile << "\n";
+struct Move {
+    ValueLocation dst;  // Reg or Slot
+    MoveSrc src;
+};
+
+class FunctionLowering {
+    const DGMReader &dgm;
+    const DGMFunctionBody &fn;
+    const X86ABI &abi;
+    const RegAllocation &ra;
+    std::ostream &out;
+    std::set<std::string> &referenced;
+    const std::unordered_set<std::string_view> &defined;   // functions in this file
+    uint32_t frameSize = 0;
+    unsigned edges = 0;
+    unsigned tables = 0;
+    std::ostringstream trampolines;
+    std::vector<uint32_t> blockValue;   // first value number defined in each block
+    std::string error;                  // the first instruction that cannot be lowered
+
+    void unsupported(const std::string &what) {
+        if (error.empty()) error = std::string(dgm.string(fn.entry.name)) + ": cannot lower " + what;
+    }
+
+    const ValueLocation &loc(const DGMOperand &op) const { return ra.values[op.value]; }
+
+    DGMType typeOf(const DGMOperand &op) const {
+        return op.kind == DGMOperandKind::Value ? fn.valueTypes[op.value] : DGMType::I32;
+    }
+
+    std::string symbol(uint32_t offset) {
+        std::string name(dgm.string(offset));
+        referenced.insert(name);
+        return "$" + name;
+    }
+
+    static std::string slot(int32_t offset, unsigned bits) {
+        std::string s = std::string(sizeName(bits)) + " [rbp";
+        if (offset < 0) s += std::to_string(offset);
+        else if (offset > 0) s += "+" + std::to_string(offset);
+        return s + "]";
+    }
+
+    static bool sameLoc(const ValueLocation &a, const ValueLocation &b) {
+        if (a.kind != b.kind) return false;
+        if (a.kind == ValueLocation::Reg) return a.reg == b.reg;
+        return a.offset == b.offset;
+    }
+
+    static std::string blockLabel(uint32_t b) { return ".B" + std::to_string(b); }
+
+    void emit(const std::string &text) { out << "    " << text << "\n"; }
+
+    // Puts an operand in a register at the given width
+    void materialize(X86Reg dst, const MoveSrc &src, unsigned bits) {
+        unsigned w = bits < 32 ? 32 : bits;
+        switch (src.kind) {
+            case MoveSrc::Imm:
+                emit("mov " + std::string(x86RegName(dst, w)) + ", " + std::to_string(src.imm));
+                return;
+            case MoveSrc::Symbol:
+                emit("lea " + std::string(x86RegName(dst, 64)) + ", [rel " + symbol(src.symbol) + "]");
+                return;
+            case MoveSrc::Loc:
+                break;
+        }
+        const ValueLocation &l = src.loc;
+        switch (l.kind) {
+            case ValueLocation::Reg:
+                if (l.reg != dst)
+                    emit("mov " + std::string(x86RegName(dst, w)) + ", " + x86RegName(l.reg, w));
+                break;
+            case ValueLocation::Slot:
+                if (bits < 32)
+                    emit("movzx " + std::string(x86RegName(dst, 32)) + ", " + slot(l.offset, bits));
+                else
+                    emit("mov " + std::string(x86RegName(dst, w)) + ", " + slot(l.offset, w));
+                break;
+            case ValueLocation::Frame:
+                emit("lea " + std::string(x86RegName(dst, 64)) + ", [rbp" +
+                     std::to_string(l.offset) + "]");
+                break;
+            case ValueLocation::None:
+                emit("xor " + std::string(x86RegName(dst, 32)) + ", " + x86RegName(dst, 32));
+                break;
+        }
+    }
+
+    MoveSrc source(const DGMOperand &op) const {
+        MoveSrc s{MoveSrc::Imm, {}, 0, 0};
+        if (op.kind == DGMOperandKind::Value) {
+            s.kind = MoveSrc::Loc;
+            s.loc = loc(op);
+        } else if (op.kind == DGMOperandKind::Symbol) {
+            s.kind = MoveSrc::Symbol;
+            s.symbol = uint32_t(op.value);
+        } else {
+            s.imm = op.value;
+        }
+        return s;
+    }
+
+    void materialize(X86Reg dst, const DGMOperand &op, unsigned bits) {
+        materialize(dst, source(op), bits);
+    }
+
+    // Operand as a register, memory or (if allowed) immediate text. Anything
+    // else is first loaded into `scratch`.
+    std::string rm(const DGMOperand &op, unsigned bits, X86Reg scratch, bool allowImm = true) {
+        if (op.kind == DGMOperandKind::Imm && allowImm && fitsImm32(op.value))
+            return std::to_string(op.value);
+        if (op.kind == DGMOperandKind::Value) {
+            const ValueLocation &l = loc(op);
+            if (l.kind == ValueLocation::Reg) return x86RegName(l.reg, bits);
+            if (l.kind == ValueLocation::Slot) return slot(l.offset, bits);
+        }
+        materialize(scratch, op, bits);
+        return x86RegName(scratch, bits);
+    }
+
+    // Memory operand addressed by a pointer operand
+    std::string address(const DGMOperand &ptr, X86Reg scratch) {
+        if (ptr.kind == DGMOperandKind::Symbol) return "[rel " + symbol(uint32_t(ptr.value)) + "]";
+        if (ptr.kind == DGMOperandKind::Value) {
+            const ValueLocation &l = loc(ptr);
+            if (l.kind == ValueLocation::Frame) return "[rbp" + std::to_string(l.offset) + "]";
+            if (l.kind == ValueLocation::Reg) return "[" + std::string(x86RegName(l.reg, 64)) + "]";
+        }
+        materialize(scratch, ptr, 64);
+        return "[" + std::string(x86RegName(scratch, 64)) + "]";
+    }
+
+    // Writes a register into a value's location
+    void assign(const ValueLocation &dst, X86Reg src, unsigned bits) {
+        unsigned w = bits < 32 ? 32 : bits;
+        if (dst.kind == ValueLocation::Reg && dst.reg != src)
+            emit("mov " + std::string(x86RegName(dst.reg, w)) + ", " + x86RegName(src, w));
+        else if (dst.kind == ValueLocation::Slot)
+            emit("mov " + slot(dst.offset, 64) + ", " + x86RegName(src, 64));
+    }
+
+    X86Reg target(const ValueLocation &dst, X86Reg fallback) const {
+        return dst.kind == ValueLocation::Reg ? dst.reg : fallback;
+    }
+
+    void move(const Move &m) {
+        if (m.dst.kind == ValueLocation::Reg) {
+            materialize(m.dst.reg, m.src, 64);
+        } else if (m.src.kind == MoveSrc::Imm && fitsImm32(m.src.imm)) {
+            emit("mov " + slot(m.dst.offset, 64) + ", " + std::to_string(m.src.imm));
+        } else if (m.src.kind == MoveSrc::Loc && m.src.loc.kind == ValueLocation::Reg) {
+            emit("mov " + slot(m.dst.offset, 64) + ", " + x86RegName(m.src.loc.reg, 64));
+        } else {
+            materialize(R11, m.src, 64);
+            emit("mov " + slot(m.dst.offset, 64) + ", r11");
+        }
+    }
+
+    // Performs all moves as if simultaneously; cycles go through r10
+    void parallelMove(std::vector<Move> moves) {
+        auto reads = [](const Move &m, const ValueLocation &l) {
+            return m.src.kind == MoveSrc::Loc && sameLoc(m.src.loc, l);
+        };
+        moves.erase(std::remove_if(moves.begin(), moves.end(),
+                                   [&](const Move &m) { return reads(m, m.dst); }),
+                    moves.end());
+        while (!moves.empty()) {
+            bool progress = false;
+            for (size_t i = 0; i < moves.size(); i++) {
+                bool blocked = false;
+                for (size_t j = 0; j < moves.size() && !blocked; j++)
+                    blocked = j != i && reads(moves[j], moves[i].dst);
+                if (blocked) continue;
+                move(moves[i]);
+                moves.erase(moves.begin() + long(i));
+                progress = true;
+                break;
+            }
+            if (progress) continue;
+
+            ValueLocation saved = moves[0].dst;
+            ValueLocation r10;
+            r10.kind = ValueLocation::Reg;
+            r10.reg = R10;
+            move({r10, {MoveSrc::Loc, saved, 0, 0}});
+            for (Move &m : moves)
+                if (reads(m, saved)) m.src.loc = r10;
+        }
+    }
+
+    bool hasPhis(uint32_t b) const {
+        uint32_t first = fn.blockStart[b];
+        return first < fn.blockStart[b + 1] && static_cast<DGMOp>(fn.insts[first].op) == DGMOp::Phi;
+    }
+
+    std::vector<Move> edgeMoves(uint32_t from, uint32_t to) const {
+        std::vector<Move> moves;
+        uint32_t value = blockValue[to];
+        for (uint32_t k = fn.blockStart[to]; k < fn.blockStart[to + 1]; k++, value++) {
+            const DGMInst &phi = fn.insts[k];
+            if (static_cast<DGMOp>(phi.op) != DGMOp::Phi) break;
+            const ValueLocation &dst = ra.values[value];
+            if (dst.kind != ValueLocation::Reg && dst.kind != ValueLocation::Slot) continue;
+            for (size_t i = 0; i + 1 < phi.operands.size(); i += 2) {
+                if (uint32_t(phi.operands[i + 1].value) != from) continue;
+                moves.push_back({dst, source(phi.operands[i])});
+                break;
+            }
+        }
+        return moves;
+    }
+
+    // Label to jump to for the edge from → to; edges into phis get a stub
+    // that performs the moves first
+    std::string edgeLabel(uint32_t from, uint32_t to) {
+        if (!hasPhis(to)) return blockLabel(to);
+        std::string label = ".E" + std::to_string(edges++);
+        std::ostringstream body;
+        body << label << ":\n";
+        std::streambuf *saved = out.rdbuf(body.rdbuf());
+        parallelMove(edgeMoves(from, to));
+        emit("jmp " + blockLabel(to));
+        out.rdbuf(saved);
+        trampolines << body.str();
+        return label;
+    }
+
+    // Falls through or jumps to `to`, doing its phi moves inline
+    void jumpTo(uint32_t from, uint32_t to) {
+        if (hasPhis(to)) parallelMove(edgeMoves(from, to));
+        if (to != from + 1) emit("jmp " + blockLabel(to));
+    }
+
+    void epilogue() {
+        int32_t offset = 0;
+        for (unsigned r = 0; r < 16; r++) {
+            if (!(ra.calleeSavedUsed & regBit(X86Reg(r)))) continue;
+            offset -= 8;
+            emit("mov " + std::string(x86RegName(X86Reg(r), 64)) + ", " + slot(offset, 64));
+        }
+        emit("leave");
+        emit("ret");
+    }
+
+    void prologue();
+    void binary(const DGMInst &inst, const ValueLocation &dst, const char *mnemonic, bool commutative);
+    void division(const DGMInst &inst, const ValueLocation &dst);
+    void shift(const DGMInst &inst, const ValueLocation &dst, const char *mnemonic);
+    void cast(const DGMInst &inst, const ValueLocation &dst);
+    void compare(const DGMInst &inst);
+    bool jumpTable(const DGMInst &inst, uint32_t block);
+    void call(const DGMInst &inst, const ValueLocation &dst);
+    bool intrinsic(const DGMInst &inst, const ValueLocation &dst, std::string_view name);
+    void branch(const DGMInst &inst, uint32_t block, int64_t fusedPred);
+    void instruction(uint32_t k, uint32_t block, uint32_t value, int64_t &fusedPred);
+
+public:
+    FunctionLowering(const DGMReader &dgm, const DGMFunctionBody &fn, const X86ABI &abi,
+                     const RegAllocation &ra, std::ostream &out, std::set<std::string> &referenced,
+                     const std::unordered_set<std::string_view> &defined)
+        : dgm(dgm), fn(fn), abi(abi), ra(ra), out(out), referenced(referenced), defined(defined) {}
+
+    // False with `err` set if some instruction has no lowering
+    bool run(std::string &err);
+};
+
+void FunctionLowering::prologue() {
+    // Outgoing stack arguments sit above the shadow space at the bottom of
+    // the frame
+    unsigned maxStackArgs = 0;
+    for (const DGMInst &inst : fn.insts) {
+        if (static_cast<DGMOp>(inst.op) != DGMOp::Call || inst.operands.empty()) continue;
+        unsigned args = unsigned(inst.operands.size()) - 1;
+        if (args > abi.argRegCount) maxStackArgs = std::max(maxStackArgs, args - abi.argRegCount);
+    }
+    uint32_t outgoing = abi.shadowSpace + 8 * maxStackArgs;
+    frameSize = (ra.frameBytes + 15) / 16 * 16 + (outgoing + 15) / 16 * 16;
+
+    emit("push rbp");
+    emit("mov rbp, rsp");
+    if (frameSize) emit("sub rsp, " + std::to_string(frameSize));
+    int32_t offset = 0;
+    for (unsigned r = 0; r < 16; r++) {
+        if (!(ra.calleeSavedUsed & regBit(X86Reg(r)))) continue;
+        offset -= 8;
+        emit("mov " + slot(offset, 64) + ", " + x86RegName(X86Reg(r), 64));
+    }
+
+    // Incoming arguments: registers, then the caller's stack above the
+    // return address and its shadow space
+    std::vector<Move> moves;
+    for (uint32_t i = 0; i < fn.entry.argCount; i++) {
+        const ValueLocation &dst = ra.values[i];
+        if (dst.kind != ValueLocation::Reg && dst.kind != ValueLocation::Slot) continue;
+        MoveSrc src{MoveSrc::Loc, {}, 0, 0};
+        if (i < abi.argRegCount) {
+            src.loc.kind = ValueLocation::Reg;
+            src.loc.reg = abi.argRegs[i];
+        } else {
+            src.loc.kind = ValueLocation::Slot;
+            src.loc.offset = int32_t(16 + abi.shadowSpace + 8 * (i - abi.argRegCount));
+        }
+        moves.push_back({dst, src});
+    }
+    parallelMove(moves);
+}
+
+void FunctionLowering::binary(const DGMInst &inst, const ValueLocation &dst,
+                              const char *mnemonic, bool commutative) {
+    unsigned bits = opBits(inst.type);
+    DGMOperand a = inst.operands[0], b = inst.operands[1];
+    bool bInDst = b.kind == DGMOperandKind::Value && dst.kind == ValueLocation::Reg &&
+                  sameLoc(loc(b), dst);
+    if (bInDst && commutative) {
+        std::swap(a, b);
+        bInDst = false;
+    }
+    X86Reg t = bInDst ? R11 : target(dst, R11);
+    materialize(t, a, bits);
+
+    std::string tr = x86RegName(t, bits);
+    if (std::string(mnemonic) == "imul" && b.kind == DGMOperandKind::Imm && fitsImm32(b.value))
+        emit("imul " + tr + ", " + tr + ", " + std::to_string(b.value));
+    else
+        emit(std::string(mnemonic) + " " + tr + ", " + rm(b, bits, R10));
+    assign(dst, t, bits);
+}
+
+void FunctionLowering::division(const DGMInst &inst, const ValueLocation &dst) {
+    unsigned bits = opBits(inst.type);
+    DGMOp op = static_cast<DGMOp>(inst.op);
+    bool isSigned = op == DGMOp::SDiv || op == DGMOp::SRem;
+    const DGMOperand &b = inst.operands[1];
+
+    // The divisor must not be an immediate, nor live in rdx (cleared below)
+    std::string divisor;
+    if (b.kind == DGMOperandKind::Value && loc(b).kind == ValueLocation::Reg && loc(b).reg != RDX) {
+        divisor = x86RegName(loc(b).reg, bits);
+    } else if (b.kind == DGMOperandKind::Value && loc(b).kind == ValueLocation::Slot) {
+        divisor = slot(loc(b).offset, bits);
+    } else {
+        materialize(R11, b, bits);
+        divisor = x86RegName(R11, bits);
+    }
+
+    materialize(RAX, inst.operands[0], bits);
+    if (isSigned) emit(bits == 64 ? "cqo" : "cdq");
+    else emit("xor edx, edx");
+    emit(std::string(isSigned ? "idiv " : "div ") + divisor);
+    assign(dst, op == DGMOp::SDiv || op == DGMOp::UDiv ? RAX : RDX, bits);
+}
+
+void FunctionLowering::shift(const DGMInst &inst, const ValueLocation &dst, const char *mnemonic) {
+    unsigned bits = opBits(inst.type);
+    const DGMOperand &b = inst.operands[1];
+    if (b.kind == DGMOperandKind::Imm) {
+        X86Reg t = target(dst, R11);
+        materialize(t, inst.operands[0], bits);
+        emit(std::string(mnemonic) + " " + x86RegName(t, bits) + ", " +
+             std::to_string(b.value & (bits - 1)));
+        assign(dst, t, bits);
+        return;
+    }
+    materialize(R11, inst.operands[0], bits);
+    materialize(RCX, b, 32);
+    emit(std::string(mnemonic) + " " + x86RegName(R11, bits) + ", cl");
+    assign(dst, R11, bits);
+}
+
+void FunctionLowering::cast(const DGMInst &inst, const ValueLocation &dst) {
+    DGMOp op = static_cast<DGMOp>(inst.op);
+    const DGMOperand &a = inst.operands[0];
+    DGMType from = typeOf(a);
+    unsigned bits = opBits(inst.type);
+    X86Reg t = target(dst, R11);
+    std::string tr = x86RegName(t, bits);
+
+    if (a.kind == DGMOperandKind::Imm || from == DGMType::I1) {
+        materialize(t, a, bits);
+        if (op == DGMOp::SExt && from == DGMType::I1) emit("neg " + tr);
+    } else if (op == DGMOp::ZExt && dgmTypeBits(from) < 32) {
+        emit("movzx " + std::string(x86RegName(t, 32)) + ", " + rm(a, dgmTypeBits(from), R10, false));
+    } else if (op == DGMOp::SExt && dgmTypeBits(from) < 32) {
+        emit("movsx " + tr + ", " + rm(a, dgmTypeBits(from), R10, false));
+    } else if (op == DGMOp::SExt && from == DGMType::I32 && bits == 64) {
+        emit("movsxd " + tr + ", " + rm(a, 32, R10, false));
+    } else {
+        // zext from i32, trunc, and the pointer/bit casts: a plain move at
+        // the narrower width (32-bit moves clear the upper half)
+        materialize(t, a, std::min(bits, opBits(from)));
+    }
+    if (op == DGMOp::Trunc && inst.type == DGMType::I1)
+        emit("and " + std::string(x86RegName(t, 32)) + ", 1");
+    assign(dst, t, bits);
+}
+
+void FunctionLowering::compare(const DGMInst &inst) {
+    const DGMOperand &a = inst.operands[1], &b = inst.operands[2];
+    unsigned bits = dgmTypeBits(a.kind == DGMOperandKind::Value ? typeOf(a) : typeOf(b));
+    if (a.kind == DGMOperandKind::Imm && b.kind == DGMOperandKind::Imm) bits = 32;
+
+    std::string lhs;
+    bool aInSlot = a.kind == DGMOperandKind::Value && loc(a).kind == ValueLocation::Slot;
+    bool bInMem = b.kind == DGMOperandKind::Value && loc(b).kind == ValueLocation::Slot;
+    if (a.kind == DGMOperandKind::Value && loc(a).kind == ValueLocation::Reg) {
+        lhs = x86RegName(loc(a).reg, bits);
+    } else if (aInSlot && !bInMem) {
+        lhs = slot(loc(a).offset, bits);
+    } else {
+        materialize(R11, a, bits);
+        lhs = x86RegName(R11, bits);
+    }
+    emit("cmp " + lhs + ", " + rm(b, bits, R10));
+}
+
+// The table holds 32-bit offsets from its own start and sits after the
+// function's code, so it needs no relocations
+bool FunctionLowering::jumpTable(const DGMInst &inst, uint32_t block) {
+    size_t cases = (inst.operands.size() - 2) / 2;
+    if (cases < MinJumpTableCases) return false;
+    int64_t lo = INT64_MAX, hi = INT64_MIN;
+    for (size_t i = 2; i + 1 < inst.operands.size(); i += 2) {
+        lo = std::min(lo, inst.operands[i].value);
+        hi = std::max(hi, inst.operands[i].value);
+    }
+    uint64_t last = uint64_t(hi) - uint64_t(lo);
+    if (last >= uint64_t(MaxJumpTableSpan) ||
+        int64_t(cases) * 100 < int64_t(last + 1) * MinJumpTableDensity)
+        return false;
+
+    // r11 = cond - lo, unsigned: anything outside [lo, hi] is above `last`
+    const DGMOperand &cond = inst.operands[0];
+    unsigned bits = dgmTypeBits(typeOf(cond));
+    if (bits == 64 || cond.kind == DGMOperandKind::Imm)
+        materialize(R11, cond, 64);
+    else if (bits == 32)
+        emit("movsxd r11, " + rm(cond, 32, R11, false));
+    else
+        emit("movsx r11, " + rm(cond, bits, R11, false));
+    if (fitsImm32(lo)) {
+        if (lo) emit("sub r11, " + std::to_string(lo));
+    } else {
+        emit("mov r10, " + std::to_string(lo));
+        emit("sub r11, r10");
+    }
+    std::map<uint32_t, std::string> labels;
+    auto label = [&](const DGMOperand &target) -> const std::string & {
+        uint32_t to = uint32_t(target.value);
+        auto it = labels.find(to);
+        if (it == labels.end()) it = labels.emplace(to, edgeLabel(block, to)).first;
+        return it->second;
+    };
+    const std::string &fallback = label(inst.operands[1]);
+    emit("cmp r11, " + std::to_string(last));
+    emit("ja " + fallback);
+
+    std::string table = ".J" + std::to_string(tables++);
+    emit("lea r10, [" + table + "]");
+    emit("movsxd r11, dword [r10+r11*4]");
+    emit("add r10, r11");
+    emit("jmp r10");
+
+    std::vector<const std::string*> slots(last + 1, &fallback);
+    for (size_t i = 2; i + 1 < inst.operands.size(); i += 2)
+        slots[uint64_t(inst.operands[i].value) - uint64_t(lo)] = &label(inst.operands[i + 1]);
+    trampolines << "align 4\n" << table << ":\n";
+    for (const std::string *target : slots)
+        trampolines << "    dd " << *target << " - " << table << "\n";
+    return true;
+}
+
+// Scalar intrinsics the optimizer introduces (min/max from loop bounds,
+// abs) are lowered inline; hints with no code are dropped. Returns false
+// for anything that should stay a call.
+bool FunctionLowering::intrinsic(const DGMInst &inst, const ValueLocation &dst,
+                                 std::string_view name) {
+    static const std::pair<const char*, const char*> MinMax[] = {
+        {"llvm.smax.", "cmovl"}, {"llvm.smin.", "cmovg"},
+        {"llvm.umax.", "cmovb"}, {"llvm.umin.", "cmova"}};
+    static const char *const Dropped[] = {
+        "llvm.lifetime.", "llvm.assume", "llvm.dbg.", "llvm.experimental.noalias.scope.decl"};
+
+    for (const char *prefix : Dropped)
+        if (name.substr(0, std::strlen(prefix)) == prefix) return true;
+
+    unsigned bits = opBits(inst.type);
+    for (const auto &[prefix, cmov] : MinMax) {
+        if (name.substr(0, std::strlen(prefix)) != prefix) continue;
+        if (dst.kind == ValueLocation::None) return true;
+        // t = a; if (a <cmp> b) t = b
+        materialize(R11, inst.operands[0], bits);
+        std::string b = rm(inst.operands[1], bits, R10, false);
+        emit("cmp " + std::string(x86RegName(R11, bits)) + ", " + b);
+        emit(std::string(cmov) + " " + x86RegName(R11, bits) + ", " + b);
+        assign(dst, R11, bits);
+        return true;
+    }
+    if (name.substr(0, 9) == "llvm.abs.") {
+        if (dst.kind == ValueLocation::None) return true;
+        materialize(R11, inst.operands[0], bits);
+        emit("mov " + std::string(x86RegName(R10, bits)) + ", " + x86RegName(R11, bits));
+        emit("neg " + std::string(x86RegName(R10, bits)));
+        emit("cmovns " + std::string(x86RegName(R11, bits)) + ", " + x86RegName(R10, bits));
+        assign(dst, R11, bits);
+        return true;
+    }
+    return false;
+}
+
+void FunctionLowering::call(const DGMInst &inst, const ValueLocation &dst) {
+    const DGMOperand &callee = inst.operands.back();
+    unsigned args = unsigned(inst.operands.size()) - 1;
+
+    std::string_view calleeName;
+    if (callee.kind == DGMOperandKind::Symbol) {
+        calleeName = dgm.string(uint32_t(callee.value));
+        if (calleeName.substr(0, 5) == "llvm." && intrinsic(inst, dst, calleeName)) return;
+    }
+
+    if (callee.kind != DGMOperandKind::Symbol) materialize(RAX, callee, 64);
+
+    // Stack arguments first: they only read the current locations
+    for (unsigned i = abi.argRegCount; i < args; i++) {
+        std::string place = "qword [rsp+" +
+                            std::to_string(abi.shadowSpace + 8 * (i - abi.argRegCount)) + "]";
+        const DGMOperand &arg = inst.operands[i];
+        if (arg.kind == DGMOperandKind::Imm && fitsImm32(arg.value)) {
+            emit("mov " + place + ", " + std::to_string(arg.value));
+        } else if (arg.kind == DGMOperandKind::Value && loc(arg).kind == ValueLocation::Reg) {
+            emit("mov " + place + ", " + x86RegName(loc(arg).reg, 64));
+        } else {
+            materialize(R11, arg, 64);
+            emit("mov " + place + ", r11");
+        }
+    }
+
+    std::vector<Move> moves;
+    for (unsigned i = 0; i < args && i < abi.argRegCount; i++) {
+        ValueLocation reg;
+        reg.kind = ValueLocation::Reg;
+        reg.reg = abi.argRegs[i];
+        moves.push_back({reg, source(inst.operands[i])});
+    }
+    parallelMove(moves);
+
+    if (callee.kind == DGMOperandKind::Symbol) {
+        // llvm.memcpy.* and friends take the C library's argument order
+        std::string name;
+        if (calleeName.substr(0, 5) == "llvm.") {
+            size_t dot = calleeName.find('.', 5);
+            name = "$" + std::string(calleeName.substr(5, dot - 5));
+            referenced.insert(name.substr(1));
+        } else {
+            name = symbol(uint32_t(callee.value));
+        }
+        bool local = defined.count(calleeName) != 0;
+        emit("call " + name + (TargetELF && !local ? " wrt ..plt" : ""));
+    } else {
+        emit("call rax");
+    }
+    if (inst.defines) assign(dst, RAX, opBits(inst.type));
+}
+
+void FunctionLowering::branch(const DGMInst &inst, uint32_t block, int64_t fusedPred) {
+    if (inst.operands.size() == 1) {
+        jumpTo(block, uint32_t(inst.operands[0].value));
         return;
     }
 
+    const DGMOperand &cond = inst.operands[0];
+    uint32_t onTrue = uint32_t(inst.operands[1].value), onFalse = uint32_t(inst.operands[2].value);
+    if (cond.kind == DGMOperandKind::Imm) {
+        jumpTo(block, cond.value ? onTrue : onFalse);
+        return;
+    }
+    if (fusedPred < 0) {
+        emit("cmp " + rm(cond, 8, R11, false) + ", 0");
+        fusedPred = 33; // ne
+    }
+
+    // Fall through into the true block when it directly follows
+    if (onTrue == block + 1 && !hasPhis(onTrue)) {
+        emit(std::string("j") + condCode(fusedPred, true) + " " + edgeLabel(block, onFalse));
+        return;
+    }
+    emit(std::string("j") + condCode(fusedPred) + " " + edgeLabel(block, onTrue));
+    jumpTo(block, onFalse);
+}
+
+void FunctionLowering::instruction(uint32_t k, uint32_t block, uint32_t value, int64_t &fusedPred) {
+    const DGMInst &inst = fn.insts[k];
+    DGMOp op = static_cast<DGMOp>(inst.op);
+    ValueLocation none;
+    const ValueLocation &dst = inst.defines ? ra.values[value] : none;
+
+    // Pure instructions whose result is never used
+    bool sideEffects = op == DGMOp::Call || op == DGMOp::Store || op == DGMOp::ICmp ||
+                       !inst.defines;
+    if (!sideEffects && dst.kind == ValueLocation::None) return;
+
+    switch (op) {
+        case DGMOp::Alloca:
+        case DGMOp::Phi:
+            if (op == DGMOp::Alloca && dst.kind != ValueLocation::Frame)
+                unsupported("a dynamic alloca");
+            return;
+        case DGMOp::Add: binary(inst, dst, "add", true); return;
+        case DGMOp::Sub: binary(inst, dst, "sub", false); return;
+        case DGMOp::Mul: binary(inst, dst, "imul", true); return;
+        case DGMOp::And: binary(inst, dst, "and", true); return;
+        case DGMOp::Or: binary(inst, dst, "or", true); return;
+        case DGMOp::Xor: binary(inst, dst, "xor", true); return;
+        case DGMOp::SDiv: case DGMOp::UDiv: case DGMOp::SRem: case DGMOp::URem:
+            division(inst, dst);
+            return;
+        case DGMOp::Shl: shift(inst, dst, "shl"); return;
+        case DGMOp::LShr: shift(inst, dst, "shr"); return;
+        case DGMOp::AShr: shift(inst, dst, "sar"); return;
+        case DGMOp::ZExt: case DGMOp::SExt: case DGMOp::Trunc: case DGMOp::BitCast:
+        case DGMOp::PtrToInt: case DGMOp::IntToPtr: case DGMOp::Freeze:
+        case DGMOp::AddrSpaceCast:
+            cast(inst, dst);
+            return;
+        case DGMOp::ICmp:
+            compare(inst);
+            if (ra.fusedCompare[k]) {
+                fusedPred = inst.operands[0].value;
+            } else if (dst.kind != ValueLocation::None) {
+                emit("set" + std::string(condCode(inst.operands[0].value)) + " r11b");
+                emit("movzx r11d, r11b");
+                assign(dst, R11, 32);
+            }
+            return;
+        case DGMOp::Select: {
+            unsigned bits = opBits(inst.type);
+            materialize(R11, inst.operands[2], bits);
+            emit("cmp " + rm(inst.operands[0], 8, R10, false) + ", 0");
+            emit("cmovne " + std::string(x86RegName(R11, bits)) + ", " +
+                 rm(inst.operands[1], bits, R10, false));
+            assign(dst, R11, bits);
+            return;
+        }
+        case DGMOp::Load: {
+            unsigned bits = dgmTypeBits(inst.type);
+            X86Reg t = target(dst, R11);
+            std::string addr = address(inst.operands[0], R11);
+            if (bits < 32)
+                emit("movzx " + std::string(x86RegName(t, 32)) + ", " + sizeName(bits) + " " + addr);
+            else
+                emit("mov " + std::string(x86RegName(t, bits)) + ", " + addr);
+            assign(dst, t, bits);
+            return;
+        }
+        case DGMOp::Store: {
+            unsigned bits = dgmTypeBits(inst.type);
+            const DGMOperand &val = inst.operands[0];
+            std::string src;
+            if (val.kind == DGMOperandKind::Imm && fitsImm32(val.value)) {
+                src = std::to_string(val.value);
+            } else if (val.kind == DGMOperandKind::Value && loc(val).kind == ValueLocation::Reg) {
+                src = x86RegName(loc(val).reg, bits);
+            } else {
+                materialize(R10, val, bits);
+                src = x86RegName(R10, bits);
+            }
+            emit("mov " + std::string(sizeName(bits)) + " " + address(inst.operands[1], R11) +
+                 ", " + src);
+            return;
+        }
+        case DGMOp::GEP: {
+            materialize(R11, inst.operands[0], 64);
+            for (size_t i = 2; i + 1 < inst.operands.size(); i += 2) {
+                const DGMOperand &index = inst.operands[i];
+                int64_t scale = inst.operands[i + 1].value;
+                unsigned ibits = dgmTypeBits(typeOf(index));
+                if (ibits == 32)
+                    emit("movsxd r10, " + rm(index, 32, R10, false));
+                else if (ibits < 32)
+                    emit("movsx r10, " + rm(index, ibits, R10, false));
+                else
+                    materialize(R10, index, 64);
+                if (scale == 1 || scale == 2 || scale == 4 || scale == 8) {
+                    emit("lea r11, [r11+r10*" + std::to_string(scale) + "]");
+                } else {
+                    emit("imul r10, r10, " + std::to_string(scale));
+                    emit("add r11, r10");
+                }
+            }
+            int64_t offset = inst.operands[1].value;
+            if (offset && fitsImm32(offset)) {
+                emit("add r11, " + std::to_string(offset));
+            } else if (offset) {
+                emit("mov r10, " + std::to_string(offset));
+                emit("add r11, r10");
+            }
+            assign(dst, R11, 64);
+            return;
+        }
+        case DGMOp::Call:
+            call(inst, dst);
+            return;
+        case DGMOp::Br:
+            branch(inst, block, fusedPred);
+            fusedPred = -1;
+            return;
+        case DGMOp::Switch: {
+            if (jumpTable(inst, block)) return;
+            const DGMOperand &cond = inst.operands[0];
+            unsigned bits = dgmTypeBits(typeOf(cond));
+            std::string c = rm(cond, bits, R11, false);
+            for (size_t i = 2; i + 1 < inst.operands.size(); i += 2) {
+                if (fitsImm32(inst.operands[i].value)) {
+                    emit("cmp " + c + ", " + std::to_string(inst.operands[i].value));
+                } else {
+                    emit("mov r10, " + std::to_string(inst.operands[i].value));
+                    emit("cmp " + c + ", r10");
+                }
+                emit("je " + edgeLabel(block, uint32_t(inst.operands[i + 1].value)));
+            }
+            jumpTo(block, uint32_t(inst.operands[1].value));
+            return;
+        }
+        case DGMOp::Ret:
+            if (!inst.operands.empty())
+                materialize(RAX, inst.operands[0], dgmTypeBits(fn.returnType));
+            epilogue();
+            return;
+        case DGMOp::Unreachable:
+            emit("ud2");
+            return;
+        default: {
+            const char *name = dgmOpName(inst.op);
+            unsupported(dgmOpCode(inst.op) + " " + (name ? name : "??"));
+            return;
+        }
+    }
+}
+
+bool FunctionLowering::run(std::string &err) {
+    uint32_t value = fn.entry.argCount;
+    for (uint32_t b = 0; b < fn.blockCount(); b++) {
+        blockValue.push_back(value);
+        for (uint32_t k = fn.blockStart[b]; k < fn.blockStart[b + 1]; k++)
+            value += fn.insts[k].defines;
+    }
+
+    prologue();
+    value = fn.entry.argCount;
+    int64_t fusedPred = -1;
+    for (uint32_t b = 0; b < fn.blockCount(); b++) {
+        out << blockLabel(b) << ":\n";
+        for (uint32_t k = fn.blockStart[b]; k < fn.blockStart[b + 1]; k++) {
+            instruction(k, b, value, fusedPred);
+            value += fn.insts[k].defines;
+        }
+    }
+    out << trampolines.str();
+    err = error;
+    return error.empty();
+}
+
+// Per-thread lowering state; `referenced` collects the symbols its
+// functions use, merged once all are done
+struct LoweringWorker {
+    DGMFunctionBody body;
+    std::set<std::string> referenced;
+};
+
+} // namespace
+
+// === Emit NASM Assembly ===
+bool emitDGMtoNASM(const std::string &dgmFile, const std::string &nasmFile, std::string &err,
+                   unsigned jobs) {
+    DGMReader dgm;
+    if (!dgm.open(dgmFile, err)) return false;
+
+    std::unordered_set<std::string_view> functions;
+    for (uint32_t f = 0; f < dgm.functionCount(); f++)
+        functions.insert(dgm.string(dgm.function(f).name));
+
+    // Each function is allocated and lowered independently into its own
+    // text; the pieces are concatenated in file order
+    std::vector<std::string> text(dgm.functionCount());
+    std::vector<std::string> errors(text.size());
+    std::vector<LoweringWorker> workers(workerCount(text.size(), jobs));
+    parallelFor(text.size(), workers, [&](LoweringWorker &w, size_t f) {
+        w.body.load(dgm, uint32_t(f));
+        RegAllocation ra = allocateRegisters(w.body, TargetABI);
+        std::ostringstream fnText;
+        fnText << "$" << dgm.string(w.body.entry.name) << ":\n";
+        FunctionLowering(dgm, w.body, TargetABI, ra, fnText, w.referenced, functions).run(errors[f]);
+        fnText << "\n";
+        text[f] = fnText.str();
+    });
+
+    // Assembly missing an instruction's effect must never be assembled
+    for (const std::string &e : errors) {
+        if (e.empty()) continue;
+        err = e;
+        return false;
+    }
+
     std::ofstream out(nasmFile);
     if (!out.is_open()) {
-        std::cerr << "Error: cannot open " << nasmFile << "\n";
-        return;
+        err = "cannot open " + nasmFile;
+        return false;
     }
 
+    std::set<std::string> referenced;
+    for (LoweringWorker &w : workers) referenced.insert(w.referenced.begin(), w.referenced.end());
+    std::set<std::string_view> defined(functions.begin(), functions.end());
+    for (uint32_t g = 0; g < dgm.globalCount(); g++)
+        defined.insert(dgm.string(dgm.global(g).name));
+
     // Assembly header
+    out << "default rel\n";
     out << "section .text\n";
-    out << "global main\n";
-    out << "extern strict_print\n";
-    out << "extern strict_input\n\n";
-
-    out << "main:\n";
-
-    std::string line;
-    while (std::getline(in, line)) {
-        // Ignore FUNC/BLOCK markers
-        if (line.find("FUNC") != std::string::npos) continue;
-        if (line.find("BLOCK") != std::string::npos) continue;
-        if (line.find("END FUNC") != std::string::npos) continue;
-
-        // Extract opcode
-        size_t pos = line.find(';');
-        std::string op = (pos == std::string::npos) ? line : line.substr(0, pos);
-        // Trim whitespace
-        op.erase(0, op.find_first_not_of(" \t"));
-        op.erase(op.find_last_not_of(" \t") + 1);
-
-        if (NasmMap.count(op)) {
-            out << "    " << NasmMap[op] << "\n";
-        } else {
-            out << "    ; unhandled: " << op << "\n";
-        }
+    for (uint32_t f = 0; f < dgm.functionCount(); f++) {
+        DGMFunctionEntry fn = dgm.function(f);
+        if (fn.exported) out << "global $" << dgm.string(fn.name) << "\n";
     }
+    for (const std::string &name : referenced)
+        if (!defined.count(name)) out << "extern $" << name << "\n";
+    out << "\n";
+    for (const std::string &fn : text) out << fn;
 
-    // Exit
-    out << "    mov rax, 60     ; sys_exit\n";
-    out << "    xor rdi, rdi\n";
-    out << "    syscall\n";
+    // Module data
+    for (int constant = 1; constant >= 0; constant--) {
+        bool any = false;
+        for (uint32_t g = 0; g < dgm.globalCount(); g++) {
+            DGMGlobalEntry global = dgm.global(g);
+            if (bool(global.constant) != bool(constant)) continue;
+            if (!any) {
+                out << "section " << (constant ? (TargetELF ? ".rodata" : ".rdata") : ".data") << "\n";
+                any = true;
+            }
+            out << "align 8\n$" << dgm.string(global.name) << ":\n";
+            if (global.data == DGMZeroInit) {
+                out << "    times " << global.size << " db 0\n";
+                continue;
+            }
+            std::string_view bytes = dgm.string(global.data);
+            for (size_t i = 0; i < bytes.size(); i += 16) {
+                out << "    db ";
+                for (size_t j = i; j < bytes.size() && j < i + 16; j++)
+                    out << (j > i ? "," : "") << unsigned(static_cast<unsigned char>(bytes[j]));
+                out << "\n";
+            }
+        }
+    }
 
-    in.close();
+    // Without this note GNU ld assumes the object needs an executable stack
+    if (TargetELF) out << "section .note.GNU-stack noalloc noexec nowrite progbits\n";
     out.close();
+    if (!out) {
+        err = "could not write " + nasmFile;
+        return false;
+    }
+    return true;
+}
+
+std::string nasmAssembleCommand(const std::string &nasmFile, const std::string &objFile) {
+    return std::string("nasm -f ") + (TargetELF ? "elf64 " : "win64 ") + nasmFile + " -o " + objFile;
 }
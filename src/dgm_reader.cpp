@@ -0,0 +1,252 @@
+#include "dgm.hpp"
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// === Opcode Names ===
+namespace {
+
+struct OpName {
+    DGMOp op;
+    const char *name;
+};
+
+constexpr OpName OpNames[] = {
+    {DGMOp::Nop, "nop"},             {DGMOp::Alloca, "alloca"},
+    {DGMOp::Load, "load"},           {DGMOp::Store, "store"},
+    {DGMOp::GEP, "getelementptr"},   {DGMOp::Fence, "fence"},
+    {DGMOp::CmpXchg, "cmpxchg"},     {DGMOp::AtomicRMW, "atomicrmw"},
+    {DGMOp::Trunc, "trunc"},         {DGMOp::ZExt, "zext"},
+    {DGMOp::SExt, "sext"},           {DGMOp::FPTrunc, "fptrunc"},
+    {DGMOp::FPExt, "fpext"},         {DGMOp::FPToUI, "fptoui"},
+    {DGMOp::FPToSI, "fptosi"},       {DGMOp::UIToFP, "uitofp"},
+    {DGMOp::SIToFP, "sitofp"},       {DGMOp::ICmp, "icmp"},
+    {DGMOp::FCmp, "fcmp"},           {DGMOp::Add, "add"},
+    {DGMOp::Sub, "sub"},             {DGMOp::Mul, "mul"},
+    {DGMOp::UDiv, "udiv"},           {DGMOp::SDiv, "sdiv"},
+    {DGMOp::URem, "urem"},           {DGMOp::SRem, "srem"},
+    {DGMOp::Shl, "shl"},             {DGMOp::LShr, "lshr"},
+    {DGMOp::AShr, "ashr"},           {DGMOp::And, "and"},
+    {DGMOp::Or, "or"},               {DGMOp::Xor, "xor"},
+    {DGMOp::FAdd, "fadd"},           {DGMOp::FSub, "fsub"},
+    {DGMOp::FMul, "fmul"},           {DGMOp::Call, "call"},
+    {DGMOp::Br, "br"},               {DGMOp::Switch, "switch"},
+    {DGMOp::IndirectBr, "indirectbr"}, {DGMOp::Ret, "ret"},
+    {DGMOp::Unreachable, "unreachable"}, {DGMOp::Invoke, "invoke"},
+    {DGMOp::Resume, "resume"},       {DGMOp::Phi, "phi"},
+    {DGMOp::Select, "select"},       {DGMOp::PtrToInt, "ptrtoint"},
+    {DGMOp::IntToPtr, "inttoptr"},   {DGMOp::BitCast, "bitcast"},
+    {DGMOp::AddrSpaceCast, "addrspacecast"}, {DGMOp::FDiv, "fdiv"},
+    {DGMOp::FRem, "frem"},           {DGMOp::FNeg, "fneg"},
+    {DGMOp::ExtractValue, "extractvalue"}, {DGMOp::InsertValue, "insertvalue"},
+    {DGMOp::ExtractElement, "extractelement"}, {DGMOp::InsertElement, "insertelement"},
+    {DGMOp::ShuffleVector, "shufflevector"}, {DGMOp::Freeze, "freeze"},
+    {DGMOp::VAArg, "va_arg"},        {DGMOp::LandingPad, "landingpad"},
+    {DGMOp::Assert, "language.assert"}
+};
+
+constexpr std::array<const char*, DGMOpcodeCount> makeOpNameTable() {
+    std::array<const char*, DGMOpcodeCount> t{};
+    for (const OpName &n : OpNames)
+        t[static_cast<uint8_t>(n.op)] = n.name;
+    return t;
+}
+
+constexpr std::array<const char*, DGMOpcodeCount> OpNameTable = makeOpNameTable();
+
+// LEB128; a truncated varint leaves `p` at `end` and yields what was read
+inline uint64_t readVarint(const uint8_t *&p, const uint8_t *end) {
+    uint64_t v = 0;
+    for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        v |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    return v;
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+template <typename T>
+T readStruct(const uint8_t *p) {
+    T t;
+    std::memcpy(&t, p, sizeof(T)); // the mapping gives no alignment guarantee
+    return t;
+}
+
+} // namespace
+
+const char *dgmOpName(uint8_t op) {
+    return op < DGMOpcodeCount ? OpNameTable[op] : nullptr;
+}
+
+std::string dgmOpCode(uint8_t op) {
+    if (op >= DGMOpcodeCount) return "??";
+    static const char Digits[] = "0123456789AB";
+    return {Digits[op / 12], Digits[op % 12]};
+}
+
+// === Reader ===
+
+bool DGMReader::open(const std::string &path, std::string &err) {
+    if (!file.open(path)) {
+        err = "cannot map " + path;
+        return false;
+    }
+    base = reinterpret_cast<const uint8_t*>(file.begin());
+    size = file.size();
+
+    if (size < sizeof(DGMHeader)) {
+        err = path + " is not a binary DGM file";
+        return false;
+    }
+    header = readStruct<DGMHeader>(base);
+    if (std::memcmp(header.magic, DGMMagic, sizeof(DGMMagic)) != 0) {
+        err = path + " is not a binary DGM file";
+        return false;
+    }
+    if (header.version != DGMVersion) {
+        err = path + ": unsupported DGM version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.functionIndexOffset + uint64_t(header.functionCount) * sizeof(DGMFunctionEntry) > size ||
+        header.blockIndexOffset + uint64_t(header.blockCount) * sizeof(DGMBlockEntry) > size ||
+        header.globalIndexOffset + uint64_t(header.globalCount) * sizeof(DGMGlobalEntry) > size ||
+        header.stringsOffset > size || header.codeOffset > size) {
+        err = path + ": truncated DGM file";
+        return false;
+    }
+    return true;
+}
+
+DGMFunctionEntry DGMReader::function(uint32_t index) const {
+    return readStruct<DGMFunctionEntry>(base + header.functionIndexOffset +
+                                        index * sizeof(DGMFunctionEntry));
+}
+
+DGMGlobalEntry DGMReader::global(uint32_t index) const {
+    return readStruct<DGMGlobalEntry>(base + header.globalIndexOffset +
+                                      index * sizeof(DGMGlobalEntry));
+}
+
+DGMBlockEntry DGMReader::block(const DGMFunctionEntry &fn, uint32_t index) const {
+    return readStruct<DGMBlockEntry>(base + header.blockIndexOffset +
+                                     (fn.firstBlock + index) * sizeof(DGMBlockEntry));
+}
+
+std::string_view DGMReader::string(uint32_t offset) const {
+    const uint8_t *p = base + header.stringsOffset + offset;
+    const uint8_t *end = base + size;
+    if (p >= end) return {};
+    uint64_t len = readVarint(p, end);
+    if (len > uint64_t(end - p)) return {};
+    return {reinterpret_cast<const char*>(p), size_t(len)};
+}
+
+DGMReader::Cursor DGMReader::code(const DGMFunctionEntry &fn) const {
+    const uint8_t *code = base + header.codeOffset;
+    return Cursor(code + fn.codeOffset, code + fn.codeOffset + fn.codeSize);
+}
+
+DGMReader::Cursor DGMReader::code(const DGMFunctionEntry &fn, const DGMBlockEntry &bb) const {
+    const uint8_t *code = base + header.codeOffset;
+    return Cursor(code + bb.codeOffset, code + fn.codeOffset + fn.codeSize, bb.instCount);
+}
+
+bool DGMReader::Cursor::next(DGMInst &inst) {
+    if (cur >= end || remaining == 0) return false;
+    remaining--;
+
+    inst.op = *cur++;
+    uint64_t info = readVarint(cur, end);
+    inst.defines = info & 1;
+    inst.type = static_cast<DGMType>((info >> 1) & 7);
+
+    inst.operands.clear();
+    for (uint64_t n = info >> 4; n && cur < end; n--) {
+        uint8_t first = *cur++;
+        DGMOperandKind kind = static_cast<DGMOperandKind>(first & 3);
+        uint64_t payload = (first >> 2) & 0x1F;
+        if (first & 0x80) payload |= readVarint(cur, end) << 5;
+        inst.operands.push_back({kind, kind == DGMOperandKind::Imm ? unzigzag(payload)
+                                                                   : int64_t(payload)});
+    }
+    return true;
+}
+
+// === Text Dump ===
+
+void dumpDGMText(const std::string &dgmFile, const std::string &textFile) {
+    DGMReader dgm;
+    std::string err;
+    if (!dgm.open(dgmFile, err)) {
+        std::cerr << "Error: " << err << "\n";
+        return;
+    }
+
+    std::ofstream out(textFile);
+    if (!out.is_open()) {
+        std::cerr << "Error: cannot open " << textFile << "\n";
+        return;
+    }
+
+    for (uint32_t g = 0; g < dgm.globalCount(); g++) {
+        DGMGlobalEntry global = dgm.global(g);
+        out << (global.constant ? "CONST " : "DATA ") << dgm.string(global.name)
+            << " [" << global.size << "]";
+        if (global.data != DGMZeroInit) {
+            out << " =";
+            for (unsigned char c : dgm.string(global.data)) out << " " << unsigned(c);
+        }
+        out << "\n";
+    }
+    if (dgm.globalCount()) out << "\n";
+
+    DGMInst inst;
+    for (uint32_t f = 0; f < dgm.functionCount(); f++) {
+        DGMFunctionEntry fn = dgm.function(f);
+        out << "FUNC " << dgm.string(fn.name) << "\n";
+
+        uint32_t value = fn.argCount;
+        for (uint32_t b = 0; b < fn.blockCount; b++) {
+            DGMBlockEntry bb = dgm.block(fn, b);
+            out << "  BLOCK " << dgm.string(bb.name) << "\n";
+
+            DGMReader::Cursor code = dgm.code(fn, bb);
+            while (code.next(inst)) {
+                out << "    ";
+                if (inst.defines) out << "%" << value++ << " = ";
+                if (const char *name = dgmOpName(inst.op)) {
+                    out << dgmOpCode(inst.op) << " " << name;
+                } else {
+                    out << "??";
+                    if (inst.op == uint8_t(DGMOp::Unmapped) && !inst.operands.empty()) {
+                        out << " (" << dgm.string(uint32_t(inst.operands[0].value)) << ")\n";
+                        continue;
+                    }
+                }
+
+                out << " ; ";
+                for (size_t i = 0; i < inst.operands.size(); i++) {
+                    const DGMOperand &op = inst.operands[i];
+                    switch (op.kind) {
+                        case DGMOperandKind::Value: out << "%" << op.value; break;
+                        case DGMOperandKind::Imm: out << op.value; break;
+                        case DGMOperandKind::Block:
+                            out << dgm.string(dgm.block(fn, uint32_t(op.value)).name);
+                            break;
+                        case DGMOperandKind::Symbol:
+                            out << "@" << dgm.string(uint32_t(op.value));
+                            break;
+                    }
+                    if (i + 1 < inst.operands.size()) out << ", ";
+                }
+                out << "\n";
+            }
+        }
+        out << "END FUNC\n\n";
+    }
+}
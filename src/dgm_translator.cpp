@@ -1,64 +1,496 @@
 #include "dgm.hpp"
+#include "parallel.hpp"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/DataLayout.h>
 #include <llvm/IR/Function.h>
+#include <llvm/IR/GetElementPtrTypeIterator.h>
 #include <llvm/IR/Instructions.h>
 #include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_ostream.h>
+#include <cstring>
 #include <fstream>
-#include <unordered_map>
-
-// === LLVM → DGM mapping table (subset, can be extended to full 144) ===
-static std::unordered_map<unsigned, std::string> DGMTable = {
-    { llvm::Instruction::Add,  "17 add" },
-    { llvm::Instruction::Sub,  "18 sub" },
-    { llvm::Instruction::Mul,  "19 mul" },
-    { llvm::Instruction::SDiv, "1B sdiv" },
-    { llvm::Instruction::ICmp, "15 icmp" },
-    { llvm::Instruction::Br,   "30 br" },
-    { llvm::Instruction::Call, "2B call" },
-    { llvm::Instruction::Ret,  "33 ret" },
-    { llvm::Instruction::Alloca,"01 alloca" },
-    { llvm::Instruction::Load,  "02 load" },
-    { llvm::Instruction::Store, "03 store" }
+#include <memory>
+#include <utility>
+#include <vector>
+
+// === LLVM → DGM mapping ===
+static DGMOp toDGM(unsigned opcode) {
+    using I = llvm::Instruction;
+    switch (opcode) {
+        case I::Alloca: return DGMOp::Alloca;
+        case I::Load: return DGMOp::Load;
+        case I::Store: return DGMOp::Store;
+        case I::GetElementPtr: return DGMOp::GEP;
+        case I::Fence: return DGMOp::Fence;
+        case I::AtomicCmpXchg: return DGMOp::CmpXchg;
+        case I::AtomicRMW: return DGMOp::AtomicRMW;
+        case I::Trunc: return DGMOp::Trunc;
+        case I::ZExt: return DGMOp::ZExt;
+        case I::SExt: return DGMOp::SExt;
+        case I::FPTrunc: return DGMOp::FPTrunc;
+        case I::FPExt: return DGMOp::FPExt;
+        case I::FPToUI: return DGMOp::FPToUI;
+        case I::FPToSI: return DGMOp::FPToSI;
+        case I::UIToFP: return DGMOp::UIToFP;
+        case I::SIToFP: return DGMOp::SIToFP;
+        case I::ICmp: return DGMOp::ICmp;
+        case I::FCmp: return DGMOp::FCmp;
+        case I::Add: return DGMOp::Add;
+        case I::Sub: return DGMOp::Sub;
+        case I::Mul: return DGMOp::Mul;
+        case I::UDiv: return DGMOp::UDiv;
+        case I::SDiv: return DGMOp::SDiv;
+        case I::URem: return DGMOp::URem;
+        case I::SRem: return DGMOp::SRem;
+        case I::Shl: return DGMOp::Shl;
+        case I::LShr: return DGMOp::LShr;
+        case I::AShr: return DGMOp::AShr;
+        case I::And: return DGMOp::And;
+        case I::Or: return DGMOp::Or;
+        case I::Xor: return DGMOp::Xor;
+        case I::FAdd: return DGMOp::FAdd;
+        case I::FSub: return DGMOp::FSub;
+        case I::FMul: return DGMOp::FMul;
+        case I::FDiv: return DGMOp::FDiv;
+        case I::FRem: return DGMOp::FRem;
+        case I::FNeg: return DGMOp::FNeg;
+        case I::Call: return DGMOp::Call;
+        case I::Br: return DGMOp::Br;
+        case I::Switch: return DGMOp::Switch;
+        case I::IndirectBr: return DGMOp::IndirectBr;
+        case I::Ret: return DGMOp::Ret;
+        case I::Unreachable: return DGMOp::Unreachable;
+        case I::Invoke: return DGMOp::Invoke;
+        case I::Resume: return DGMOp::Resume;
+        case I::PHI: return DGMOp::Phi;
+        case I::Select: return DGMOp::Select;
+        case I::PtrToInt: return DGMOp::PtrToInt;
+        case I::IntToPtr: return DGMOp::IntToPtr;
+        case I::BitCast: return DGMOp::BitCast;
+        case I::AddrSpaceCast: return DGMOp::AddrSpaceCast;
+        case I::ExtractValue: return DGMOp::ExtractValue;
+        case I::InsertValue: return DGMOp::InsertValue;
+        case I::ExtractElement: return DGMOp::ExtractElement;
+        case I::InsertElement: return DGMOp::InsertElement;
+        case I::ShuffleVector: return DGMOp::ShuffleVector;
+        case I::Freeze: return DGMOp::Freeze;
+        case I::VAArg: return DGMOp::VAArg;
+        case I::LandingPad: return DGMOp::LandingPad;
+        default: return DGMOp::Unmapped;
+    }
+}
+
+namespace {
+
+void appendVarint(std::string &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(char(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(char(v));
+}
+
+// The strings section. Everything function bodies refer to is interned
+// before encoding starts, so encoders running on several threads only
+// ever read it.
+class StringTable {
+    std::string bytes;
+    llvm::StringMap<uint32_t> offsets;
+
+public:
+    uint32_t intern(llvm::StringRef s) {
+        auto [it, inserted] = offsets.try_emplace(s, uint32_t(bytes.size()));
+        if (!inserted) return it->second;
+        appendVarint(bytes, s.size());
+        bytes.append(s.data(), s.size());
+        return it->second;
+    }
+
+    uint32_t lookup(llvm::StringRef s) const { return offsets.lookup(s); }
+    const std::string &data() const { return bytes; }
 };
 
-// === Translator ===
-void translateModuleToDGM(llvm::Module &M, const std::string &filename) {
-    std::ofstream out(filename);
-    if (!out.is_open()) {
-        llvm::errs() << "Error: could not open " << filename << " for writing\n";
-        return;
-    }
-
-    for (auto &F : M) {
-        if (F.isDeclaration()) continue;
-        out << "FUNC " << F.getName().str() << "\n";
-
-        for (auto &BB : F) {
-            out << "  BLOCK " << BB.getName().str() << "\n";
-            for (auto &I : BB) {
-                unsigned opcode = I.getOpcode();
-                if (DGMTable.count(opcode)) {
-                    out << "    " << DGMTable[opcode];
-                } else {
-                    out << "    ?? (" << I.getOpcodeName() << ")";
-                }
+DGMType typeOf(llvm::Type *T) {
+    if (T->isVoidTy()) return DGMType::Void;
+    if (T->isPointerTy()) return DGMType::Ptr;
+    if (T->isIntegerTy()) {
+        switch (T->getIntegerBitWidth()) {
+            case 1: return DGMType::I1;
+            case 8: return DGMType::I8;
+            case 16: return DGMType::I16;
+            case 32: return DGMType::I32;
+            case 64: return DGMType::I64;
+        }
+    }
+    return DGMType::Other;
+}
 
-                // Print operands for readability
-                out << " ; ";
-                for (unsigned i = 0; i < I.getNumOperands(); i++) {
-                    if (auto *op = I.getOperand(i)) {
-                        if (op->hasName())
-                            out << op->getName().str();
-                        else
-                            out << "%tmp";
-                    }
-                    if (i + 1 < I.getNumOperands()) out << ", ";
+std::string signatureOf(const llvm::Function &F) {
+    std::string signature(1, char(typeOf(F.getReturnType())));
+    for (const llvm::Argument &arg : F.args())
+        signature.push_back(char(typeOf(arg.getType())));
+    return signature;
+}
+
+// One function's code and block index, with offsets relative to the
+// function; DGMWriter::append places it in the file.
+struct EncodedFunction {
+    DGMFunctionEntry entry{};
+    std::vector<DGMBlockEntry> blocks;
+    std::vector<const llvm::BasicBlock*> blockRefs;  // names are interned when placed
+    std::string code;
+    std::string error;   // the first value that has no DGM spelling
+};
+
+// Per-thread encoder state. Each keeps its own DataLayout: its struct
+// layout cache is filled lazily and is not safe to share.
+class FunctionEncoder {
+    const StringTable *strings;
+    std::unique_ptr<llvm::DataLayout> DL;
+    llvm::DenseMap<const llvm::Value*, uint32_t> values;
+    llvm::DenseMap<const llvm::BasicBlock*, uint32_t> blockIndex;
+    std::vector<const llvm::Constant*> addresses;   // materialized in the entry block
+    std::string *code = nullptr;
+    const llvm::Function *function = nullptr;
+    EncodedFunction *current = nullptr;
+
+    void unsupported(const llvm::Value *V) {
+        if (!current->error.empty()) return;
+        std::string what;
+        llvm::raw_string_ostream os(what);
+        V->printAsOperand(os, /*PrintType=*/true);
+        current->error = function->getName().str() + ": cannot encode " + os.str();
+    }
+
+    void varint(uint64_t v) { appendVarint(*code, v); }
+
+    // Same bytes as varint(payload << 2 | kind), without losing the top two
+    // bits of a full 64-bit payload
+    void operand(DGMOperandKind kind, uint64_t payload) {
+        uint8_t first = uint8_t(uint64_t(kind) | (payload & 0x1F) << 2);
+        payload >>= 5;
+        if (!payload) {
+            code->push_back(char(first));
+            return;
+        }
+        code->push_back(char(first | 0x80));
+        varint(payload);
+    }
+
+    void imm(int64_t v) {
+        operand(DGMOperandKind::Imm, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+    }
+
+    // The global a constant pointer expression addresses, and its byte
+    // offset from it; nullptr for anything else
+    const llvm::GlobalValue *constantAddress(const llvm::Constant *C, int64_t &offset) const {
+        offset = 0;
+        if (!C->getType()->isPointerTy()) return nullptr;
+        llvm::APInt bytes(DL->getIndexTypeSizeInBits(C->getType()), 0);
+        auto *G = llvm::dyn_cast<llvm::GlobalValue>(
+            C->stripAndAccumulateConstantOffsets(*DL, bytes, /*AllowNonInbounds=*/true));
+        offset = bytes.getSExtValue();
+        return G;
+    }
+
+    void value(const llvm::Value *V) {
+        int64_t offset;
+        const llvm::GlobalValue *G = nullptr;
+        if (auto it = values.find(V); it != values.end()) {
+            operand(DGMOperandKind::Value, it->second);
+        } else if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(V)) {
+            imm(C->getSExtValue());
+        } else if (auto *BB = llvm::dyn_cast<llvm::BasicBlock>(V)) {
+            operand(DGMOperandKind::Block, blockIndex.lookup(BB));
+        } else if (auto *C = llvm::dyn_cast<llvm::Constant>(V);
+                   C && (G = constantAddress(C, offset)) && offset == 0) {
+            operand(DGMOperandKind::Symbol, strings->lookup(G->getName()));
+        } else if (llvm::isa<llvm::UndefValue>(V) ||
+                   (llvm::isa<llvm::Constant>(V) && llvm::cast<llvm::Constant>(V)->isNullValue())) {
+            imm(0); // null, zeroinitializer, and undef/poison (any value will do)
+        } else {
+            unsupported(V);
+        }
+    }
+
+    // `gep Symbol, offset` defining the next value: a constant &global + k,
+    // which no operand form can spell
+    void address(const llvm::Constant *C) {
+        int64_t offset;
+        const llvm::GlobalValue *G = constantAddress(C, offset);
+        code->push_back(char(DGMOp::GEP));
+        varint(uint64_t(2) << 4 | uint64_t(DGMType::Ptr) << 1 | 1);
+        operand(DGMOperandKind::Symbol, strings->lookup(G->getName()));
+        imm(offset);
+    }
+
+    void instruction(const llvm::Instruction &I);
+
+public:
+    FunctionEncoder(const StringTable &strings, const llvm::DataLayout &layout)
+        : strings(&strings), DL(std::make_unique<llvm::DataLayout>(layout)) {}
+    FunctionEncoder(const FunctionEncoder &other)
+        : FunctionEncoder(*other.strings, *other.DL) {}
+
+    void encode(const llvm::Function &F, EncodedFunction &out);
+};
+
+// Builds the sections of a binary .dgm in memory; written out in one go.
+class DGMWriter {
+    std::vector<DGMFunctionEntry> functions;
+    std::vector<DGMBlockEntry> blocks;
+    std::vector<DGMGlobalEntry> globals;
+    std::string code;
+
+public:
+    StringTable strings;
+
+    bool global(const llvm::GlobalVariable &G, std::string &err);
+    void append(EncodedFunction &fn);
+    bool write(const std::string &filename) const;
+};
+
+void FunctionEncoder::instruction(const llvm::Instruction &I) {
+    DGMOp op = toDGM(I.getOpcode());
+    bool defines = !I.getType()->isVoidTy();
+    DGMType type = typeOf(I.getType());
+    if (auto *S = llvm::dyn_cast<llvm::StoreInst>(&I))
+        type = typeOf(S->getValueOperand()->getType());
+
+    // getelementptr becomes base + offset + sum(index * scale)
+    int64_t gepOffset = 0;
+    std::vector<std::pair<const llvm::Value*, int64_t>> gepIndices;
+    if (auto *GEP = llvm::dyn_cast<llvm::GetElementPtrInst>(&I)) {
+        auto type = llvm::gep_type_begin(GEP);
+        for (auto idx = GEP->idx_begin(); idx != GEP->idx_end(); ++idx, ++type) {
+            if (llvm::StructType *ST = type.getStructTypeOrNull()) {
+                unsigned field = unsigned(llvm::cast<llvm::ConstantInt>(*idx)->getZExtValue());
+                gepOffset += int64_t(DL->getStructLayout(ST)->getElementOffset(field));
+                continue;
+            }
+            int64_t scale = int64_t(DL->getTypeAllocSize(type.getIndexedType()));
+            if (auto *C = llvm::dyn_cast<llvm::ConstantInt>(*idx))
+                gepOffset += C->getSExtValue() * scale;
+            else
+                gepIndices.push_back({*idx, scale});
+        }
+    }
+
+    unsigned count = I.getNumOperands();
+    if (op == DGMOp::Unmapped) count = 1;
+    else if (llvm::isa<llvm::CmpInst>(I) || llvm::isa<llvm::AllocaInst>(I)) count += 1;
+    else if (llvm::isa<llvm::PHINode>(I)) count *= 2;
+    else if (llvm::isa<llvm::GetElementPtrInst>(I)) count = 2 + 2 * unsigned(gepIndices.size());
+
+    code->push_back(char(op));
+    varint(uint64_t(count) << 4 | uint64_t(type) << 1 | uint64_t(defines));
+
+    if (op == DGMOp::Unmapped) {
+        operand(DGMOperandKind::Symbol, strings->lookup(I.getOpcodeName()));
+    } else if (auto *Cmp = llvm::dyn_cast<llvm::CmpInst>(&I)) {
+        imm(Cmp->getPredicate());
+        for (const llvm::Value *V : Cmp->operands()) value(V);
+    } else if (auto *A = llvm::dyn_cast<llvm::AllocaInst>(&I)) {
+        imm(int64_t(DL->getTypeAllocSize(A->getAllocatedType())));
+        value(A->getArraySize());
+    } else if (auto *Phi = llvm::dyn_cast<llvm::PHINode>(&I)) {
+        for (unsigned i = 0; i < Phi->getNumIncomingValues(); i++) {
+            value(Phi->getIncomingValue(i));
+            value(Phi->getIncomingBlock(i));
+        }
+    } else if (auto *GEP = llvm::dyn_cast<llvm::GetElementPtrInst>(&I)) {
+        value(GEP->getPointerOperand());
+        imm(gepOffset);
+        for (auto &[index, scale] : gepIndices) {
+            value(index);
+            imm(scale);
+        }
+    } else if (auto *Br = llvm::dyn_cast<llvm::BranchInst>(&I)) {
+        if (Br->isConditional()) value(Br->getCondition());
+        for (unsigned i = 0; i < Br->getNumSuccessors(); i++) value(Br->getSuccessor(i));
+    } else {
+        for (const llvm::Value *V : I.operands()) value(V);
+    }
+}
+
+void FunctionEncoder::encode(const llvm::Function &F, EncodedFunction &out) {
+    values.clear();
+    blockIndex.clear();
+    code = &out.code;
+    function = &F;
+    current = &out;
+
+    DGMFunctionEntry &fn = out.entry;
+    fn.name = strings->lookup(F.getName());
+    fn.signature = strings->lookup(signatureOf(F));
+    fn.argCount = uint32_t(F.arg_size());
+    fn.exported = !F.hasLocalLinkage();
+
+    // Phis may name values defined later in layout order, so every value
+    // is numbered before any operand is encoded.
+    uint32_t nextValue = 0;
+    for (const llvm::Argument &arg : F.args())
+        values.try_emplace(&arg, nextValue++);
+    // Constant addresses with an offset become values computed once at
+    // the top of the entry block, which dominates every use
+    addresses.clear();
+    for (const llvm::BasicBlock &BB : F) {
+        for (const llvm::Instruction &I : BB) {
+            for (const llvm::Value *V : I.operands()) {
+                auto *CE = llvm::dyn_cast<llvm::ConstantExpr>(V);
+                int64_t offset;
+                if (CE && constantAddress(CE, offset) && offset != 0 &&
+                    values.try_emplace(CE, nextValue).second) {
+                    nextValue++;
+                    addresses.push_back(CE);
                 }
-                out << "\n";
             }
         }
-        out << "END FUNC\n\n";
+    }
+    for (const llvm::BasicBlock &BB : F) {
+        blockIndex.try_emplace(&BB, uint32_t(blockIndex.size()));
+        for (const llvm::Instruction &I : BB)
+            if (!I.getType()->isVoidTy()) values.try_emplace(&I, nextValue++);
+    }
+
+    for (const llvm::BasicBlock &BB : F) {
+        DGMBlockEntry bb{};
+        bb.codeOffset = uint32_t(code->size());
+        bb.instCount = uint32_t(BB.size());
+        if (&BB == &F.getEntryBlock()) {
+            bb.instCount += uint32_t(addresses.size());
+            for (const llvm::Constant *C : addresses) address(C);
+        }
+        out.blocks.push_back(bb);
+        out.blockRefs.push_back(&BB);
+        for (const llvm::Instruction &I : BB)
+            instruction(I);
+    }
+
+    fn.blockCount = uint32_t(out.blocks.size());
+    fn.codeSize = uint32_t(code->size());
+    fn.valueCount = nextValue;
+    code = nullptr;
+    function = nullptr;
+    current = nullptr;
+}
+
+void DGMWriter::append(EncodedFunction &encoded) {
+    DGMFunctionEntry fn = encoded.entry;
+    fn.firstBlock = uint32_t(blocks.size());
+    fn.codeOffset = uint32_t(code.size());
+    for (size_t b = 0; b < encoded.blocks.size(); b++) {
+        DGMBlockEntry bb = encoded.blocks[b];
+        const llvm::BasicBlock *BB = encoded.blockRefs[b];
+        bb.name = BB->hasName() ? strings.intern(BB->getName())
+                                : strings.intern("bb" + std::to_string(b));
+        bb.codeOffset += fn.codeOffset;
+        blocks.push_back(bb);
+    }
+    code += encoded.code;
+    functions.push_back(fn);
+}
+
+bool DGMWriter::global(const llvm::GlobalVariable &G, std::string &err) {
+    const llvm::DataLayout &layout = G.getParent()->getDataLayout();
+    DGMGlobalEntry entry{};
+    entry.name = strings.intern(G.getName());
+    entry.size = uint32_t(layout.getTypeAllocSize(G.getValueType()));
+    entry.constant = G.isConstant();
+    entry.data = DGMZeroInit;
+
+    const llvm::Constant *init = G.getInitializer();
+    if (auto *CDS = llvm::dyn_cast<llvm::ConstantDataSequential>(init)) {
+        entry.data = strings.intern(CDS->getRawDataValues());
+    } else if (auto *CI = llvm::dyn_cast<llvm::ConstantInt>(init)) {
+        uint64_t v = CI->getZExtValue();
+        std::string bytes(entry.size, '\0');
+        for (size_t i = 0; i < bytes.size() && i < sizeof(v); i++)
+            bytes[i] = char(v >> (8 * i));
+        entry.data = strings.intern(bytes);
+    } else if (!init->isNullValue() && !llvm::isa<llvm::UndefValue>(init)) {
+        err = "global " + G.getName().str() + ": cannot encode its initializer";
+        return false;
+    }
+    globals.push_back(entry);
+    return true;
+}
+
+bool DGMWriter::write(const std::string &filename) const {
+    DGMHeader header{};
+    std::memcpy(header.magic, DGMMagic, sizeof(DGMMagic));
+    header.version = DGMVersion;
+    header.functionCount = uint32_t(functions.size());
+    header.blockCount = uint32_t(blocks.size());
+    header.globalCount = uint32_t(globals.size());
+    header.functionIndexOffset = sizeof(DGMHeader);
+    header.blockIndexOffset = header.functionIndexOffset +
+                              uint32_t(functions.size() * sizeof(DGMFunctionEntry));
+    header.globalIndexOffset = header.blockIndexOffset + uint32_t(blocks.size() * sizeof(DGMBlockEntry));
+    header.stringsOffset = header.globalIndexOffset + uint32_t(globals.size() * sizeof(DGMGlobalEntry));
+    header.codeOffset = header.stringsOffset + uint32_t(strings.data().size());
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) return false;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(functions.data()),
+              functions.size() * sizeof(DGMFunctionEntry));
+    out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(DGMBlockEntry));
+    out.write(reinterpret_cast<const char*>(globals.data()), globals.size() * sizeof(DGMGlobalEntry));
+    out.write(strings.data().data(), strings.data().size());
+    out.write(code.data(), code.size());
+    return bool(out);
+}
+
+} // namespace
+
+// === Translator ===
+bool translateModuleToDGM(llvm::Module &M, const std::string &filename, std::string &err,
+                          unsigned jobs) {
+    DGMWriter writer;
+    for (auto &G : M.globals()) {
+        if (G.hasInitializer() && !writer.global(G, err)) {
+            llvm::sys::fs::remove(filename);   // never leave a stale file behind
+            return false;
+        }
+    }
+
+    // Intern what function bodies can name: every global value (call and
+    // address operands), signatures, and the opcodes DGM has no code for
+    std::vector<const llvm::Function*> defined;
+    for (const llvm::GlobalValue &G : M.global_values())
+        writer.strings.intern(G.getName());
+    for (const llvm::Function &F : M) {
+        // available_externally bodies only exist for the optimizer to inline
+        if (F.isDeclarationForLinker()) continue;
+        writer.strings.intern(signatureOf(F));
+        defined.push_back(&F);
+    }
+    for (unsigned op = llvm::Instruction::TermOpsBegin; op < llvm::Instruction::OtherOpsEnd; op++)
+        if (toDGM(op) == DGMOp::Unmapped) writer.strings.intern(llvm::Instruction::getOpcodeName(op));
+
+    // Encode functions in parallel, then lay them out in module order
+    std::vector<EncodedFunction> encoded(defined.size());
+    std::vector<FunctionEncoder> encoders(workerCount(defined.size(), jobs),
+                                          FunctionEncoder(writer.strings, M.getDataLayout()));
+    parallelFor(defined.size(), encoders, [&](FunctionEncoder &encoder, size_t i) {
+        encoder.encode(*defined[i], encoded[i]);
+    });
+    for (EncodedFunction &fn : encoded) {
+        if (!fn.error.empty()) {
+            err = fn.error;
+            llvm::sys::fs::remove(filename);
+            return false;
+        }
+        writer.append(fn);
     }
 
-    out.close();
+    if (!writer.write(filename)) {
+        err = "could not write " + filename;
+        return false;
+    }
+    return true;
 }
@@ -0,0 +1,343 @@
+#include "incremental.hpp"
+#include "ast.hpp"
+#include "codegen.hpp"
+#include "dgm.hpp"
+#include "native.hpp"
+#include "optimizer.hpp"
+#include "parallel.hpp"
+#include "pgo.hpp"
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+// Bump when codegen, the DGM format or the lowering change what a unit
+// compiles to, so stale objects are never reused
+static constexpr const char *CacheFormat = "strict-unit-11";
+
+namespace {
+
+#ifdef _WIN32
+constexpr const char *ObjectExtension = ".obj";
+#else
+constexpr const char *ObjectExtension = ".o";
+#endif
+
+struct Unit {
+    std::string name;
+    CodegenUnit codegen;
+    uint64_t hash = 0;                  // own subtree(s)
+    std::vector<Symbol> calls;          // direct callees, sorted and unique
+    std::string path;                   // cache path without extension
+    std::vector<std::string> stalePGO;  // functions the --pgo-use profile no longer fits
+    UnitCounts counts;                  // read from the cache on a hit
+};
+
+struct FuncInfo {
+    FuncDeclAST *decl;
+    uint64_t hash;
+    std::vector<Symbol> calls;
+};
+
+void sortCalls(std::vector<Symbol> &calls) {
+    std::sort(calls.begin(), calls.end());
+    calls.erase(std::unique(calls.begin(), calls.end()), calls.end());
+}
+
+std::string hex(uint64_t v) {
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(v));
+    return buf;
+}
+
+// Writes `from` over `to` atomically, so an interrupted build never leaves
+// a truncated object that a later run would take for a hit
+bool publish(const std::string &from, const std::string &to) {
+    std::error_code ec;
+    fs::rename(from, to, ec);
+    return !ec;
+}
+
+// Unique per process and call: batch compiles sharing a cache may build
+// the same unit from two files at once
+std::string tmpSuffix() {
+    static std::atomic<unsigned> counter{0};
+    return ".tmp" + std::to_string(llvm::sys::Process::getProcessId()) + "-" +
+           std::to_string(counter++);
+}
+
+// Functions the unit defines and their instructions; available_externally
+// copies of other units' Funcs are counted by their own units
+void countDefined(const llvm::Module &M, size_t &functions, size_t &instructions) {
+    functions = instructions = 0;
+    for (const llvm::Function &F : M) {
+        if (F.isDeclarationForLinker()) continue;
+        functions++;
+        instructions += F.getInstructionCount();
+    }
+}
+
+// The counts sit next to the object as "<functions> <ir before> <ir after>"
+bool readCounts(const std::string &path, UnitCounts &counts) {
+    std::ifstream in(path);
+    return bool(in >> counts.functions >> counts.irBefore >> counts.irAfter);
+}
+
+bool writeCounts(const std::string &path, const UnitCounts &counts) {
+    std::string tmp = path + tmpSuffix();
+    {
+        std::ofstream out(tmp);
+        out << counts.functions << " " << counts.irBefore << " " << counts.irAfter << "\n";
+        if (!out) return false;
+    }
+    return publish(tmp, path);
+}
+
+struct UnitWorker {
+    std::unique_ptr<llvm::TargetMachine> TM;
+};
+
+bool compileUnit(ProgramAST &program, Unit &unit, const IncrementalOptions &options,
+                 llvm::TargetMachine *TM, std::string &err) {
+    CodegenContext cg;
+    if (!codegenUnit(program, unit.codegen, cg)) {
+        err = "codegen failed for unit " + unit.name + ":";
+        for (const std::string &e : cg.errors) err += "\n  " + e;
+        return false;
+    }
+    llvm::Module &module = *cg.module;
+    if (options.pgoProfile) annotatePGO(module, *options.pgoProfile, unit.stalePGO);
+    if (options.pgoGen) instrumentPGO(module);
+    if (options.profile) instrumentProfile(module);
+    if (TM) configureModuleForTarget(module, *TM);
+    countDefined(module, unit.counts.functions, unit.counts.irBefore);
+    std::string optErr;
+    if (!optimizeModule(module, options.optLevel, optErr, TM, !options.nativeBackend)) {
+        err = "unit " + unit.name + ": " + optErr;
+        return false;
+    }
+    size_t functionsAfter;   // --stats counts functions before optimization
+    countDefined(module, functionsAfter, unit.counts.irAfter);
+
+    std::error_code ec;
+    llvm::raw_fd_ostream ll(unit.path + ".ll", ec, llvm::sys::fs::OF_None);
+    if (!ec) module.print(ll, nullptr);
+
+    std::string dgmFile = unit.path + ".dgm";
+    std::string dgmErr;
+    if (!translateModuleToDGM(module, dgmFile, dgmErr, 1) && !options.nativeBackend) {
+        err = "unit " + unit.name + ": " + dgmErr;
+        return false;
+    }
+
+    std::string objFile = unit.path + ObjectExtension;
+    std::string tmpFile = objFile + tmpSuffix();
+    if (options.nativeBackend) {
+        std::string objErr;
+        if (!emitObjectFile(module, *TM, tmpFile, objErr)) {
+            err = "unit " + unit.name + ": " + objErr;
+            return false;
+        }
+    } else {
+        std::string nasmFile = unit.path + ".s";
+        std::string nasmErr;
+        if (!emitDGMtoNASM(dgmFile, nasmFile, nasmErr, 1)) {
+            err = "unit " + unit.name + ": " + nasmErr;
+            return false;
+        }
+        if (std::system(nasmAssembleCommand(nasmFile, tmpFile).c_str()) != 0) {
+            err = "NASM failed on unit " + unit.name + " (" + nasmFile + ")";
+            return false;
+        }
+    }
+    // The counts go first: an object in the cache always has them
+    if (!writeCounts(unit.path + ".stats", unit.counts) || !publish(tmpFile, objFile)) {
+        err = "could not write " + objFile;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool buildUnits(ProgramAST &program, const IncrementalOptions &options,
+                std::vector<std::string> &objects, CacheStats &stats, std::string &err) {
+    std::error_code ec;
+    fs::create_directories(options.cacheDir, ec);
+    if (ec) {
+        err = "cannot create cache directory " + options.cacheDir + ": " + ec.message();
+        return false;
+    }
+
+    // Hash every Func once; units and dependency keys reuse the results
+    std::unordered_map<Symbol, FuncInfo> funcs;
+    for (StmtAST *s : program.statements) {
+        auto *fn = dynamic_cast<FuncDeclAST*>(s);
+        if (!fn) continue;
+        ASTHasher h;
+        fn->hash(h);
+        sortCalls(h.calls);
+        funcs[fn->name] = {fn, h.value(), std::move(h.calls)};
+    }
+
+    // One unit per Func and Class, in program order, then main
+    std::vector<Unit> units;
+    ASTHasher mainHash;
+    for (StmtAST *s : program.statements) {
+        if (auto *fn = dynamic_cast<FuncDeclAST*>(s)) {
+            const FuncInfo &info = funcs[fn->name];
+            Unit unit;
+            unit.name = fn->name.string();
+            unit.codegen.definitions.push_back(s);
+            unit.hash = info.hash;
+            unit.calls = info.calls;
+            units.push_back(std::move(unit));
+        } else if (auto *cls = dynamic_cast<ClassDeclAST*>(s)) {
+            ASTHasher h;
+            cls->hash(h);
+            sortCalls(h.calls);
+            Unit unit;
+            unit.name = "Class " + cls->name.string();
+            unit.codegen.definitions.push_back(s);
+            unit.hash = h.value();
+            unit.calls = std::move(h.calls);
+            units.push_back(std::move(unit));
+        } else {
+            s->hash(mainHash);
+        }
+    }
+    Unit mainUnit;
+    mainUnit.name = "main";
+    mainUnit.codegen.hasMain = true;
+    mainUnit.hash = mainHash.value();
+    mainUnit.calls = std::move(mainHash.calls);
+    sortCalls(mainUnit.calls);
+    units.push_back(std::move(mainUnit));
+
+    // Everything besides the AST that decides what a unit compiles to
+    std::string target = llvm::sys::getProcessTriple();
+    std::string targetErr;
+    std::unique_ptr<llvm::TargetMachine> hostTM = createHostTargetMachine(options.optLevel, targetErr);
+    if (hostTM) {
+        target += " " + hostTM->getTargetCPU().str() + " " + hostTM->getTargetFeatureString().str();
+    } else if (options.nativeBackend) {
+        err = targetErr;
+        return false;
+    }
+    ASTHasher flags;
+    flags.add(std::string_view(CacheFormat));
+    flags.add(uint64_t(options.optLevel));
+    flags.add(uint64_t(options.nativeBackend));
+    flags.add(uint64_t(options.profile));
+    flags.add(uint64_t(options.pgoGen));
+    flags.add(options.pgoProfile ? options.pgoProfile->digest : 0);
+    flags.add(uint64_t(DGMVersion));
+    flags.add(target);
+
+    std::vector<size_t> missing;
+    for (size_t u = 0; u < units.size(); u++) {
+        Unit &unit = units[u];
+        std::unordered_set<Symbol> own;
+        for (StmtAST *s : unit.codegen.definitions)
+            if (auto *fn = dynamic_cast<FuncDeclAST*>(s)) own.insert(fn->name);
+
+        // Funcs whose bodies this unit may inline: everything reachable
+        // through calls (from -O1 on, where the inliner runs)
+        std::vector<Symbol> inlined;
+        std::unordered_set<Symbol> seen(own);
+        if (options.optLevel > 0) {
+            std::vector<Symbol> work(unit.calls);
+            while (!work.empty()) {
+                Symbol callee = work.back();
+                work.pop_back();
+                auto it = funcs.find(callee);
+                if (it == funcs.end() || !seen.insert(callee).second) continue;
+                inlined.push_back(callee);
+                work.insert(work.end(), it->second.calls.begin(), it->second.calls.end());
+            }
+            std::sort(inlined.begin(), inlined.end());
+        }
+
+        ASTHasher key;
+        key.add(flags.value());
+        key.add(unit.hash);
+        for (Symbol callee : options.optLevel > 0 ? inlined : unit.calls) {
+            key.add(callee);
+            auto it = funcs.find(callee);
+            if (it == funcs.end()) {
+                key.add(~uint64_t(0));
+            } else if (options.optLevel > 0) {
+                key.add(it->second.hash);
+            } else {
+                key.add(uint64_t(it->second.decl->params.size()));
+            }
+        }
+        unit.path = (fs::path(options.cacheDir) / hex(key.value())).string();
+
+        // Declarations for every call made by a body generated here
+        std::unordered_set<Symbol> callees(unit.calls.begin(), unit.calls.end());
+        for (Symbol name : inlined) {
+            FuncInfo &info = funcs[name];
+            unit.codegen.inlineable.push_back(info.decl);
+            callees.insert(info.calls.begin(), info.calls.end());
+        }
+        std::vector<Symbol> declared;
+        for (Symbol callee : callees)
+            if (funcs.count(callee) && !own.count(callee) &&
+                std::find(inlined.begin(), inlined.end(), callee) == inlined.end())
+                declared.push_back(callee);
+        std::sort(declared.begin(), declared.end());
+        for (Symbol name : declared) unit.codegen.declared.push_back(funcs[name].decl);
+
+        objects.push_back(unit.path + ObjectExtension);
+        if (fs::exists(objects.back(), ec) && readCounts(unit.path + ".stats", unit.counts)) {
+            stats.hits++;
+        } else {
+            stats.misses++;
+            stats.rebuilt.push_back(unit.name);
+            missing.push_back(u);
+        }
+    }
+    auto total = [&] {
+        for (const Unit &unit : units) {
+            stats.total.functions += unit.counts.functions;
+            stats.total.irBefore += unit.counts.irBefore;
+            stats.total.irAfter += unit.counts.irAfter;
+        }
+    };
+    if (missing.empty()) {
+        total();
+        return true;
+    }
+
+    // Compile the misses side by side, each into its own context; target
+    // machines are not shared between threads
+    std::vector<UnitWorker> workers(workerCount(missing.size(), options.jobs));
+    for (UnitWorker &w : workers) w.TM = createHostTargetMachine(options.optLevel, targetErr);
+    std::vector<std::string> errors(missing.size());
+    parallelFor(missing.size(), workers, [&](UnitWorker &w, size_t i) {
+        compileUnit(program, units[missing[i]], options, w.TM.get(), errors[i]);
+    });
+    for (size_t i : missing)
+        stats.stalePGO.insert(stats.stalePGO.end(), units[i].stalePGO.begin(), units[i].stalePGO.end());
+    // Inlineable copies of a Func are checked in every unit that has one
+    std::sort(stats.stalePGO.begin(), stats.stalePGO.end());
+    stats.stalePGO.erase(std::unique(stats.stalePGO.begin(), stats.stalePGO.end()), stats.stalePGO.end());
+    for (const std::string &e : errors) {
+        if (e.empty()) continue;
+        err = e;
+        return false;
+    }
+    total();
+    return true;
+}
@@ -0,0 +1,74 @@
+#include "jit.hpp"
+#include "native.hpp"
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/TargetSelect.h>
+
+using namespace llvm;
+using namespace llvm::orc;
+
+// Runtime entry points (src/runtime.c, linked into strictc)
+extern "C" {
+struct StrictRuntimeSymbol {
+    const char *name;
+    void *address;
+};
+extern const StrictRuntimeSymbol strict_runtime_symbols[];   // ends with {NULL, NULL}
+void strict_flush(void);
+}
+
+int runJIT(std::unique_ptr<Module> M, std::unique_ptr<LLVMContext> context,
+           unsigned optLevel, std::string &err) {
+    InitializeNativeTarget();
+    InitializeNativeTargetAsmPrinter();
+
+    auto fail = [&err](Error e) {
+        err = toString(std::move(e));
+        return -1;
+    };
+
+    auto JTMB = JITTargetMachineBuilder::detectHost();
+    if (!JTMB) return fail(JTMB.takeError());
+    JTMB->setCodeGenOptLevel(toCodeGenLevel(optLevel));
+
+    auto J = LLJITBuilder().setJITTargetMachineBuilder(std::move(*JTMB)).create();
+    if (!J) return fail(J.takeError());
+
+    JITDylib &main = (*J)->getMainJITDylib();
+    MangleAndInterner mangle((*J)->getExecutionSession(), (*J)->getDataLayout());
+    // The runtime functions the module declares, bound to strictc's copy
+    StringMap<void*> table;
+    for (const StrictRuntimeSymbol *s = strict_runtime_symbols; s->name; s++)
+        table[s->name] = s->address;
+    SymbolMap runtime;
+    for (const Function &F : *M) {
+        if (!F.isDeclaration() || F.isIntrinsic()) continue;
+        auto it = table.find(F.getName());
+        if (it != table.end())
+            runtime[mangle(F.getName())] = JITEvaluatedSymbol(
+                pointerToJITTargetAddress(it->second), JITSymbolFlags::Exported);
+    }
+    if (Error e = main.define(absoluteSymbols(std::move(runtime))))
+        return fail(std::move(e));
+
+    // libc and compiler-rt calls the backend may introduce (memset, memcpy, ...)
+    auto process = DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        (*J)->getDataLayout().getGlobalPrefix());
+    if (!process) return fail(process.takeError());
+    main.addGenerator(std::move(*process));
+
+    if (Error e = (*J)->addIRModule(ThreadSafeModule(std::move(M), std::move(context))))
+        return fail(std::move(e));
+
+    auto entry = (*J)->lookup("main");
+    if (!entry) return fail(entry.takeError());
+
+    auto *mainFn = jitTargetAddressToFunction<int (*)()>(entry->getAddress());
+    int status = mainFn();
+    strict_flush();     // before strictc prints anything of its own
+    return status;
+}
@@ -1,110 +1,225 @@
 #include "lexer.hpp"
-#include <cctype>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <istream>
 #include <stdexcept>
 
-Lexer::Lexer(const std::string &src) : source(src), pos(0) {}
+namespace {
 
-char Lexer::peek() const {
-    if (pos >= source.size()) return '\0';
-    return source[pos];
+// === Character Classes ===
+// One table lookup replaces the <cctype> calls (which are locale-aware and
+// go through a function call per character).
+enum : unsigned char {
+    CC_SPACE = 1 << 0,
+    CC_ALPHA = 1 << 1,   // A-Z a-z _
+    CC_DIGIT = 1 << 2,   // 0-9
+    CC_IDENT = CC_ALPHA | CC_DIGIT
+};
+
+constexpr std::array<unsigned char, 256> makeCharClasses() {
+    std::array<unsigned char, 256> t{};
+    for (int c = 'a'; c <= 'z'; c++) t[c] |= CC_ALPHA;
+    for (int c = 'A'; c <= 'Z'; c++) t[c] |= CC_ALPHA;
+    for (int c = '0'; c <= '9'; c++) t[c] |= CC_DIGIT;
+    t['_'] |= CC_ALPHA;
+    t[' '] |= CC_SPACE;
+    t['\t'] |= CC_SPACE;
+    t['\n'] |= CC_SPACE;
+    t['\v'] |= CC_SPACE;
+    t['\f'] |= CC_SPACE;
+    t['\r'] |= CC_SPACE;
+    return t;
+}
+
+constexpr std::array<unsigned char, 256> CharClass = makeCharClasses();
+
+inline bool is(char c, unsigned char cls) {
+    return CharClass[static_cast<unsigned char>(c)] & cls;
+}
+
+// === Keyword Perfect Hash ===
+// hash(word) = (2*len + first + 15*last) mod 64 maps the 26 keywords to
+// distinct slots, so a lookup is one hash, one length check and one memcmp.
+struct Keyword {
+    std::string_view word;
+    TokenType type;
+};
+
+constexpr Keyword Keywords[] = {
+    {"Let", TOK_LET},           {"If", TOK_IF},
+    {"Else", TOK_ELSE},         {"End", TOK_END},
+    {"For", TOK_FOR},           {"While", TOK_WHILE},
+    {"Func", TOK_FUNC},         {"Return", TOK_RETURN},
+    {"Match", TOK_MATCH},       {"Case", TOK_CASE},
+    {"Print", TOK_PRINT},       {"Input", TOK_INPUT},
+    {"Class", TOK_CLASS},       {"Module", TOK_MODULE},
+    {"Import", TOK_IMPORT},     {"Macro", TOK_MACRO},
+    {"Future", TOK_FUTURE},     {"Parallel", TOK_PARALLEL},
+    {"Try", TOK_TRY},           {"Catch", TOK_CATCH},
+    {"Assert", TOK_ASSERT},     {"Defer", TOK_DEFER},
+    {"Interface", TOK_INTERFACE}, {"Unroll", TOK_UNROLL},
+    {"Vectorize", TOK_VECTORIZE}, {"Sync", TOK_SYNC}
+};
+
+constexpr unsigned KeywordSlots = 64;
+
+constexpr unsigned keywordHash(const char *s, size_t len) {
+    return (unsigned(len) * 2 + static_cast<unsigned char>(s[0]) +
+            static_cast<unsigned char>(s[len - 1]) * 15) & (KeywordSlots - 1);
+}
+
+constexpr std::array<Keyword, KeywordSlots> makeKeywordTable() {
+    std::array<Keyword, KeywordSlots> t{};
+    for (const Keyword &k : Keywords)
+        t[keywordHash(k.word.data(), k.word.size())] = k;
+    return t;
+}
+
+constexpr std::array<Keyword, KeywordSlots> KeywordTable = makeKeywordTable();
+
+// Every keyword must land in its own slot; adding a keyword that collides
+// fails the build here rather than silently shadowing another one.
+constexpr bool keywordTableIsPerfect() {
+    for (const Keyword &k : Keywords) {
+        const Keyword &slot = KeywordTable[keywordHash(k.word.data(), k.word.size())];
+        if (slot.word != k.word) return false;
+    }
+    return true;
 }
+static_assert(keywordTableIsPerfect(), "keyword hash has collisions");
 
-char Lexer::get() {
-    if (pos >= source.size()) return '\0';
-    return source[pos++];
+inline TokenType classifyIdent(const char *s, size_t len) {
+    const Keyword &k = KeywordTable[keywordHash(s, len)];
+    if (k.word.size() == len && k.word == std::string_view(s, len))
+        return k.type;
+    return TOK_IDENTIFIER;
+}
+
+} // namespace
+
+Lexer::Lexer(const std::string &src)
+    : source(src), cur(source.data()), end(source.data() + source.size()),
+      stream(nullptr), chunkSize(0) {}
+
+Lexer::Lexer(const char *first, const char *last)
+    : cur(first), end(last), stream(nullptr), chunkSize(0) {}
+
+Lexer::Lexer(std::istream &in, size_t chunk)
+    : cur(nullptr), end(nullptr), stream(&in), chunkSize(chunk ? chunk : DefaultChunkSize) {
+    window.resize(chunkSize);
+    cur = end = window.data();
+}
+
+// Slides the unconsumed tail [keep, end) to the front of the window and
+// appends the next chunk. `keep` (the start of the token being scanned) and
+// `cur` are rebased onto the window. Returns false once the stream is dry.
+bool Lexer::refill(const char *&keep) {
+    if (!stream) return false;
+
+    size_t kept = end - keep;
+    size_t curOff = cur - keep;
+    if (kept && keep != window.data())
+        std::memmove(window.data(), keep, kept);
+    if (window.size() < kept + chunkSize)
+        window.resize(kept + chunkSize); // only for a token longer than a chunk
+
+    stream->read(window.data() + kept, chunkSize);
+    size_t got = static_cast<size_t>(stream->gcount());
+
+    keep = window.data();
+    cur = keep + curOff;
+    end = keep + kept + got;
+    if (got == 0) {
+        stream = nullptr;
+        return false;
+    }
+    return true;
 }
 
 void Lexer::skipWhitespace() {
-    while (std::isspace(peek())) get();
+    for (;;) {
+        while (cur < end && is(*cur, CC_SPACE)) cur++;
+        if (cur < end || !refill(cur)) return;
+    }
 }
 
 Token Lexer::nextToken() {
     skipWhitespace();
 
-    char c = peek();
-    if (c == '\0') return {TOK_EOF, "", 0};
+    if (cur >= end || *cur == '\0') return {TOK_EOF, "", 0};
+    const char *start = cur;
+    char c = *cur;
 
     // Identifiers & Keywords
-    if (std::isalpha(c) || c == '_') {
-        std::string ident;
-        while (std::isalnum(peek()) || peek() == '_')
-            ident.push_back(get());
-
-        // Keywords
-        if (ident == "Let") return {TOK_LET, ident};
-        if (ident == "If") return {TOK_IF, ident};
-        if (ident == "Else") return {TOK_ELSE, ident};
-        if (ident == "End") return {TOK_END, ident};
-        if (ident == "For") return {TOK_FOR, ident};
-        if (ident == "While") return {TOK_WHILE, ident};
-        if (ident == "Func") return {TOK_FUNC, ident};
-        if (ident == "Return") return {TOK_RETURN, ident};
-        if (ident == "Match") return {TOK_MATCH, ident};
-        if (ident == "Case") return {TOK_CASE, ident};
-        if (ident == "Print") return {TOK_PRINT, ident};
-        if (ident == "Input") return {TOK_INPUT, ident};
-        if (ident == "Class") return {TOK_CLASS, ident};
-        if (ident == "Module") return {TOK_MODULE, ident};
-        if (ident == "Import") return {TOK_IMPORT, ident};
-        if (ident == "Macro") return {TOK_MACRO, ident};
-        if (ident == "Future") return {TOK_FUTURE, ident};
-        if (ident == "Parallel") return {TOK_PARALLEL, ident};
-        if (ident == "Try") return {TOK_TRY, ident};
-        if (ident == "Catch") return {TOK_CATCH, ident};
-        if (ident == "Assert") return {TOK_ASSERT, ident};
-        if (ident == "Defer") return {TOK_DEFER, ident};
-        if (ident == "Interface") return {TOK_INTERFACE, ident};
-
-        return {TOK_IDENTIFIER, ident};
+    if (is(c, CC_ALPHA)) {
+        cur++;
+        for (;;) {
+            while (cur < end && is(*cur, CC_IDENT)) cur++;
+            if (cur < end || !refill(start)) break;
+        }
+        size_t len = cur - start;
+        return {classifyIdent(start, len), std::string_view(start, len)};
     }
 
     // Numbers
-    if (std::isdigit(c)) {
-        std::string num;
-        while (std::isdigit(peek())) num.push_back(get());
-        return {TOK_NUMBER, num, std::stoi(num)};
+    if (is(c, CC_DIGIT)) {
+        long long val = 0;
+        for (;;) {
+            while (cur < end && is(*cur, CC_DIGIT)) {
+                val = val * 10 + (*cur - '0');
+                if (val > INT_MAX)
+                    throw std::out_of_range("Integer literal out of range");
+                cur++;
+            }
+            if (cur < end || !refill(start)) break;
+        }
+        return {TOK_NUMBER, std::string_view(start, cur - start), int(val)};
     }
 
     // Strings
     if (c == '"') {
-        get(); // consume "
-        std::string str;
-        while (peek() != '"' && peek() != '\0') {
-            str.push_back(get());
+        cur++; // consume "
+        for (;;) {
+            while (cur < end && *cur != '"' && *cur != '\0') cur++;
+            if (cur < end || !refill(start)) break;
         }
-        if (peek() == '"') get(); // consume closing "
+        std::string_view str(start + 1, cur - start - 1);
+        if (cur < end && *cur == '"') cur++; // consume closing "
         return {TOK_STRING, str};
     }
 
     // Operators and punctuation
+    cur++;
+    if (cur == end) refill(start);
+    char next = cur < end ? *cur : '\0';
     switch (c) {
-        case '+': get(); return {TOK_OP, "+"};
-        case '-': get(); return {TOK_OP, "-"};
-        case '*': get(); return {TOK_OP, "*"};
-        case '/': get(); return {TOK_OP, "/"};
+        case '+': return {OpToken::Plus, "+"};
+        case '-': return {OpToken::Minus, "-"};
+        case '*': return {OpToken::Star, "*"};
+        case '/': return {OpToken::Slash, "/"};
         case '=':
-            get();
-            if (peek() == '=') { get(); return {TOK_OP, "=="}; }
+            if (next == '=') { cur++; return {OpToken::EqEq, "=="}; }
             return {TOK_ASSIGN, "="};
+        case '!':
+            if (next == '=') { cur++; return {OpToken::NotEq, "!="}; }
+            return {OpToken::Bang, "!"};
         case '<':
-            get();
-            if (peek() == '=') { get(); return {TOK_OP, "<="}; }
-            return {TOK_OP, "<"};
+            if (next == '=') { cur++; return {OpToken::LessEq, "<="}; }
+            return {OpToken::Less, "<"};
         case '>':
-            get();
-            if (peek() == '=') { get(); return {TOK_OP, ">="}; }
-            return {TOK_OP, ">"};
-        case '(': get(); return {TOK_LPAREN, "("};
-        case ')': get(); return {TOK_RPAREN, ")"};
-        case '{': get(); return {TOK_LBRACE, "{"};
-        case '}': get(); return {TOK_RBRACE, "}"};
-        case '[': get(); return {TOK_LBRACK, "["};
-        case ']': get(); return {TOK_RBRACK, "]"};
-        case ',': get(); return {TOK_COMMA, ","};
-        case ':': get(); return {TOK_COLON, ":"};
+            if (next == '=') { cur++; return {OpToken::GreaterEq, ">="}; }
+            return {OpToken::Greater, ">"};
+        case '(': return {TOK_LPAREN, "("};
+        case ')': return {TOK_RPAREN, ")"};
+        case '{': return {TOK_LBRACE, "{"};
+        case '}': return {TOK_RBRACE, "}"};
+        case '[': return {TOK_LBRACK, "["};
+        case ']': return {TOK_RBRACK, "]"};
+        case ',': return {TOK_COMMA, ","};
+        case ':': return {TOK_COLON, ":"};
         case '.':
-            get();
-            if (peek() == '.') { get(); return {TOK_DOTDOT, ".."}; }
+            if (next == '.') { cur++; return {TOK_DOTDOT, ".."}; }
             return {TOK_DOT, "."};
     }
 
@@ -3,9 +3,25 @@
 #include "ast.hpp"
 #include "codegen.hpp"
 #include "dgm.hpp"
+#include "incremental.hpp"
+#include "jit.hpp"
+#include "native.hpp"
+#include "optimizer.hpp"
+#include "pgo.hpp"
+#include "source.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cstdlib>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -13,9 +29,21 @@
 #include <windows.h>
 #endif
 
-// Helper: run a shell command
-int runCommand(const std::string &cmd) {
-    std::cout << ">> " << cmd << "\n";
+// Runtime linked into every program: the library CMake builds from
+// runtime.c once, alongside strictc
+#ifndef STRICT_RUNTIME_LIBRARY
+#ifdef _WIN32
+#define STRICT_RUNTIME_LIBRARY "src\\runtime.obj"
+#else
+#define STRICT_RUNTIME_LIBRARY "src/runtime.c"
+#endif
+#endif
+
+enum class Backend { DGM, LLVM };
+
+// Helper: run a shell command, echoing it to `log`
+int runCommand(const std::string &cmd, std::ostream &log = std::cout) {
+    log << ">> " << cmd << "\n";
 #ifdef _WIN32
     return system(cmd.c_str());
 #else
@@ -23,73 +51,530 @@ int runCommand(const std::string &cmd) {
 #endif
 }
 
-int main(int argc, char **argv) {
-    if (argc < 2) {
-        std::cerr << "Usage: strictc <file.strict> [-o output.exe]\n";
-        return 1;
+// Helper: the system C compiler, `$CC` or cc
+std::string ccCommand() {
+    const char *cc = std::getenv("CC");
+    return cc && *cc ? cc : "cc";
+}
+
+// Helper: link command using the system C compiler, against the prebuilt
+// runtime (see prepareRuntime)
+std::string ccLinkCommand(const std::vector<std::string> &objFiles, const std::string &runtime,
+                          const std::string &outFile) {
+    std::string cmd = ccCommand();
+    for (const std::string &obj : objFiles) cmd += " " + obj;
+    // The runtime's thread pool (Parallel For) needs pthreads
+    return cmd + " " + runtime + " -pthread -o " + outFile;
+}
+
+// Helper: link command for the host (MSVC link.exe on Windows)
+std::string linkCommand(const std::vector<std::string> &objFiles, const std::string &runtime,
+                        const std::string &outFile) {
+#ifdef _WIN32
+    std::string cmd = "link";
+    for (const std::string &obj : objFiles) cmd += " " + obj;
+    return cmd + " " + runtime + " /OUT:" + outFile + " /SUBSYSTEM:CONSOLE";
+#else
+    return ccLinkCommand(objFiles, runtime, outFile);
+#endif
+}
+
+struct BuildOptions {
+    unsigned optLevel = 0;
+    Backend backend = Backend::DGM;
+    std::string runtime = STRICT_RUNTIME_LIBRARY;   // library, object or C source
+    bool run = false;
+    bool dgmText = false;
+    unsigned jobs = 0;          // worker threads; 0 = one per core
+    bool cache = false;
+    std::string cacheDir = ".strict-cache";
+    bool stats = false;
+    bool timePasses = false;
+    bool profile = false;
+    bool pgoGen = false;
+    std::string pgoUse;         // --pgo-use=FILE
+    PGOProfile pgoProfile;      // read from it once, before any file compiles
+    std::string statsJSON;      // --stats-json=FILE ("-" for stdout)
+};
+
+// One input of a build. Messages are collected per file and printed in one
+// piece, so files compiled side by side never interleave their output.
+struct FileBuild {
+    std::string input;
+    std::string baseName;
+    std::string outFile;
+    std::ostringstream out;
+    std::ostringstream err;
+    std::vector<std::string> objects;   // linked by the second stage
+    std::string nasmFile;               // still to be assembled (DGM backend)
+    bool ccLink = false;                // link with the C compiler on every host
+    int exitStatus = 0;                 // program status under --run
+    CompileStats stats;                 // every phase is timed; --stats prints them
+
+    void flush() {
+        static std::mutex printing;
+        std::lock_guard<std::mutex> guard(printing);
+        std::cout << out.str() << std::flush;
+        std::cerr << err.str() << std::flush;
+        out.str("");
+        err.str("");
     }
+};
 
-    std::string inputFile = argv[1];
-    std::string baseName = inputFile.substr(0, inputFile.find_last_of('.'));
-    std::string outFile = baseName + ".exe";
+// Functions edited since the --pgo-use profile was taken compile without it
+void warnStalePGO(FileBuild &file, const BuildOptions &opts, const std::vector<std::string> &stale) {
+    if (stale.empty()) return;
+    file.err << "Warning: " << opts.pgoUse << " is out of date for " << stale.size() << " function(s) of "
+             << file.input << " (" << stale[0] << (stale.size() > 1 ? ", ..." : "")
+             << "); rerun a --pgo-gen build\n";
+}
 
-    // Allow -o flag
-    for (int i = 2; i < argc; i++) {
-        if (std::string(argv[i]) == "-o" && i + 1 < argc) {
-            outFile = argv[i + 1];
-            i++;
+// Stage 1: parse, generate, optimize and lower one file down to an object
+// (LLVM backend, cache) or NASM source (DGM backend). `jobs` bounds the
+// threads used inside the file.
+bool compileFile(FileBuild &file, const BuildOptions &opts, unsigned jobs) {
+    // 1. Map the source file. Pipes, FIFOs and "-" (stdin) cannot be
+    //    mapped and are lexed through a bounded streaming window instead.
+    SourceFile mapped;
+    std::ifstream src;
+    std::unique_ptr<Lexer> lex;
+    if (file.input == "-") {
+        lex.reset(new Lexer(std::cin));
+    } else if (mapped.open(file.input)) {
+        lex.reset(new Lexer(mapped.begin(), mapped.end()));
+    } else {
+        src.open(file.input, std::ios::binary);
+        if (!src.is_open()) {
+            file.err << "Error: cannot open " << file.input << "\n";
+            return false;
         }
+        lex.reset(new Lexer(src));
     }
 
-    // 1. Read source file
-    std::ifstream src(inputFile);
-    if (!src.is_open()) {
-        std::cerr << "Error: cannot open " << inputFile << "\n";
-        return 1;
+    // 2. Lex & Parse (the lexer runs on demand inside the parser)
+    CompileStats &stats = file.stats;
+    stats.input = file.input;
+    PhaseTimer parseTimer(stats, "parse");
+    ProgramAST program;
+    try {
+        Parser parser(*lex);
+        program = parser.parseProgram();
+        stats.tokens = parser.tokenCount();
+        stats.astNodes = parser.nodeCount();
+    } catch (const std::exception &e) {
+        file.err << "Error: " << file.input << ": " << e.what() << "\n";
+        return false;
     }
-    std::string source((std::istreambuf_iterator<char>(src)),
-                        std::istreambuf_iterator<char>());
-
-    // 2. Lex & Parse
-    Lexer lex(source);
-    Parser parser(lex);
-    ProgramAST program = parser.parseProgram();
+    mapped.close();
+    stats.astBytes = program.arena.bytesUsed();
+    parseTimer.stop();
 
     // Debug: print AST
     // program.print();
 
+    // --cache: compile each Func/Class/main unit separately, reusing
+    // unchanged ones from the cache, and link the unit objects
+    if (opts.cache && !opts.run) {
+        IncrementalOptions options;
+        options.cacheDir = opts.cacheDir;
+        options.optLevel = opts.optLevel;
+        options.nativeBackend = opts.backend == Backend::LLVM;
+        options.jobs = jobs;
+        options.profile = opts.profile;
+        options.pgoGen = opts.pgoGen;
+        options.pgoProfile = opts.pgoUse.empty() ? nullptr : &opts.pgoProfile;
+        CacheStats cacheStats;
+        std::string cacheErr;
+        PhaseTimer unitsTimer(stats, "units");
+        if (!buildUnits(program, options, file.objects, cacheStats, cacheErr)) {
+            file.err << "Error: " << cacheErr << "\n";
+            return false;
+        }
+        unitsTimer.stop();
+        warnStalePGO(file, opts, cacheStats.stalePGO);
+        stats.cacheHits = cacheStats.hits;
+        stats.cacheMisses = cacheStats.misses;
+        stats.functions = cacheStats.total.functions;
+        stats.irBefore = cacheStats.total.irBefore;
+        stats.irAfter = cacheStats.total.irAfter;
+        file.out << "Units: " << file.objects.size() << " (" << cacheStats.hits << " cached)\n";
+        if (opts.stats) {
+            file.out << "cache: " << cacheStats.hits << " hits, " << cacheStats.misses
+                     << " misses (" << opts.cacheDir << ")\n";
+            for (const std::string &unit : cacheStats.rebuilt)
+                file.out << "  rebuilt " << unit << "\n";
+        }
+        return true;
+    }
+    if (opts.stats) file.out << "cache: off (use --cache)\n";
+
     // 3. Generate LLVM IR
-    std::string llFile = baseName + ".ll";
-    program.codegen();
+    std::string llFile = file.baseName + ".ll";
+    PhaseTimer codegenTimer(stats, "codegen");
+    if (!program.codegen()) {
+        for (const std::string &e : program.cg->errors)
+            file.err << "Codegen error: " << file.input << ": " << e << "\n";
+        return false;
+    }
+    llvm::Module &module = *program.getModule();
+    // Profile-guided: annotate and instrument the IR exactly as codegen
+    // left it, so counters and weights land on the same branches
+    if (!opts.pgoUse.empty()) {
+        std::vector<std::string> stale;
+        annotatePGO(module, opts.pgoProfile, stale);
+        warnStalePGO(file, opts, stale);
+    }
+    if (opts.pgoGen) instrumentPGO(module);
+    if (opts.profile) instrumentProfile(module);
+    codegenTimer.stop();
+    for (const llvm::Function &F : module) stats.functions += !F.isDeclaration();
+    stats.irBefore = module.getInstructionCount();
+
+    // The host target feeds the optimizer's cost models; the LLVM backend
+    // also emits through it.
+    PhaseTimer targetTimer(stats, "target");
+    std::string targetErr;
+    std::unique_ptr<llvm::TargetMachine> TM = createHostTargetMachine(opts.optLevel, targetErr);
+    if (TM) {
+        configureModuleForTarget(module, *TM);
+    } else if (opts.backend == Backend::LLVM || opts.run) {
+        file.err << "Error: " << targetErr << "\n";
+        return false;
+    }
+    targetTimer.stop();
+
+    // The DGM lowering is scalar-only, so it gets an unvectorized pipeline
+    bool forDGM = opts.backend == Backend::DGM && !opts.run;
+    PhaseTimer optTimer(stats, "optimize");
+    PassTimer passTimer;
+    std::string optErr;
+    if (!optimizeModule(module, opts.optLevel, optErr, TM.get(), forDGM,
+                        opts.timePasses ? &passTimer : nullptr)) {
+        file.err << "Error: " << file.input << ": " << optErr << "\n";
+        return false;
+    }
+    optTimer.stop();
+    passTimer.report(stats.passes);
+    stats.irAfter = module.getInstructionCount();
+
+    // --run: JIT-compile and execute in-process; no artifacts are written
+    // and the exit status is the program's own.
+    if (opts.run) {
+        std::unique_ptr<llvm::LLVMContext> context;
+        std::unique_ptr<llvm::Module> owned = program.takeModule(context);
+        std::string jitErr;
+        PhaseTimer runTimer(stats, "jit + run");
+        file.exitStatus = runJIT(std::move(owned), std::move(context), opts.optLevel, jitErr);
+        runTimer.stop();
+        if (!jitErr.empty()) {
+            file.err << "Error: " << jitErr << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    PhaseTimer irTimer(stats, "emit IR");
     program.emitIR(llFile);
+    irTimer.stop();
 
-    std::cout << "Generated LLVM IR: " << llFile << "\n";
+    file.out << "Generated LLVM IR: " << llFile << "\n";
 
-    // 4. Translate to DGM
-    std::string dgmFile = baseName + ".dgm";
-    translateModuleToDGM(*program.getModule(), dgmFile);
-    std::cout << "Generated DGM: " << dgmFile << "\n";
+    // 4. Translate to DGM (kept as the audit artifact on both backends)
+    std::string dgmFile = file.baseName + ".dgm";
+    PhaseTimer dgmTimer(stats, "DGM translate");
+    std::string dgmErr;
+    bool haveDGM = translateModuleToDGM(module, dgmFile, dgmErr, jobs);
+    dgmTimer.stop();
+    if (haveDGM) {
+        file.out << "Generated DGM: " << dgmFile << "\n";
+        if (opts.dgmText) {
+            std::string dgmTextFile = dgmFile + ".txt";
+            PhaseTimer listingTimer(stats, "DGM listing");
+            dumpDGMText(dgmFile, dgmTextFile);
+            listingTimer.stop();
+            file.out << "Generated DGM listing: " << dgmTextFile << "\n";
+        }
+    } else if (opts.backend == Backend::DGM) {
+        file.err << "Error: " << file.input << ": " << dgmErr << "\n";
+        return false;
+    } else {
+        // The LLVM backend never reads the DGM back, so a module it cannot
+        // spell (vector code at -O3, say) only costs the audit artifact
+        file.err << "Warning: " << file.input << ": no DGM written: " << dgmErr << "\n";
+    }
+
+    if (opts.backend == Backend::LLVM) {
+        // 5. Emit a native object in-process
+        std::string objFile = file.baseName + ".o";
+        PhaseTimer objTimer(stats, "emit object");
+        std::string objErr;
+        if (!emitObjectFile(module, *TM, objFile, objErr)) {
+            file.err << "Error: " << file.input << ": " << objErr << "\n";
+            return false;
+        }
+        objTimer.stop();
+        file.out << "Generated object: " << objFile << "\n";
+        file.objects = {objFile};
+        file.ccLink = true;
+        return true;
+    }
 
     // 5. Emit NASM
-    std::string nasmFile = baseName + ".s";
-    emitDGMtoNASM(dgmFile, nasmFile);
-    std::cout << "Generated NASM: " << nasmFile << "\n";
-
-    // 6. Assemble with NASM
-    std::string objFile = baseName + ".obj";
-    std::string nasmCmd = "nasm -f win64 " + nasmFile + " -o " + objFile;
-    if (runCommand(nasmCmd) != 0) {
-        std::cerr << "Error: NASM failed.\n";
+    file.nasmFile = file.baseName + ".s";
+    PhaseTimer nasmTimer(stats, "emit NASM");
+    std::string nasmErr;
+    if (!emitDGMtoNASM(dgmFile, file.nasmFile, nasmErr, jobs)) {
+        file.err << "Error: " << file.input << ": " << nasmErr << "\n";
+        return false;
+    }
+    nasmTimer.stop();
+    file.out << "Generated NASM: " << file.nasmFile << "\n";
+#ifdef _WIN32
+    file.objects = {file.baseName + ".obj"};
+#else
+    file.objects = {file.baseName + ".o"};
+#endif
+    return true;
+}
+
+// Stage 2: the external tools. Assemble with NASM if needed (the emitter
+// targets the host ABI: Win64 on Windows, System V elsewhere), then link
+// with MSVC link.exe or the system C compiler.
+bool linkFile(FileBuild &file, const BuildOptions &opts) {
+    if (!file.nasmFile.empty()) {
+        PhaseTimer nasmTimer(file.stats, "assemble");
+        if (runCommand(nasmAssembleCommand(file.nasmFile, file.objects[0]), file.out) != 0) {
+            file.err << "Error: NASM failed.\n";
+            return false;
+        }
+        nasmTimer.stop();
+    }
+    std::string linkCmd = file.ccLink ? ccLinkCommand(file.objects, opts.runtime, file.outFile)
+                                      : linkCommand(file.objects, opts.runtime, file.outFile);
+    PhaseTimer linkTimer(file.stats, "link");
+    if (runCommand(linkCmd, file.out) != 0) {
+        file.err << "Error: linking failed.\n";
+        return false;
+    }
+    linkTimer.stop();
+    file.out << "✅ Built executable: " << file.outFile << "\n";
+    return true;
+}
+
+// A runtime given as C source (--runtime=x.c, or a strictc built without
+// CMake) is compiled once into a temporary object that every link of this
+// run shares, rather than once per executable. `object` names that file,
+// for the caller to remove.
+bool prepareRuntime(BuildOptions &opts, std::string &object) {
+    if (llvm::sys::path::extension(opts.runtime) != ".c") return true;
+    llvm::SmallString<128> path;
+    if (llvm::sys::fs::createTemporaryFile("strict-runtime", "o", path)) {
+        std::cerr << "Error: cannot create a temporary file for the runtime\n";
+        return false;
+    }
+    object = std::string(path.str());
+    // Optimized whatever the program's -O level, like a prebuilt library
+    if (runCommand(ccCommand() + " -O2 -c " + opts.runtime + " -o " + object) != 0) {
+        std::cerr << "Error: cannot compile the runtime " << opts.runtime << "\n";
+        return false;
+    }
+    opts.runtime = object;
+    return true;
+}
+
+// The --stats / --time-passes table, once the file's last phase is done
+void reportStats(FileBuild &file, const BuildOptions &opts) {
+    if (opts.stats || opts.timePasses) printStatsTable(file.stats, file.out);
+}
+
+// --stats-json: every file's phases in one document, for trending
+bool writeStatsFile(const std::vector<std::unique_ptr<FileBuild>> &files, const BuildOptions &opts,
+                    double wallMs) {
+    if (opts.statsJSON.empty()) return true;
+    std::vector<const CompileStats*> all;
+    for (const auto &file : files) all.push_back(&file->stats);
+    if (opts.statsJSON == "-") {
+        writeStatsJSON(all, wallMs, std::cout);
+        return true;
+    }
+    std::ofstream out(opts.statsJSON);
+    if (out) writeStatsJSON(all, wallMs, out);
+    if (!out) {
+        std::cerr << "Error: cannot write " << opts.statsJSON << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Adds `path` to the inputs: a directory contributes every *.strict file
+// below it, in sorted order so batch output is reproducible.
+bool addInput(const std::string &path, std::vector<std::string> &inputs) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    if (path == "-" || !fs::is_directory(path, ec)) {
+        inputs.push_back(path);
+        return true;
+    }
+    std::vector<std::string> found;
+    for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec))
+        if (it->is_regular_file(ec) && it->path().extension() == ".strict")
+            found.push_back(it->path().string());
+    if (ec) {
+        std::cerr << "Error: cannot read directory " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    if (found.empty()) {
+        std::cerr << "Error: no .strict files in " << path << "\n";
+        return false;
+    }
+    std::sort(found.begin(), found.end());
+    inputs.insert(inputs.end(), found.begin(), found.end());
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: strictc <file.strict | dir | ->... [-o output.exe] [-O0|-O1|-O2|-O3]\n"
+                     "               [--backend=dgm|llvm] [--runtime=runtime.c] [--run]\n"
+                     "               [--dgm-text] [--jobs=N] [--cache[=dir]] [--stats]\n"
+                     "               [--time-passes] [--stats-json=FILE] [--profile]\n"
+                     "               [--pgo-gen] [--pgo-use=profile.data]\n";
         return 1;
     }
 
-    // 7. Link with MSVC link.exe
-    std::string linkCmd = "link " + objFile + " src\\runtime.obj /OUT:" + outFile + " /SUBSYSTEM:CONSOLE";
-    if (runCommand(linkCmd) != 0) {
-        std::cerr << "Error: linking failed.\n";
+    BuildOptions opts;
+    std::vector<std::string> inputs;
+    std::string outFile;
+
+    // Inputs anywhere on the command line, plus -o, -O<n>, --backend=,
+    // --runtime=, --run, --dgm-text, --jobs=, --cache[=dir], --stats,
+    // --time-passes, --stats-json=, --profile, --pgo-gen and --pgo-use= flags
+    double startMs = wallClockMs();
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            outFile = argv[i + 1];
+            i++;
+        } else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' &&
+                   arg[2] >= '0' && arg[2] <= '3') {
+            opts.optLevel = arg[2] - '0';
+        } else if (arg == "--backend=dgm") {
+            opts.backend = Backend::DGM;
+        } else if (arg == "--backend=llvm") {
+            opts.backend = Backend::LLVM;
+        } else if (arg.compare(0, 10, "--runtime=") == 0) {
+            opts.runtime = arg.substr(10);
+        } else if (arg == "--run") {
+            opts.run = true;
+        } else if (arg == "--dgm-text") {
+            opts.dgmText = true;
+        } else if (arg.compare(0, 7, "--jobs=") == 0 && arg.size() > 7 &&
+                   arg.find_first_not_of("0123456789", 7) == std::string::npos) {
+            opts.jobs = unsigned(std::stoul(arg.substr(7)));
+        } else if (arg == "--cache") {
+            opts.cache = true;
+        } else if (arg.compare(0, 8, "--cache=") == 0 && arg.size() > 8) {
+            opts.cache = true;
+            opts.cacheDir = arg.substr(8);
+        } else if (arg == "--stats") {
+            opts.stats = true;
+        } else if (arg == "--profile") {
+            opts.profile = true;
+        } else if (arg == "--pgo-gen") {
+            opts.pgoGen = true;
+        } else if (arg.compare(0, 10, "--pgo-use=") == 0 && arg.size() > 10) {
+            opts.pgoUse = arg.substr(10);
+        } else if (arg == "--time-passes") {
+            opts.timePasses = true;
+        } else if (arg.compare(0, 13, "--stats-json=") == 0 && arg.size() > 13) {
+            opts.statsJSON = arg.substr(13);
+        } else if (arg == "-" || arg[0] != '-') {
+            if (!addInput(arg, inputs)) return 1;
+        } else {
+            std::cerr << "Error: unknown option " << arg << "\n";
+            return 1;
+        }
+    }
+
+    if (inputs.empty()) {
+        std::cerr << "Error: no input files\n";
         return 1;
     }
+    if (inputs.size() > 1) {
+        const char *single = !outFile.empty() ? "-o"
+                           : opts.run ? "--run"
+                           : std::count(inputs.begin(), inputs.end(), "-") ? "- (stdin)"
+                           : nullptr;
+        if (single) {
+            std::cerr << "Error: " << single << " takes a single input file\n";
+            return 1;
+        }
+    }
+
+    if (!opts.pgoUse.empty()) {
+        std::string pgoErr;
+        if (!readPGOProfile(opts.pgoUse, opts.pgoProfile, pgoErr)) {
+            std::cerr << "Error: " << pgoErr << "\n";
+            return 1;
+        }
+    }
+
+    // Every link shares one runtime build; a temporary one is removed on
+    // the way out
+    std::string runtimeObject;
+    struct RemoveFile {
+        const std::string &path;
+        ~RemoveFile() { if (!path.empty()) llvm::sys::fs::remove(path); }
+    } removeRuntime{runtimeObject};
+    if (!opts.run && !prepareRuntime(opts, runtimeObject)) return 1;
+
+    std::vector<std::unique_ptr<FileBuild>> files;
+    for (const std::string &input : inputs) {
+        auto file = std::make_unique<FileBuild>();
+        file->input = input;
+        file->baseName = input == "-" ? "stdin" : input.substr(0, input.find_last_of('.'));
+        file->outFile = outFile.empty() ? file->baseName + ".exe" : outFile;
+        files.push_back(std::move(file));
+    }
+
+    // A single file keeps every thread for its own functions and units
+    if (files.size() == 1) {
+        FileBuild &file = *files[0];
+        bool ok = compileFile(file, opts, opts.jobs);
+        file.flush();
+        if (ok && !opts.run) ok = linkFile(file, opts);
+        reportStats(file, opts);
+        file.flush();
+        if (!writeStatsFile(files, opts, wallClockMs() - startMs) || !ok) return 1;
+        return file.exitStatus;
+    }
+
+    // Batch: every file is a pool job (inside which work stays serial).
+    // Finishing a compile queues that file's assemble-and-link, so the
+    // external tools for one file run while other files still compile.
+    std::atomic<unsigned> failed{0};
+    {
+        WorkStealingPool pool(opts.jobs);
+        for (auto &owned : files) {
+            FileBuild *file = owned.get();
+            pool.submit([&, file] {
+                if (!compileFile(*file, opts, 1)) {
+                    reportStats(*file, opts);
+                    file->flush();
+                    failed++;
+                    return;
+                }
+                pool.submit([&, file] {
+                    if (!linkFile(*file, opts)) failed++;
+                    reportStats(*file, opts);
+                    file->flush();
+                });
+            });
+        }
+        pool.wait();
+    }
 
-    std::cout << "✅ Built executable: " << outFile << "\n";
-    return 0;
+    std::cout << "Built " << files.size() - failed << " of " << files.size() << " files\n";
+    if (!writeStatsFile(files, opts, wallClockMs() - startMs)) return 1;
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,80 @@
+#include "native.hpp"
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetOptions.h>
+#include <mutex>
+
+using namespace llvm;
+
+CodeGenOpt::Level toCodeGenLevel(unsigned level) {
+    switch (level) {
+        case 0: return CodeGenOpt::None;
+        case 1: return CodeGenOpt::Less;
+        case 2: return CodeGenOpt::Default;
+        default: return CodeGenOpt::Aggressive;
+    }
+}
+
+std::unique_ptr<TargetMachine> createHostTargetMachine(unsigned optLevel,
+                                                       std::string &err) {
+    // Target registration is not thread-safe; batch compiles create
+    // target machines from several workers at once
+    static std::once_flag initialized;
+    std::call_once(initialized, [] {
+        InitializeNativeTarget();
+        InitializeNativeTargetAsmPrinter();
+    });
+
+    std::string triple = sys::getDefaultTargetTriple();
+    const Target *target = TargetRegistry::lookupTarget(triple, err);
+    if (!target) return nullptr;
+
+    // Use every feature of the build machine: the binaries we produce are
+    // run where they are compiled.
+    SubtargetFeatures features;
+    StringMap<bool> hostFeatures;
+    if (sys::getHostCPUFeatures(hostFeatures)) {
+        for (auto &f : hostFeatures)
+            features.AddFeature(f.first(), f.second);
+    }
+
+    TargetOptions options;
+    std::unique_ptr<TargetMachine> TM(target->createTargetMachine(
+        triple, sys::getHostCPUName(), features.getString(), options,
+        Reloc::PIC_, None, toCodeGenLevel(optLevel)));
+    if (!TM) err = "could not create target machine for " + triple;
+    return TM;
+}
+
+void configureModuleForTarget(Module &M, TargetMachine &TM) {
+    M.setTargetTriple(TM.getTargetTriple().str());
+    M.setDataLayout(TM.createDataLayout());
+}
+
+bool emitObjectFile(Module &M, TargetMachine &TM, const std::string &objFile, std::string &err) {
+    std::error_code EC;
+    raw_fd_ostream dest(objFile, EC, sys::fs::OF_None);
+    if (EC) {
+        err = "could not open " + objFile + ": " + EC.message();
+        return false;
+    }
+
+    legacy::PassManager PM;
+    if (TM.addPassesToEmitFile(PM, dest, nullptr, CGFT_ObjectFile)) {
+        err = "target cannot emit object files";
+        return false;
+    }
+    PM.run(M);
+    dest.close();
+    if (dest.has_error()) {
+        err = "could not write " + objFile + ": " + dest.error().message();
+        dest.clear_error();
+        return false;
+    }
+    return true;
+}
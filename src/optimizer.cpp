@@ -0,0 +1,92 @@
+#include "optimizer.hpp"
+#include "stats.hpp"
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/Verifier.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Target/TargetMachine.h>
+
+using namespace llvm;
+
+static OptimizationLevel toLLVMLevel(unsigned level) {
+    switch (level) {
+        case 0: return OptimizationLevel::O0;
+        case 1: return OptimizationLevel::O1;
+        case 2: return OptimizationLevel::O2;
+        default: return OptimizationLevel::O3;
+    }
+}
+
+// The loop vectorizer still runs with vectorization off, for loops whose
+// metadata forces it (`Vectorize`, `Parallel For`). For the scalar-only
+// DGM lowering those hints are replaced by an explicit "never".
+static void disableVectorizeHints(Function &F) {
+    LLVMContext &ctx = F.getContext();
+    for (BasicBlock &BB : F) {
+        Instruction *latch = BB.getTerminator();
+        MDNode *loop = latch ? latch->getMetadata(LLVMContext::MD_loop) : nullptr;
+        if (!loop) continue;
+        SmallVector<Metadata*, 6> ops = {nullptr};
+        for (unsigned i = 1; i < loop->getNumOperands(); i++) {
+            auto *hint = dyn_cast<MDNode>(loop->getOperand(i));
+            auto *name = hint && hint->getNumOperands() ? dyn_cast<MDString>(hint->getOperand(0)) : nullptr;
+            if (name && name->getString().startswith("llvm.loop.vectorize.")) continue;
+            ops.push_back(loop->getOperand(i));
+        }
+        ops.push_back(MDNode::get(ctx, {MDString::get(ctx, "llvm.loop.vectorize.enable"),
+                                        ConstantAsMetadata::get(ConstantInt::getFalse(ctx))}));
+        MDNode *id = MDNode::getDistinct(ctx, ops);
+        id->replaceOperandWith(0, id);
+        latch->setMetadata(LLVMContext::MD_loop, id);
+    }
+}
+
+bool optimizeModule(Module &M, unsigned optLevel, std::string &err, TargetMachine *TM,
+                    bool forDGM, PassTimer *timer) {
+    // The pipeline assumes well-formed IR; refuse rather than crash in a pass
+    std::string findings;
+    raw_string_ostream os(findings);
+    if (verifyModule(M, &os)) {
+        err = "generated IR failed verification:\n" + os.str();
+        return false;
+    }
+
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+
+    PipelineTuningOptions PTO;
+    if (forDGM) {
+        PTO.LoopVectorization = false;
+        PTO.SLPVectorization = false;
+        // SimplifyCFG honours this when deciding on switch lookup tables
+        for (Function &F : M) {
+            if (F.isDeclaration()) continue;
+            F.addFnAttr("no-jump-tables", "true");
+            disableVectorizeHints(F);
+        }
+    }
+    PassInstrumentationCallbacks PIC;
+    if (timer) {
+        PIC.registerBeforeNonSkippedPassCallback(
+            [timer](StringRef pass, Any) { timer->begin(pass.str()); });
+        PIC.registerAfterPassCallback(
+            [timer](StringRef, Any, const PreservedAnalyses &) { timer->end(); });
+        PIC.registerAfterPassInvalidatedCallback(
+            [timer](StringRef, const PreservedAnalyses &) { timer->end(); });
+    }
+    PassBuilder PB(TM, PTO, None, timer ? &PIC : nullptr);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    OptimizationLevel level = toLLVMLevel(optLevel);
+    ModulePassManager MPM = optLevel == 0
+        ? PB.buildO0DefaultPipeline(level)
+        : PB.buildPerModuleDefaultPipeline(level);
+    MPM.run(M, MAM);
+    return true;
+}
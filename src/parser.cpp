@@ -2,12 +2,13 @@
 #include <stdexcept>
 #include <iostream>
 
-Parser::Parser(Lexer &lex) : lexer(lex) {
+Parser::Parser(Lexer &lex) : lexer(lex), program(nullptr) {
     advance();
 }
 
 void Parser::advance() {
     current = lexer.nextToken();
+    tokens++;
 }
 
 bool Parser::match(TokenType type) {
@@ -20,16 +21,18 @@ bool Parser::match(TokenType type) {
 
 void Parser::expect(TokenType type, const std::string &err) {
     if (!match(type)) {
-        throw std::runtime_error("Parse error: expected " + err + " but got " + current.text);
+        throw std::runtime_error("Parse error: expected " + err + " but got " + std::string(current.text));
     }
 }
 
 ProgramAST Parser::parseProgram() {
-    ProgramAST program;
+    ProgramAST result;
+    program = &result;
     while (current.type != TOK_EOF) {
-        program.statements.push_back(parseStatement());
+        result.statements.push_back(parseStatement());
     }
-    return program;
+    program = nullptr;
+    return result;
 }
 
 StmtAST* Parser::parseStatement() {
@@ -38,6 +41,7 @@ StmtAST* Parser::parseStatement() {
         case TOK_IF: return parseIf();
         case TOK_FOR: return parseFor();
         case TOK_WHILE: return parseWhile();
+        case TOK_PARALLEL: return parseParallel();
         case TOK_FUNC: return parseFunc();
         case TOK_CLASS: return parseClass();
         case TOK_MATCH: return parseMatch();
@@ -51,48 +55,48 @@ StmtAST* Parser::parseStatement() {
 
 StmtAST* Parser::parseVarDecl() {
     advance(); // consume Let
-    std::string name = current.text;
+    Symbol name = intern(current.text);
     expect(TOK_IDENTIFIER, "identifier");
 
     ExprAST* init = nullptr;
     if (match(TOK_ASSIGN)) {
         init = parseExpression();
     }
-    return new VarDeclAST(name, init);
+    return make<VarDeclAST>(name, init);
 }
 
 StmtAST* Parser::parseFunc() {
     advance(); // consume Func
-    std::string name = current.text;
+    Symbol name = intern(current.text);
     expect(TOK_IDENTIFIER, "function name");
 
     expect(TOK_LPAREN, "(");
-    std::vector<std::string> params;
+    std::vector<Symbol> params;
     if (current.type != TOK_RPAREN) {
         do {
-            params.push_back(current.text);
+            params.push_back(intern(current.text));
             expect(TOK_IDENTIFIER, "parameter name");
         } while (match(TOK_COMMA));
     }
     expect(TOK_RPAREN, ")");
 
     auto body = parseBlock();
-    return new FuncDeclAST(name, params, body);
+    return make<FuncDeclAST>(name, list(params), body);
 }
 
 StmtAST* Parser::parseClass() {
     advance(); // consume Class
-    std::string name = current.text;
+    Symbol name = intern(current.text);
     expect(TOK_IDENTIFIER, "class name");
 
-    std::string base;
+    Symbol base;
     if (match(TOK_COLON)) {
-        base = current.text;
+        base = intern(current.text);
         expect(TOK_IDENTIFIER, "base class name");
     }
 
     auto body = parseBlock();
-    return new ClassDeclAST(name, base, body);
+    return make<ClassDeclAST>(name, base, body);
 }
 
 // --- Control Flow ---
@@ -102,32 +106,60 @@ StmtAST* Parser::parseIf() {
     ExprAST* cond = parseExpression();
     auto thenBody = parseBlock();
 
-    std::vector<StmtAST*> elseBody;
+    ArenaList<StmtAST*> elseBody;
     if (match(TOK_ELSE)) {
         elseBody = parseBlock();
     }
-    return new IfStmtAST(cond, thenBody, elseBody);
+    return make<IfStmtAST>(cond, thenBody, elseBody);
 }
 
 StmtAST* Parser::parseFor() {
     advance(); // consume For
-    std::string var = current.text;
+    Symbol var = intern(current.text);
     expect(TOK_IDENTIFIER, "loop variable");
     expect(TOK_ASSIGN, "=");
 
     ExprAST* start = parseExpression();
     expect(TOK_DOTDOT, "..");
     ExprAST* end = parseExpression();
+    LoopHints hints = parseLoopHints();
 
     auto body = parseBlock();
-    return new ForStmtAST(var, start, end, body);
+    return make<ForStmtAST>(var, start, end, body, hints);
 }
 
 StmtAST* Parser::parseWhile() {
     advance(); // consume While
     ExprAST* cond = parseExpression();
+    LoopHints hints = parseLoopHints();
     auto body = parseBlock();
-    return new WhileStmtAST(cond, body);
+    return make<WhileStmtAST>(cond, body, hints);
+}
+
+StmtAST* Parser::parseParallel() {
+    advance(); // consume Parallel
+    if (current.type != TOK_FOR)
+        throw std::runtime_error("Parse error: expected For after Parallel but got " + std::string(current.text));
+    auto *loop = static_cast<ForStmtAST*>(parseFor());
+    loop->hints.parallel = true;
+    return loop;
+}
+
+// `Unroll [n]` and `Vectorize [n]`, in any order
+LoopHints Parser::parseLoopHints() {
+    LoopHints hints;
+    for (;;) {
+        int *hint = current.type == TOK_UNROLL ? &hints.unroll
+                  : current.type == TOK_VECTORIZE ? &hints.vectorize
+                  : nullptr;
+        if (!hint) return hints;
+        advance();
+        *hint = 0;
+        if (current.type == TOK_NUMBER) {
+            *hint = current.intVal;
+            advance();
+        }
+    }
 }
 
 StmtAST* Parser::parseMatch() {
@@ -137,15 +169,46 @@ StmtAST* Parser::parseMatch() {
     std::vector<CaseAST*> cases;
     while (current.type == TOK_CASE) {
         advance(); // consume Case
-        ExprAST* pattern = parseExpression();
-        expect(TOK_COLON, ":");
-        auto body = parseBlock();
-        cases.push_back(new CaseAST(pattern, body));
+        cases.push_back(parseCase());
     }
 
+    // Case bodies stop at the next Case or at the Match's own End
     expect(TOK_END, "End");
-    advance();
-    return new MatchStmtAST(expr, cases);
+    return make<MatchStmtAST>(expr, list(cases));
+}
+
+// Patterns: `*`, `<e`, `<=e`, `>e`, `>=e`, `lo..hi` or a single value.
+// Bounds are additive expressions, so they never swallow the comparison.
+CaseAST* Parser::parseCase() {
+    const int BoundPrec = 3;   // binding power of + and - (see InfixTable)
+    CaseKind kind = CaseKind::Value;
+    ExprAST* pattern = nullptr;
+    ExprAST* high = nullptr;
+
+    if (current.type == TOK_OP && current.op == OpToken::Star) {
+        advance();
+        kind = CaseKind::Default;
+    } else if (current.type == TOK_OP && (current.op == OpToken::Less ||
+                                          current.op == OpToken::LessEq ||
+                                          current.op == OpToken::Greater ||
+                                          current.op == OpToken::GreaterEq)) {
+        kind = current.op == OpToken::Less ? CaseKind::Less
+             : current.op == OpToken::LessEq ? CaseKind::LessEq
+             : current.op == OpToken::Greater ? CaseKind::Greater
+             : CaseKind::GreaterEq;
+        advance();
+        pattern = parseBinary(BoundPrec);
+    } else {
+        pattern = parseBinary(BoundPrec);
+        if (match(TOK_DOTDOT)) {
+            kind = CaseKind::Range;
+            high = parseBinary(BoundPrec);
+        }
+    }
+    expect(TOK_COLON, ":");
+
+    auto body = parseStatements();
+    return make<CaseAST>(kind, pattern, high, body);
 }
 
 // --- Simple Statements ---
@@ -153,27 +216,42 @@ StmtAST* Parser::parseMatch() {
 StmtAST* Parser::parsePrint() {
     advance(); // consume Print
     ExprAST* expr = parseExpression();
-    return new PrintStmtAST(expr);
+    return make<PrintStmtAST>(expr);
 }
 
 StmtAST* Parser::parseReturn() {
     advance(); // consume Return
     ExprAST* expr = parseExpression();
-    return new ReturnStmtAST(expr);
+    return make<ReturnStmtAST>(expr);
 }
 
+// An expression, or `name = expr` assigning an existing variable
 StmtAST* Parser::parseExprStmt() {
     ExprAST* expr = parseExpression();
-    return new ExprStmtAST(expr);
+    if (match(TOK_ASSIGN)) {
+        auto *target = dynamic_cast<VarExprAST*>(expr);
+        if (!target)
+            throw std::runtime_error("Parse error: only a variable can be assigned");
+        ExprAST* value = parseExpression();
+        return make<AssignStmtAST>(target->name, value);
+    }
+    return make<ExprStmtAST>(expr);
 }
 
 // --- Block Helper ---
 
-std::vector<StmtAST*> Parser::parseBlock() {
+// Statements up to (not including) End, Else, Case or end of input
+ArenaList<StmtAST*> Parser::parseStatements() {
     std::vector<StmtAST*> stmts;
     while (current.type != TOK_END && current.type != TOK_ELSE && current.type != TOK_CASE && current.type != TOK_EOF) {
         stmts.push_back(parseStatement());
     }
+    return list(stmts);
+}
+
+// A block also consumes the End that closes it
+ArenaList<StmtAST*> Parser::parseBlock() {
+    auto stmts = parseStatements();
     if (current.type == TOK_END) {
         advance();
     }
@@ -182,62 +260,53 @@ std::vector<StmtAST*> Parser::parseBlock() {
 
 // --- Expressions ---
 
-ExprAST* Parser::parseExpression() {
-    return parseEquality();
-}
+// Pratt table: binding power and AST operator for each infix OpToken.
+// Higher binds tighter; 0 means "not an infix operator". All binary
+// operators are left-associative.
+namespace {
+struct InfixOp {
+    unsigned char prec;
+    BinaryOp op;
+};
+
+const InfixOp InfixTable[size_t(OpToken::Count)] = {
+    /* Plus      */ {3, BinaryOp::Add},
+    /* Minus     */ {3, BinaryOp::Sub},
+    /* Star      */ {4, BinaryOp::Mul},
+    /* Slash     */ {4, BinaryOp::Div},
+    /* Less      */ {2, BinaryOp::Lt},
+    /* LessEq    */ {2, BinaryOp::Le},
+    /* Greater   */ {2, BinaryOp::Gt},
+    /* GreaterEq */ {2, BinaryOp::Ge},
+    /* EqEq      */ {1, BinaryOp::Eq},
+    /* NotEq     */ {1, BinaryOp::Ne},
+    /* Bang      */ {0, BinaryOp::Eq},
+};
+} // namespace
 
-ExprAST* Parser::parseEquality() {
-    ExprAST* left = parseComparison();
-    while (current.type == TOK_OP && (current.text == "==" || current.text == "!=")) {
-        std::string op = current.text;
-        advance();
-        ExprAST* right = parseComparison();
-        left = new BinaryExprAST(op, left, right);
-    }
-    return left;
-}
-
-ExprAST* Parser::parseComparison() {
-    ExprAST* left = parseTerm();
-    while (current.type == TOK_OP &&
-           (current.text == "<" || current.text == "<=" ||
-            current.text == ">" || current.text == ">=")) {
-        std::string op = current.text;
-        advance();
-        ExprAST* right = parseTerm();
-        left = new BinaryExprAST(op, left, right);
-    }
-    return left;
-}
-
-ExprAST* Parser::parseTerm() {
-    ExprAST* left = parseFactor();
-    while (current.type == TOK_OP && (current.text == "+" || current.text == "-")) {
-        std::string op = current.text;
-        advance();
-        ExprAST* right = parseFactor();
-        left = new BinaryExprAST(op, left, right);
-    }
-    return left;
+ExprAST* Parser::parseExpression() {
+    return parseBinary(1);
 }
 
-ExprAST* Parser::parseFactor() {
+ExprAST* Parser::parseBinary(int minPrec) {
     ExprAST* left = parseUnary();
-    while (current.type == TOK_OP && (current.text == "*" || current.text == "/")) {
-        std::string op = current.text;
+    while (current.type == TOK_OP) {
+        const InfixOp &infix = InfixTable[size_t(current.op)];
+        if (infix.prec < minPrec || infix.prec == 0) break;
         advance();
-        ExprAST* right = parseUnary();
-        left = new BinaryExprAST(op, left, right);
+        ExprAST* right = parseBinary(infix.prec + 1);
+        left = make<BinaryExprAST>(infix.op, left, right);
     }
     return left;
 }
 
 ExprAST* Parser::parseUnary() {
-    if (current.type == TOK_OP && (current.text == "-" || current.text == "!")) {
-        std::string op = current.text;
+    if (current.type == TOK_OP &&
+        (current.op == OpToken::Minus || current.op == OpToken::Bang)) {
+        UnaryOp op = current.op == OpToken::Minus ? UnaryOp::Neg : UnaryOp::Not;
         advance();
         ExprAST* operand = parseUnary();
-        return new UnaryExprAST(op, operand);
+        return make<UnaryExprAST>(op, operand);
     }
     return parsePrimary();
 }
@@ -246,33 +315,60 @@ ExprAST* Parser::parsePrimary() {
     if (current.type == TOK_NUMBER) {
         int val = current.intVal;
         advance();
-        return new NumberExprAST(val);
+        return make<NumberExprAST>(val);
     }
     if (current.type == TOK_STRING) {
-        std::string str = current.text;
+        std::string_view str = program->arena.copyString(current.text);
         advance();
-        return new StringExprAST(str);
+        return make<StringExprAST>(str);
     }
     if (current.type == TOK_IDENTIFIER) {
-        std::string name = current.text;
+        Symbol name = intern(current.text);
         advance();
-        // Function call?
-        if (match(TOK_LPAREN)) {
-            std::vector<ExprAST*> args;
-            if (current.type != TOK_RPAREN) {
-                do {
-                    args.push_back(parseExpression());
-                } while (match(TOK_COMMA));
-            }
-            expect(TOK_RPAREN, ")");
-            return new CallExprAST(name, args);
-        }
-        return new VarExprAST(name);
+        return parseNamed(name);
     }
     if (match(TOK_LPAREN)) {
         ExprAST* expr = parseExpression();
         expect(TOK_RPAREN, ")");
         return expr;
     }
-    throw std::runtime_error("Unexpected token in expression: " + current.text);
+    if (match(TOK_FUTURE)) {
+        // `Future Call Work(x)`; the `Call` may be left out, and is only
+        // the keyword when a name follows, so `Future Call(x)` calls a
+        // Func named Call
+        ExprAST* expr;
+        if (current.type == TOK_IDENTIFIER && current.text == "Call") {
+            Symbol name = intern(current.text);
+            advance();
+            expr = current.type == TOK_IDENTIFIER ? parsePrimary() : parseNamed(name);
+        } else {
+            expr = parsePrimary();
+        }
+        auto *call = dynamic_cast<CallExprAST*>(expr);
+        if (!call) throw std::runtime_error("Future expects a function call");
+        return make<FutureExprAST>(call);
+    }
+    if (match(TOK_SYNC)) {
+        return make<SyncExprAST>(parseUnary());
+    }
+    if (match(TOK_INPUT)) {
+        return make<InputExprAST>();
+    }
+    throw std::runtime_error("Unexpected token in expression: " + std::string(current.text));
+}
+
+// What follows an identifier: a call's argument list, or nothing for a
+// variable
+ExprAST* Parser::parseNamed(Symbol name) {
+    if (match(TOK_LPAREN)) {
+        std::vector<ExprAST*> args;
+        if (current.type != TOK_RPAREN) {
+            do {
+                args.push_back(parseExpression());
+            } while (match(TOK_COMMA));
+        }
+        expect(TOK_RPAREN, ")");
+        return make<CallExprAST>(name, list(args));
+    }
+    return make<VarExprAST>(name);
 }
@@ -0,0 +1,199 @@
+#include "pgo.hpp"
+#include <llvm/Analysis/CFG.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IR/Module.h>
+#include <llvm/ProfileData/InstrProf.h>
+#include <llvm/ProfileData/ProfileCommon.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+
+using namespace llvm;
+
+// The profile is text, one function per line, written by the runtime
+// (see "=== PGO ===" in runtime.c):
+//
+//   # strict-pgo 1
+//   <name> <hash, hex> <n> <entry> <edge counts...>
+static const char ProfileHeader[] = "# strict-pgo 1";
+
+static uint64_t fnv(uint64_t h, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (v >> (8 * i)) & 0xff;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// Terminators with a choice to make, in block order: what gets a counter
+// per successor, and what gets branch_weights back
+static std::vector<Instruction*> branchPoints(Function &F) {
+    std::vector<Instruction*> points;
+    for (BasicBlock &BB : F) {
+        Instruction *T = BB.getTerminator();
+        auto *br = dyn_cast<BranchInst>(T);
+        if ((br && br->isConditional()) || isa<SwitchInst>(T)) points.push_back(T);
+    }
+    return points;
+}
+
+// Checked on --pgo-use so an edited function never gets another one's counts
+static uint64_t shapeHash(const Function &F, const std::vector<Instruction*> &points) {
+    uint64_t h = fnv(14695981039346656037ull, F.size());
+    for (const Instruction *T : points) {
+        h = fnv(h, T->getOpcode());
+        h = fnv(h, T->getNumSuccessors());
+    }
+    return h;
+}
+
+static unsigned counterCount(const std::vector<Instruction*> &points) {
+    unsigned n = 1;
+    for (const Instruction *T : points) n += T->getNumSuccessors();
+    return n;
+}
+
+static void bump(IRBuilder<> &builder, Value *counters, unsigned slot) {
+    Type *i64 = builder.getInt64Ty();
+    Value *at = builder.CreateConstInBoundsGEP1_32(i64, counters, slot, "pgo.slot");
+    builder.CreateStore(builder.CreateAdd(builder.CreateLoad(i64, at), builder.getInt64(1)), at);
+}
+
+void instrumentPGO(Module &M) {
+    LLVMContext &ctx = M.getContext();
+    Type *i64 = Type::getInt64Ty(ctx);
+    PointerType *counterPtr = i64->getPointerTo();
+    FunctionCallee registerFn = M.getOrInsertFunction("__pgo_register", counterPtr,
+                                                      Type::getInt8PtrTy(ctx), i64,
+                                                      Type::getInt32Ty(ctx));
+    MDBuilder md(ctx);
+    IRBuilder<> builder(ctx);
+    std::vector<Function*> defined;
+    for (Function &F : M)
+        if (!F.isDeclaration()) defined.push_back(&F);
+
+    for (Function *F : defined) {
+        std::vector<Instruction*> points = branchPoints(*F);
+        uint64_t hash = shapeHash(*F, points);
+        unsigned count = counterCount(points);
+
+        // Where each edge is counted: the successor itself when this is
+        // its only way in, otherwise a block split onto the edge
+        std::vector<std::pair<BasicBlock*, unsigned>> sites;
+        unsigned slot = 1;
+        for (Instruction *T : points) {
+            for (unsigned s = 0; s < T->getNumSuccessors(); s++, slot++) {
+                BasicBlock *site = isCriticalEdge(T, s) ? SplitCriticalEdge(T, s) : T->getSuccessor(s);
+                if (site) sites.push_back({site, slot});
+            }
+        }
+
+        // Counters are owned by the runtime and looked up by name on the
+        // first call; the module keeps the pointer in a private global
+        BasicBlock &entry = F->getEntryBlock();
+        BasicBlock::iterator at = entry.begin();
+        while (isa<AllocaInst>(*at)) ++at;
+        BasicBlock *body = entry.splitBasicBlock(at, "pgo.body");
+        BasicBlock *reg = BasicBlock::Create(ctx, "pgo.register", F, body);
+        auto *cache = new GlobalVariable(M, counterPtr, false, GlobalValue::InternalLinkage,
+                                         ConstantPointerNull::get(counterPtr), "pgo." + F->getName());
+
+        entry.getTerminator()->eraseFromParent();
+        builder.SetInsertPoint(&entry);
+        Value *cached = builder.CreateLoad(counterPtr, cache, "pgo.cached");
+        builder.CreateCondBr(builder.CreateIsNull(cached), reg, body, md.createBranchWeights(1, 1u << 20));
+
+        builder.SetInsertPoint(reg);
+        Value *fresh = builder.CreateCall(registerFn, {builder.CreateGlobalStringPtr(F->getName(), "pgo.name"),
+                                                       builder.getInt64(hash), builder.getInt32(count)});
+        builder.CreateStore(fresh, cache);
+        builder.CreateBr(body);
+
+        builder.SetInsertPoint(body, body->begin());
+        PHINode *counters = builder.CreatePHI(counterPtr, 2, "pgo.counters");
+        counters->addIncoming(cached, &entry);
+        counters->addIncoming(fresh, reg);
+        bump(builder, counters, 0);
+
+        for (auto &[site, slot] : sites) {
+            builder.SetInsertPoint(site, site->getFirstInsertionPt());
+            bump(builder, counters, slot);
+        }
+    }
+}
+
+void annotatePGO(Module &M, const PGOProfile &profile, std::vector<std::string> &stale) {
+    LLVMContext &ctx = M.getContext();
+    MDBuilder md(ctx);
+    for (Function &F : M) {
+        if (F.isDeclaration()) continue;
+        auto it = profile.functions.find(F.getName().str());
+        if (it == profile.functions.end()) continue;
+        const PGOProfile::Counts &record = it->second;
+        std::vector<Instruction*> points = branchPoints(F);
+        if (record.hash != shapeHash(F, points) || record.counts.size() != counterCount(points)) {
+            stale.push_back(F.getName().str());
+            continue;
+        }
+
+        F.setEntryCount(Function::ProfileCount(record.counts[0], Function::PCT_Real));
+        size_t slot = 1;
+        for (Instruction *T : points) {
+            unsigned n = T->getNumSuccessors();
+            uint64_t max = 0;
+            for (unsigned s = 0; s < n; s++) max = std::max(max, record.counts[slot + s]);
+            // Branch weights are 32-bit; never-taken edges keep their zero
+            if (max) {
+                uint64_t scale = max / UINT32_MAX + 1;
+                std::vector<uint32_t> weights;
+                for (unsigned s = 0; s < n; s++) weights.push_back(uint32_t(record.counts[slot + s] / scale));
+                T->setMetadata(LLVMContext::MD_prof, md.createBranchWeights(weights));
+            }
+            slot += n;
+        }
+    }
+
+    // From the whole profile rather than this module's functions, so every
+    // --cache unit agrees on what is hot
+    InstrProfSummaryBuilder summary(ProfileSummaryBuilder::DefaultCutoffs);
+    for (const auto &entry : profile.functions) summary.addRecord(InstrProfRecord(entry.second.counts));
+    M.setProfileSummary(summary.getSummary()->getMD(ctx), ProfileSummary::PSK_Instr);
+}
+
+bool readPGOProfile(const std::string &path, PGOProfile &profile, std::string &err) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        err = "cannot open profile " + path;
+        return false;
+    }
+    std::string line;
+    if (!std::getline(in, line) || line != ProfileHeader) {
+        err = path + " is not a Strict profile (run a --pgo-gen build first)";
+        return false;
+    }
+    uint64_t digest = 14695981039346656037ull;
+    unsigned lineNo = 1;
+    while (std::getline(in, line)) {
+        lineNo++;
+        for (unsigned char c : line) digest = fnv(digest, c);
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        std::string name;
+        PGOProfile::Counts record;
+        size_t n = 0;
+        fields >> name >> std::hex >> record.hash >> std::dec >> n;
+        record.counts.resize(n);
+        for (uint64_t &c : record.counts) fields >> c;
+        if (!fields || n == 0) {
+            err = path + ":" + std::to_string(lineNo) + ": malformed profile record";
+            return false;
+        }
+        // Records of a function's older shape come first; the last one wins
+        profile.functions[name] = std::move(record);
+    }
+    profile.digest = digest;
+    return true;
+}
@@ -0,0 +1,357 @@
+#include "regalloc.hpp"
+#include <algorithm>
+#include <bitset>
+
+// === Registers & ABIs ===
+
+const char *x86RegName(X86Reg r, unsigned bits) {
+    static const char *const Names[4][16] = {
+        {"al", "cl", "dl", "bl", "spl", "bpl", "sil", "dil",
+         "r8b", "r9b", "r10b", "r11b", "r12b", "r13b", "r14b", "r15b"},
+        {"ax", "cx", "dx", "bx", "sp", "bp", "si", "di",
+         "r8w", "r9w", "r10w", "r11w", "r12w", "r13w", "r14w", "r15w"},
+        {"eax", "ecx", "edx", "ebx", "esp", "ebp", "esi", "edi",
+         "r8d", "r9d", "r10d", "r11d", "r12d", "r13d", "r14d", "r15d"},
+        {"rax", "rcx", "rdx", "rbx", "rsp", "rbp", "rsi", "rdi",
+         "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"}
+    };
+    unsigned row = bits <= 8 ? 0 : bits <= 16 ? 1 : bits <= 32 ? 2 : 3;
+    return Names[row][r];
+}
+
+const X86ABI Win64ABI = {
+    {RCX, RDX, R8, R9}, 4, 32,
+    regBit(RBX) | regBit(RSI) | regBit(RDI) | regBit(R12) | regBit(R13) | regBit(R14) | regBit(R15),
+    {R8, R9, RCX, RDX, RBX, RSI, RDI, R12, R13, R14, R15}, 11
+};
+
+const X86ABI SysVABI = {
+    {RDI, RSI, RDX, RCX, R8, R9}, 6, 0,
+    regBit(RBX) | regBit(R12) | regBit(R13) | regBit(R14) | regBit(R15),
+    {RSI, RDI, R8, R9, RCX, RDX, RBX, R12, R13, R14, R15}, 11
+};
+
+// === Decoding ===
+
+void DGMFunctionBody::load(const DGMReader &dgm, uint32_t index) {
+    entry = dgm.function(index);
+    std::string_view sig = dgm.string(entry.signature);
+    returnType = sig.empty() ? DGMType::Void : static_cast<DGMType>(sig[0]);
+
+    insts.clear();
+    blockStart.clear();
+    valueTypes.assign(entry.argCount, DGMType::I32);
+    for (uint32_t i = 0; i < entry.argCount && i + 1 < sig.size(); i++)
+        valueTypes[i] = static_cast<DGMType>(sig[i + 1]);
+
+    DGMInst inst;
+    for (uint32_t b = 0; b < entry.blockCount; b++) {
+        blockStart.push_back(uint32_t(insts.size()));
+        DGMReader::Cursor code = dgm.code(entry, dgm.block(entry, b));
+        while (code.next(inst)) {
+            if (inst.defines) valueTypes.push_back(inst.type);
+            insts.push_back(inst);
+        }
+    }
+    blockStart.push_back(uint32_t(insts.size()));
+}
+
+// === Liveness ===
+namespace {
+
+using BitSet = std::vector<uint64_t>;
+
+inline unsigned ctz(uint64_t x) {
+    unsigned n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
+}
+
+inline bool test(const BitSet &s, uint32_t v) { return s[v >> 6] >> (v & 63) & 1; }
+inline void set(BitSet &s, uint32_t v) { s[v >> 6] |= uint64_t(1) << (v & 63); }
+
+// Instruction k uses its operands at 2k+2 and defines its result at 2k+3, so
+// an operand dying at k and the result of k may share a register.
+inline uint32_t usePos(uint32_t k) { return 2 * k + 2; }
+inline uint32_t defPos(uint32_t k) { return 2 * k + 3; }
+
+struct Interval {
+    uint32_t value;
+    uint32_t start = UINT32_MAX;
+    uint32_t end = 0;
+    uint32_t forbidden = 0;
+    X86Reg hint = NoReg;
+    X86Reg reg = NoReg;
+    int slot = -1;
+};
+
+struct Clobber {
+    uint32_t inst;
+    uint32_t regs;
+};
+
+bool isTerminator(DGMOp op) {
+    return op == DGMOp::Br || op == DGMOp::Switch || op == DGMOp::IndirectBr ||
+           op == DGMOp::Ret || op == DGMOp::Unreachable || op == DGMOp::Invoke;
+}
+
+} // namespace
+
+RegAllocation allocateRegisters(const DGMFunctionBody &fn, const X86ABI &abi) {
+    const uint32_t numValues = uint32_t(fn.valueTypes.size());
+    const uint32_t numBlocks = fn.blockCount();
+    const uint32_t numInsts = uint32_t(fn.insts.size());
+    const size_t words = (numValues + 63) / 64;
+
+    RegAllocation ra;
+    ra.values.resize(numValues);
+    ra.fusedCompare.assign(numInsts, false);
+
+    // Value numbering, def sites, use counts and per-block def/use sets
+    std::vector<uint32_t> def(numValues, 0);        // args are defined at position 0
+    std::vector<uint32_t> uses(numValues, 0);
+    std::vector<int32_t> allocaSize(numValues, -1);
+    std::vector<uint32_t> valueOfInst(numInsts, UINT32_MAX);
+    std::vector<BitSet> defs(numBlocks, BitSet(words)), upward(numBlocks, BitSet(words));
+    std::vector<BitSet> phiUses(numBlocks, BitSet(words));
+    std::vector<std::vector<uint32_t>> succs(numBlocks);
+    std::vector<uint32_t> blockOf(numInsts);
+
+    uint32_t v = fn.entry.argCount;
+    for (uint32_t b = 0; b < numBlocks; b++) {
+        for (uint32_t k = fn.blockStart[b]; k < fn.blockStart[b + 1]; k++) {
+            const DGMInst &inst = fn.insts[k];
+            DGMOp op = static_cast<DGMOp>(inst.op);
+            blockOf[k] = b;
+
+            if (op == DGMOp::Phi) {
+                for (size_t i = 0; i + 1 < inst.operands.size(); i += 2) {
+                    const DGMOperand &in = inst.operands[i];
+                    if (in.kind != DGMOperandKind::Value) continue;
+                    set(phiUses[inst.operands[i + 1].value], uint32_t(in.value));
+                    uses[in.value]++;
+                }
+            } else {
+                for (const DGMOperand &o : inst.operands) {
+                    if (o.kind != DGMOperandKind::Value) continue;
+                    uses[o.value]++;
+                    if (!test(defs[b], uint32_t(o.value))) set(upward[b], uint32_t(o.value));
+                }
+            }
+            if (isTerminator(op)) {
+                for (const DGMOperand &o : inst.operands)
+                    if (o.kind == DGMOperandKind::Block) succs[b].push_back(uint32_t(o.value));
+            }
+
+            if (!inst.defines) continue;
+            valueOfInst[k] = v;
+            def[v] = op == DGMOp::Phi ? usePos(fn.blockStart[b]) : defPos(k);
+            set(defs[b], v);
+            if (op == DGMOp::Alloca && inst.operands.size() == 2 &&
+                inst.operands[0].kind == DGMOperandKind::Imm &&
+                inst.operands[1].kind == DGMOperandKind::Imm)
+                allocaSize[v] = int32_t(inst.operands[0].value * inst.operands[1].value);
+            v++;
+        }
+    }
+
+    // A compare used only by the branch right after it becomes cmp + jcc
+    for (uint32_t k = 0; k + 1 < numInsts; k++) {
+        uint32_t cmp = valueOfInst[k];
+        const DGMInst &next = fn.insts[k + 1];
+        if (cmp != UINT32_MAX && static_cast<DGMOp>(fn.insts[k].op) == DGMOp::ICmp &&
+            uses[cmp] == 1 && blockOf[k] == blockOf[k + 1] &&
+            static_cast<DGMOp>(next.op) == DGMOp::Br && next.operands.size() == 3 &&
+            next.operands[0].kind == DGMOperandKind::Value && next.operands[0].value == cmp)
+            ra.fusedCompare[k] = true;
+    }
+
+    // Backward dataflow to a fixed point:
+    //   out(B) = phiUses(B) ∪ ⋃ in(S)      in(B) = upward(B) ∪ (out(B) − defs(B))
+    std::vector<BitSet> liveIn(numBlocks, BitSet(words)), liveOut(numBlocks, BitSet(words));
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (uint32_t b = numBlocks; b-- > 0;) {
+            BitSet out = phiUses[b];
+            for (uint32_t s : succs[b])
+                for (size_t w = 0; w < words; w++) out[w] |= liveIn[s][w];
+            BitSet in(words);
+            for (size_t w = 0; w < words; w++)
+                in[w] = upward[b][w] | (out[w] & ~defs[b][w]);
+            if (in != liveIn[b] || out != liveOut[b]) {
+                liveIn[b] = std::move(in);
+                liveOut[b] = std::move(out);
+                changed = true;
+            }
+        }
+    }
+
+    // Intervals
+    std::vector<Interval> intervals(numValues);
+    for (uint32_t i = 0; i < numValues; i++) {
+        intervals[i].value = i;
+        if (i < fn.entry.argCount) {
+            intervals[i].start = 0;
+            if (i < abi.argRegCount) intervals[i].hint = abi.argRegs[i];
+        } else {
+            intervals[i].start = def[i];
+        }
+    }
+    for (uint32_t k = 0; k < numInsts; k++) {
+        const DGMInst &inst = fn.insts[k];
+        bool phi = static_cast<DGMOp>(inst.op) == DGMOp::Phi;
+        for (size_t i = 0; i < inst.operands.size(); i++) {
+            const DGMOperand &o = inst.operands[i];
+            if (o.kind != DGMOperandKind::Value) continue;
+            uint32_t pos = usePos(k);
+            if (phi) {
+                uint32_t pred = uint32_t(inst.operands[i + 1].value);
+                pos = defPos(fn.blockStart[pred + 1] - 1);
+            }
+            intervals[o.value].end = std::max(intervals[o.value].end, pos);
+        }
+    }
+    for (uint32_t b = 0; b < numBlocks; b++) {
+        uint32_t first = usePos(fn.blockStart[b]), last = defPos(fn.blockStart[b + 1] - 1);
+        for (size_t w = 0; w < words; w++) {
+            for (uint64_t bits = liveIn[b][w]; bits; bits &= bits - 1) {
+                Interval &it = intervals[w * 64 + ctz(bits)];
+                it.start = std::min(it.start, first);
+            }
+            for (uint64_t bits = liveOut[b][w]; bits; bits &= bits - 1) {
+                Interval &it = intervals[w * 64 + ctz(bits)];
+                it.end = std::max(it.end, last);
+            }
+        }
+    }
+
+    // Registers an instruction destroys, and the intervals live across it
+    std::vector<Clobber> clobbers;
+    uint32_t callerSaved = 0;
+    for (unsigned i = 0; i < abi.allocCount; i++) callerSaved |= regBit(abi.allocOrder[i]);
+    callerSaved &= ~abi.calleeSaved;
+    for (uint32_t k = 0; k < numInsts; k++) {
+        const DGMInst &inst = fn.insts[k];
+        switch (static_cast<DGMOp>(inst.op)) {
+            case DGMOp::Call: clobbers.push_back({k, callerSaved}); break;
+            case DGMOp::SDiv: case DGMOp::UDiv: case DGMOp::SRem: case DGMOp::URem:
+                clobbers.push_back({k, regBit(RDX)});
+                break;
+            case DGMOp::Shl: case DGMOp::LShr: case DGMOp::AShr:
+                if (inst.operands.size() == 2 && inst.operands[1].kind != DGMOperandKind::Imm)
+                    clobbers.push_back({k, regBit(RCX)});
+                break;
+            default: break;
+        }
+    }
+
+    for (uint32_t k = 0; k < numInsts; k++) {
+        if (ra.fusedCompare[k]) intervals[valueOfInst[k]].end = 0;
+    }
+
+    std::vector<Interval*> order;
+    for (uint32_t i = 0; i < numValues; i++) {
+        Interval &it = intervals[i];
+        if (allocaSize[i] >= 0 || it.end == 0) continue; // frame address, or never used
+        for (const Clobber &c : clobbers) {
+            if (it.start <= usePos(c.inst) && it.end >= defPos(c.inst))
+                it.forbidden |= c.regs;
+        }
+        order.push_back(&it);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const Interval *a, const Interval *b) { return a->start < b->start; });
+
+    // Linear scan
+    std::vector<Interval*> active;
+    std::vector<uint32_t> slotFreeAt;   // end of the last interval using each slot
+    uint32_t inUse = 0;
+
+    auto spill = [&](Interval *it) {
+        it->reg = NoReg;
+        for (size_t s = 0; s < slotFreeAt.size(); s++) {
+            if (slotFreeAt[s] < it->start) {
+                it->slot = int(s);
+                slotFreeAt[s] = it->end;
+                return;
+            }
+        }
+        it->slot = int(slotFreeAt.size());
+        slotFreeAt.push_back(it->end);
+    };
+
+    for (Interval *cur : order) {
+        for (size_t i = 0; i < active.size();) {
+            if (active[i]->end < cur->start) {
+                inUse &= ~regBit(active[i]->reg);
+                active[i] = active.back();
+                active.pop_back();
+            } else {
+                i++;
+            }
+        }
+
+        uint32_t allowed = 0;
+        for (unsigned i = 0; i < abi.allocCount; i++) allowed |= regBit(abi.allocOrder[i]);
+        allowed &= ~cur->forbidden;
+        uint32_t free = allowed & ~inUse;
+
+        if (free) {
+            X86Reg pick = NoReg;
+            if (cur->hint != NoReg && (free & regBit(cur->hint))) {
+                pick = cur->hint;
+            } else {
+                for (unsigned i = 0; i < abi.allocCount && pick == NoReg; i++)
+                    if (free & regBit(abi.allocOrder[i])) pick = abi.allocOrder[i];
+            }
+            cur->reg = pick;
+            inUse |= regBit(pick);
+            active.push_back(cur);
+            continue;
+        }
+
+        // No register: spill whichever of cur and the eligible active
+        // intervals lives longest
+        Interval *victim = nullptr;
+        for (Interval *a : active) {
+            if ((allowed & regBit(a->reg)) && (!victim || a->end > victim->end)) victim = a;
+        }
+        if (victim && victim->end > cur->end) {
+            cur->reg = victim->reg;
+            spill(victim);
+            *std::find(active.begin(), active.end(), victim) = cur;
+        } else {
+            spill(cur);
+        }
+    }
+
+    // Frame: callee-saved saves, then allocas, then spill slots, all below rbp
+    for (const Interval *it : order) {
+        if (it->reg != NoReg && (abi.calleeSaved & regBit(it->reg)))
+            ra.calleeSavedUsed |= regBit(it->reg);
+    }
+    uint32_t frame = 8 * uint32_t(std::bitset<32>(ra.calleeSavedUsed).count());
+    for (uint32_t i = 0; i < numValues; i++) {
+        if (allocaSize[i] < 0) continue;
+        uint32_t align = allocaSize[i] >= 16 ? 16 : 8;
+        frame = (frame + uint32_t(allocaSize[i]) + align - 1) / align * align;
+        ra.values[i].kind = ValueLocation::Frame;
+        ra.values[i].offset = -int32_t(frame);
+    }
+    uint32_t spillBase = frame;
+    frame += 8 * uint32_t(slotFreeAt.size());
+    ra.frameBytes = frame;
+
+    for (const Interval *it : order) {
+        ValueLocation &loc = ra.values[it->value];
+        if (it->reg != NoReg) {
+            loc.kind = ValueLocation::Reg;
+            loc.reg = it->reg;
+        } else {
+            loc.kind = ValueLocation::Slot;
+            loc.offset = -int32_t(spillBase + 8 * uint32_t(it->slot + 1));
+            ra.spilled++;
+        }
+    }
+    return ra;
+}
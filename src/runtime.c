@@ -1,50 +1,334 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+// === Threads ===
+// Just enough of pthreads / Win32 for the output buffers and task pool below
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION strict_mutex;
+typedef CONDITION_VARIABLE strict_cond;
+typedef HANDLE strict_thread;
+#define strict_mutex_init(m) InitializeCriticalSection(m)
+#define strict_mutex_destroy(m) DeleteCriticalSection(m)
+#define strict_lock(m) EnterCriticalSection(m)
+#define strict_unlock(m) LeaveCriticalSection(m)
+#define strict_cond_init(c) InitializeConditionVariable(c)
+#define strict_cond_wait(c, m) SleepConditionVariableCS((c), (m), INFINITE)
+#define strict_cond_broadcast(c) WakeAllConditionVariable(c)
+#define strict_yield() SwitchToThread()
+#else
+typedef pthread_mutex_t strict_mutex;
+typedef pthread_cond_t strict_cond;
+typedef pthread_t strict_thread;
+#define strict_mutex_init(m) pthread_mutex_init((m), NULL)
+#define strict_mutex_destroy(m) pthread_mutex_destroy(m)
+#define strict_lock(m) pthread_mutex_lock(m)
+#define strict_unlock(m) pthread_mutex_unlock(m)
+#define strict_cond_init(c) pthread_cond_init((c), NULL)
+#define strict_cond_wait(c, m) pthread_cond_wait((c), (m))
+#define strict_cond_broadcast(c) pthread_cond_broadcast(c)
+#define strict_yield() sched_yield()
+#endif
+
+#ifdef _MSC_VER
+#define STRICT_THREAD_LOCAL __declspec(thread)
+#define strict_fetch_add(p, v) InterlockedExchangeAdd64((volatile LONG64*)(p), (v))
+#define strict_load(p) InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0)
+#define strict_cas(p, expected, desired) \
+    (InterlockedCompareExchange64((volatile LONG64*)(p), (desired), (expected)) == (expected))
+#else
+#define STRICT_THREAD_LOCAL _Thread_local
+#define strict_fetch_add(p, v) __atomic_fetch_add((p), (v), __ATOMIC_ACQ_REL)
+#define strict_load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+static int strict_cas(long long *p, long long expected, long long desired) {
+    return __atomic_compare_exchange_n(p, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+#endif
+
+// SSE2 is baseline on x86-64; AVX2 kernels are compiled per function and
+// picked at run time (see Bulk Operations)
+#if defined(__x86_64__) || defined(_M_X64)
+#define STRICT_X86_SIMD 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define STRICT_AVX2 
+static int lowest_bit(unsigned mask) {
+    unsigned long i;
+    _BitScanForward(&i, mask);
+    return (int)i;
+}
+#else
+#define STRICT_AVX2 __attribute__((target("avx2")))
+static int lowest_bit(unsigned mask) { return __builtin_ctz(mask); }
+#endif
+#endif
 
 // === Core I/O ===
+// Print output collects in a per-thread buffer that is written out, with
+// one fwrite, when full, before Input reads (so prompts show), before
+// parallel work starts (so the caller's earlier lines come first), after
+// each pool task and at exit. Lines from different threads never mix.
+
+enum { OUT_BUFFER = 64 * 1024 };
+
+typedef struct StrictOut StrictOut;
+struct StrictOut {
+    char *data;
+    size_t used;
+    StrictOut *next, *prev;     // every live buffer, for the flush at exit
+};
+
+static STRICT_THREAD_LOCAL StrictOut *Out = NULL;
+static StrictOut *AllOut = NULL;
+static strict_mutex OutLock;
+
+static void out_write(StrictOut *out) {
+    if (!out->used) return;
+    fwrite(out->data, 1, out->used, stdout);
+    fflush(stdout);
+    out->used = 0;
+}
+
+// Flushes what the calling thread has printed
+void strict_flush(void) {
+    if (Out) out_write(Out);
+}
+
+static void out_flush_all(void) {
+    strict_lock(&OutLock);
+    for (StrictOut *out = AllOut; out; out = out->next) out_write(out);
+    strict_unlock(&OutLock);
+}
+
+static void out_init(void) {
+    strict_mutex_init(&OutLock);
+    atexit(out_flush_all);
+}
+
+#ifdef _WIN32
+static INIT_ONCE OutOnce = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK out_init_once(PINIT_ONCE once, PVOID arg, PVOID *ctx) {
+    out_init();
+    return TRUE;
+}
+#define strict_out_once() InitOnceExecuteOnce(&OutOnce, out_init_once, NULL, NULL)
+#else
+static pthread_once_t OutOnce = PTHREAD_ONCE_INIT;
+#define strict_out_once() pthread_once(&OutOnce, out_init)
+#endif
+
+static StrictOut *out_buffer(void) {
+    if (Out) return Out;
+    strict_out_once();
+    StrictOut *out = (StrictOut*)malloc(sizeof(StrictOut));
+    out->data = (char*)malloc(OUT_BUFFER);
+    out->used = 0;
+    out->prev = NULL;
+    strict_lock(&OutLock);
+    out->next = AllOut;
+    if (AllOut) AllOut->prev = out;
+    AllOut = out;
+    strict_unlock(&OutLock);
+    return Out = out;
+}
+
+// Flushes and frees the calling thread's buffer; for threads that exit
+static void out_release(void) {
+    StrictOut *out = Out;
+    if (!out) return;
+    strict_lock(&OutLock);
+    out_write(out);
+    if (out->prev) out->prev->next = out->next;
+    else AllOut = out->next;
+    if (out->next) out->next->prev = out->prev;
+    strict_unlock(&OutLock);
+    free(out->data);
+    free(out);
+    Out = NULL;
+}
+
+// Room for `size` more bytes; a longer line than the buffer is written
+// straight through
+static char *out_reserve(StrictOut *out, size_t size) {
+    if (out->used + size > OUT_BUFFER) out_write(out);
+    return size <= OUT_BUFFER ? out->data + out->used : NULL;
+}
+
+// Print of a string of known length (literals: no strlen)
+void strict_print_str(const char *s, int len) {
+    StrictOut *out = out_buffer();
+    size_t size = (size_t)len;
+    char *p = out_reserve(out, size + 1);
+    if (!p) {
+        fwrite(s, 1, size, stdout);
+        fputc('\n', stdout);
+        fflush(stdout);
+        return;
+    }
+    memcpy(p, s, size);
+    p[size] = '\n';
+    out->used += size + 1;
+}
 
 // Print string (null-terminated)
 void strict_print(const char *s) {
-    puts(s);
+    strict_print_str(s, (int)strlen(s));
 }
 
-// Input integer
-int strict_input() {
-    int v;
-    if (scanf("%d", &v) != 1) return 0;
-    return v;
+static const char DigitPairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+// Decimal digits of `v` ending just before `end`, two at a time; returns
+// where they start
+static char *format_u32(unsigned v, char *end) {
+    while (v >= 100) {
+        unsigned pair = (v % 100) * 2;
+        v /= 100;
+        *--end = DigitPairs[pair + 1];
+        *--end = DigitPairs[pair];
+    }
+    if (v >= 10) {
+        *--end = DigitPairs[v * 2 + 1];
+        *--end = DigitPairs[v * 2];
+    } else {
+        *--end = (char)('0' + v);
+    }
+    return end;
+}
+
+void strict_print_i32(int value) {
+    char digits[12];
+    char *end = digits + sizeof(digits);
+    unsigned magnitude = value < 0 ? 0u - (unsigned)value : (unsigned)value;
+    char *start = format_u32(magnitude, end);
+    if (value < 0) *--start = '-';
+    size_t size = (size_t)(end - start);
+    StrictOut *out = out_buffer();
+    char *p = out_reserve(out, size + 1);
+    memcpy(p, start, size);
+    p[size] = '\n';
+    out->used += size + 1;
 }
 
 // === Dynamic List Implementation ===
+// The header carries a small inline buffer, so a list of up to
+// LIST_INLINE elements is a single allocation; longer lists move to the
+// heap and grow by doubling, then by half again past LIST_DOUBLING_LIMIT
+// elements, where doubling would leave too much slack. Storage goes
+// through STRICT_MALLOC/STRICT_REALLOC/STRICT_FREE, which list_bench
+// replaces to count allocations.
 
+#ifndef STRICT_MALLOC
+#define STRICT_MALLOC malloc
+#define STRICT_REALLOC realloc
+#define STRICT_FREE free
+#else
+void *STRICT_MALLOC(size_t size);
+void *STRICT_REALLOC(void *p, size_t size);
+void STRICT_FREE(void *p);
+#endif
+
+enum { LIST_INLINE = 6, LIST_DOUBLING_LIMIT = 4096 };
+
+// Starts with the same {data, count} as StrictArray (see StrictSeq)
 typedef struct {
-    int *data;
+    int *data;              // inlineData until the list outgrows it
     size_t size;
     size_t capacity;
+    int inlineData[LIST_INLINE];
 } StrictList;
 
 StrictList* __list_new() {
-    StrictList *list = (StrictList*)malloc(sizeof(StrictList));
+    StrictList *list = (StrictList*)STRICT_MALLOC(sizeof(StrictList));
+    list->data = list->inlineData;
     list->size = 0;
-    list->capacity = 4;
-    list->data = (int*)malloc(list->capacity * sizeof(int));
+    list->capacity = LIST_INLINE;
     return list;
 }
 
-void __list_append(StrictList *list, int value) {
-    if (list->size >= list->capacity) {
-        list->capacity *= 2;
-        list->data = (int*)realloc(list->data, list->capacity * sizeof(int));
+void __list_free(StrictList *list) {
+    if (list->data != list->inlineData) STRICT_FREE(list->data);
+    STRICT_FREE(list);
+}
+
+static void list_grow(StrictList *list, size_t needed) {
+    size_t capacity = list->capacity;
+    while (capacity < needed)
+        capacity += capacity < LIST_DOUBLING_LIMIT ? capacity : capacity / 2;
+    if (list->data == list->inlineData) {
+        list->data = (int*)STRICT_MALLOC(capacity * sizeof(int));
+        memcpy(list->data, list->inlineData, list->size * sizeof(int));
+    } else {
+        list->data = (int*)STRICT_REALLOC(list->data, capacity * sizeof(int));
     }
+    list->capacity = capacity;
+}
+
+// Makes room for `count` more elements without further allocations
+void __list_reserve(StrictList *list, size_t count) {
+    if (count > (size_t)0x7fffffff - list->size) return;    // indices are ints
+    if (list->size + count > list->capacity) list_grow(list, list->size + count);
+}
+
+void __list_append(StrictList *list, int value) {
+    if (list->size == list->capacity) list_grow(list, list->size + 1);
     list->data[list->size++] = value;
 }
 
+void __list_append_bulk(StrictList *list, const int *values, size_t count) {
+    if (list->size + count > list->capacity) list_grow(list, list->size + count);
+    memcpy(list->data + list->size, values, count * sizeof(int));
+    list->size += count;
+}
+
+void __list_extend(StrictList *list, const StrictList *other) {
+    // Appending a list to itself reads the elements before they move
+    size_t count = other->size;
+    if (list->size + count > list->capacity) list_grow(list, list->size + count);
+    memmove(list->data + list->size, other->data, count * sizeof(int));
+    list->size += count;
+}
+
+// Removes the element at `idx`, keeping the order; returns it (0 when out
+// of range)
+int __list_remove_at(StrictList *list, size_t idx) {
+    if (idx >= list->size) return 0;
+    int value = list->data[idx];
+    memmove(&list->data[idx], &list->data[idx + 1], (list->size - idx - 1) * sizeof(int));
+    list->size--;
+    return value;
+}
+
+// Removes the element at `idx` in O(1) by moving the last one into its
+// place; returns it (0 when out of range)
+int __list_swap_remove(StrictList *list, size_t idx) {
+    if (idx >= list->size) return 0;
+    int value = list->data[idx];
+    list->data[idx] = list->data[--list->size];
+    return value;
+}
+
+// Removes the first element equal to `value`, keeping the order
 void __list_remove(StrictList *list, int value) {
     for (size_t i = 0; i < list->size; i++) {
         if (list->data[i] == value) {
-            memmove(&list->data[i], &list->data[i+1], (list->size - i - 1) * sizeof(int));
-            list->size--;
+            __list_remove_at(list, i);
             return;
         }
     }
@@ -55,12 +339,17 @@ int __list_get(StrictList *list, size_t idx) {
     return list->data[idx];
 }
 
+void __list_set(StrictList *list, size_t idx, int value) {
+    if (idx < list->size) list->data[idx] = value;
+}
+
 size_t __list_size(StrictList *list) {
     return list->size;
 }
 
 // === Array Implementation ===
 
+// Starts with the same {data, count} as StrictList (see StrictSeq)
 typedef struct {
     int *data;
     size_t length;
@@ -68,11 +357,15 @@ typedef struct {
 
 StrictArray* __array_new(size_t length) {
     StrictArray *arr = (StrictArray*)malloc(sizeof(StrictArray));
-    arr->length = length;
     arr->data = (int*)calloc(length, sizeof(int));
+    arr->length = arr->data ? length : 0;   // e.g. Array(-1)
     return arr;
 }
 
+size_t __array_length(StrictArray *arr) {
+    return arr->length;
+}
+
 void __array_store(StrictArray *arr, size_t idx, int value) {
     if (idx < arr->length) {
         arr->data[idx] = value;
@@ -86,6 +379,173 @@ int __array_load(StrictArray *arr, size_t idx) {
     return 0;
 }
 
+// === Input ===
+// Input and InputAll read whitespace-separated integers from stdin. A
+// regular file is mapped whole; a pipe or terminal is read IN_BUFFER bytes
+// at a time, keeping a token cut off at the end. Digit runs are found sixteen bytes
+// at a time with SSE2 and converted eight digits at a time (SWAR). Out of
+// range values wrap; a word that is not a number reads as 0 and is
+// skipped, and so does end of input.
+
+enum { IN_BUFFER = 1 << 20 };
+
+static struct {
+    const unsigned char *cur, *end;
+    unsigned char *buffer;      // NULL while stdin is mapped
+    int started, done;          // done: nothing left to read in
+} In;
+static strict_mutex InLock;
+
+static void in_init(void) {
+    strict_mutex_init(&InLock);
+}
+
+#ifdef _WIN32
+static INIT_ONCE InOnce = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK in_init_once(PINIT_ONCE once, PVOID arg, PVOID *ctx) {
+    in_init();
+    return TRUE;
+}
+#define strict_in_once() InitOnceExecuteOnce(&InOnce, in_init_once, NULL, NULL)
+#define strict_read(buf, size) _read(0, (buf), (unsigned)(size))
+#else
+static pthread_once_t InOnce = PTHREAD_ONCE_INIT;
+#define strict_in_once() pthread_once(&InOnce, in_init)
+#define strict_read(buf, size) read(0, (buf), (size))
+#endif
+
+static void in_start(void) {
+    In.started = 1;
+#ifndef _WIN32
+    struct stat st;
+    off_t at = lseek(0, 0, SEEK_CUR);
+    if (at >= 0 && fstat(0, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > at) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, 0, 0);
+        if (map != MAP_FAILED) {
+            In.cur = (const unsigned char*)map + at;
+            In.end = (const unsigned char*)map + st.st_size;
+            In.done = 1;
+            return;
+        }
+    }
+#endif
+    In.buffer = (unsigned char*)malloc(IN_BUFFER);
+    In.cur = In.end = In.buffer;
+    if (!In.buffer) In.done = 1;
+}
+
+// Moves the unparsed tail to the front and reads more after it; 0 once
+// there is nothing more to read
+static int in_fill(void) {
+    if (!In.started) {
+        in_start();
+        if (!In.buffer) return In.end > In.cur;   // mapped
+    }
+    if (In.done) return 0;
+    size_t kept = (size_t)(In.end - In.cur);
+    memmove(In.buffer, In.cur, kept);
+    In.cur = In.buffer;
+    In.end = In.buffer + kept;
+    // One read: at a terminal it returns the line typed so far
+    long got = (long)strict_read((void*)In.end, (size_t)(In.buffer + IN_BUFFER - In.end));
+    if (got <= 0) {
+        In.done = 1;
+        return 0;
+    }
+    In.end += got;
+    return 1;
+}
+
+// Length of the run of ASCII digits at p, at most n
+static size_t digit_run(const unsigned char *p, size_t n) {
+    size_t i = 0;
+#ifdef STRICT_X86_SIMD
+    __m128i zero = _mm_set1_epi8('0'), nine = _mm_set1_epi8(9);
+    for (; i + 16 <= n; i += 16) {
+        __m128i d = _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(p + i)), zero);
+        unsigned digits = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, nine), d));
+        if (digits != 0xffff) return i + (size_t)lowest_bit(~digits & 0xffff);
+    }
+#endif
+    while (i < n && (unsigned)(p[i] - '0') < 10) i++;
+    return i;
+}
+
+// Appends the n digits at p to v, wrapping like int arithmetic
+static unsigned digits_value(unsigned v, const unsigned char *p, size_t n) {
+#ifdef STRICT_X86_SIMD
+    // Eight digits in one little-endian word: pairs, then quads, then all
+    for (; n >= 8; p += 8, n -= 8) {
+        unsigned long long w;
+        memcpy(&w, p, 8);
+        w -= 0x3030303030303030ULL;
+        w = w * 10 + (w >> 8);
+        w = ((w & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) +
+             ((w >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+        v = v * 100000000u + (unsigned)w;
+    }
+#endif
+    for (; n; p++, n--) v = v * 10 + (unsigned)(*p - '0');
+    return v;
+}
+
+// Next integer into *value; 0 at end of input. Callers hold InLock.
+static int in_next(int *value) {
+    for (;;) {
+        while (In.cur < In.end && *In.cur <= ' ') In.cur++;
+        if (In.cur < In.end) break;
+        if (!in_fill()) return 0;
+    }
+    int negative = 0;
+    if ((*In.cur == '-' || *In.cur == '+') && In.end - In.cur == 1) in_fill();
+    if ((*In.cur == '-' || *In.cur == '+') && In.end - In.cur > 1 &&
+        (unsigned)(In.cur[1] - '0') < 10) {
+        negative = *In.cur == '-';
+        In.cur++;
+    }
+    if ((unsigned)(*In.cur - '0') >= 10) {
+        // Not a number: skip the word
+        do {
+            while (In.cur < In.end && *In.cur > ' ') In.cur++;
+        } while (In.cur == In.end && in_fill());
+        *value = 0;
+        return 1;
+    }
+    unsigned v = 0;
+    for (;;) {
+        size_t avail = (size_t)(In.end - In.cur);
+        size_t n = digit_run(In.cur, avail);
+        v = digits_value(v, In.cur, n);
+        In.cur += n;
+        if (n < avail || !in_fill()) break;   // the run may go on past the buffer
+    }
+    *value = (int)(negative ? 0u - v : v);
+    return 1;
+}
+
+// Input integer
+int strict_input() {
+    strict_flush();
+    strict_in_once();
+    strict_lock(&InLock);
+    int v;
+    if (!in_next(&v)) v = 0;
+    strict_unlock(&InLock);
+    return v;
+}
+
+// Reads up to the array's length of integers, in order; returns how many
+// were read before input ran out (the rest of the array is left as is)
+int __input_bulk(StrictArray *arr) {
+    strict_flush();
+    strict_in_once();
+    strict_lock(&InLock);
+    size_t count = 0;
+    while (count < arr->length && in_next(&arr->data[count])) count++;
+    strict_unlock(&InLock);
+    return (int)count;
+}
+
 // === Match Helpers ===
 
 int __match_int(int value, int pattern) {
@@ -103,3 +563,1229 @@ int __match_lt(int value, int limit) {
 int __match_gt(int value, int limit) {
     return value > limit;
 }
+
+// === Task Pool ===
+// A work-stealing pool shared by everything the runtime runs in parallel.
+// Every worker owns a deque of tasks: it pushes and pops at the back, so
+// it keeps working on the data it just touched, while idle workers steal
+// from the front, where the oldest (and, for split ranges, largest) tasks
+// sit. The thread that starts parallel work takes part as worker 0 and
+// runs or steals tasks until its work is done, sleeping only while none
+// are queued, so nested parallel work never deadlocks. Sized by STRICT_THREADS, else one
+// worker per core.
+
+typedef struct {
+    void (*run)(void *ctx, long long lo, long long hi);
+    void *ctx;
+    long long lo, hi;
+} StrictTask;
+
+typedef struct {
+    strict_mutex lock;
+    StrictTask *ring;
+    size_t head, count, capacity;
+} StrictDeque;
+
+static struct {
+    int workers;            // 0 until first use
+    StrictDeque *deques;
+    strict_thread *threads;
+    strict_mutex sleepLock;
+    strict_cond wake;       // new tasks or shutdown
+    strict_cond done;       // new tasks or some join's counter reached zero
+    long long queued;       // tasks sitting in some deque
+    int stopping;
+} Pool;
+
+static strict_mutex PoolInitLock;
+static STRICT_THREAD_LOCAL int CurrentWorker = 0;   // outside threads act as worker 0
+
+static void deque_push(StrictDeque *d, StrictTask task) {
+    strict_lock(&d->lock);
+    if (d->count == d->capacity) {
+        size_t capacity = d->capacity ? d->capacity * 2 : 64;
+        StrictTask *ring = (StrictTask*)malloc(capacity * sizeof(StrictTask));
+        for (size_t i = 0; i < d->count; i++) ring[i] = d->ring[(d->head + i) % d->capacity];
+        free(d->ring);
+        d->ring = ring;
+        d->head = 0;
+        d->capacity = capacity;
+    }
+    d->ring[(d->head + d->count++) % d->capacity] = task;
+    strict_unlock(&d->lock);
+}
+
+static int deque_pop_back(StrictDeque *d, StrictTask *task) {
+    int found = 0;
+    strict_lock(&d->lock);
+    if (d->count) {
+        *task = d->ring[(d->head + --d->count) % d->capacity];
+        found = 1;
+    }
+    strict_unlock(&d->lock);
+    return found;
+}
+
+static int deque_pop_front(StrictDeque *d, StrictTask *task) {
+    int found = 0;
+    strict_lock(&d->lock);
+    if (d->count) {
+        *task = d->ring[d->head];
+        d->head = (d->head + 1) % d->capacity;
+        d->count--;
+        found = 1;
+    }
+    strict_unlock(&d->lock);
+    return found;
+}
+
+static void pool_push(StrictTask task) {
+    deque_push(&Pool.deques[CurrentWorker], task);
+    // Taking the lock orders this against a worker about to sleep
+    strict_lock(&Pool.sleepLock);
+    strict_fetch_add(&Pool.queued, 1);
+    strict_cond_broadcast(&Pool.wake);
+    strict_cond_broadcast(&Pool.done);
+    strict_unlock(&Pool.sleepLock);
+}
+
+// Own deque from the back, then the others' from the front
+static int pool_take(int self, StrictTask *task) {
+    if (deque_pop_back(&Pool.deques[self], task)) goto taken;
+    for (int i = 1; i < Pool.workers; i++)
+        if (deque_pop_front(&Pool.deques[(self + i) % Pool.workers], task)) goto taken;
+    return 0;
+taken:
+    strict_fetch_add(&Pool.queued, -1);
+    return 1;
+}
+
+enum { POOL_SPIN = 64 };        // idle polls before a join goes to sleep
+
+// Wakes the joins sleeping in pool_help_until_zero; called by whoever
+// brings a counter to zero
+static void pool_notify_done(void) {
+    // Taking the lock orders this against a join about to sleep
+    strict_lock(&Pool.sleepLock);
+    strict_cond_broadcast(&Pool.done);
+    strict_unlock(&Pool.sleepLock);
+}
+
+// Runs tasks until *pending drops to zero, and sleeps while there have
+// been none for a while; the join of all parallel work. Nothing is queued
+// then, so the rest of the work is running on other threads: the join
+// leaves them the core and wakes when they finish or queue more.
+static void pool_help_until_zero(long long *pending) {
+    StrictTask task;
+    int idle = 0;
+    while (strict_load(pending) > 0) {
+        if (pool_take(CurrentWorker, &task)) {
+            task.run(task.ctx, task.lo, task.hi);
+            idle = 0;
+        } else if (++idle < POOL_SPIN) {
+            strict_yield();
+        } else {
+            strict_lock(&Pool.sleepLock);
+            while (strict_load(pending) > 0 && strict_load(&Pool.queued) == 0)
+                strict_cond_wait(&Pool.done, &Pool.sleepLock);
+            strict_unlock(&Pool.sleepLock);
+            idle = 0;
+        }
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI pool_worker(LPVOID arg)
+#else
+static void *pool_worker(void *arg)
+#endif
+{
+    CurrentWorker = (int)(size_t)arg;
+    StrictTask task;
+    for (;;) {
+        if (pool_take(CurrentWorker, &task)) {
+            task.run(task.ctx, task.lo, task.hi);
+            strict_flush();
+            continue;
+        }
+        strict_lock(&Pool.sleepLock);
+        while (!Pool.stopping && strict_load(&Pool.queued) == 0)
+            strict_cond_wait(&Pool.wake, &Pool.sleepLock);
+        int stop = Pool.stopping && strict_load(&Pool.queued) == 0;
+        strict_unlock(&Pool.sleepLock);
+        if (stop) {
+            out_release();
+            return 0;
+        }
+    }
+}
+
+static int default_workers(void) {
+    const char *env = getenv("STRICT_THREADS");
+    if (env && atoi(env) > 0) return atoi(env);
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+#endif
+}
+
+static void pool_start(int workers) {
+    Pool.deques = (StrictDeque*)calloc((size_t)workers, sizeof(StrictDeque));
+    Pool.threads = (strict_thread*)calloc((size_t)workers, sizeof(strict_thread));
+    for (int i = 0; i < workers; i++) strict_mutex_init(&Pool.deques[i].lock);
+    Pool.queued = 0;
+    Pool.stopping = 0;
+    Pool.workers = workers;
+    for (int i = 1; i < workers; i++) {
+#ifdef _WIN32
+        Pool.threads[i] = CreateThread(NULL, 0, pool_worker, (LPVOID)(size_t)i, 0, NULL);
+#else
+        pthread_create(&Pool.threads[i], NULL, pool_worker, (void*)(size_t)i);
+#endif
+    }
+}
+
+static void pool_stop(void) {
+    strict_lock(&Pool.sleepLock);
+    Pool.stopping = 1;
+    strict_cond_broadcast(&Pool.wake);
+    strict_unlock(&Pool.sleepLock);
+    for (int i = 1; i < Pool.workers; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(Pool.threads[i], INFINITE);
+        CloseHandle(Pool.threads[i]);
+#else
+        pthread_join(Pool.threads[i], NULL);
+#endif
+    }
+    for (int i = 0; i < Pool.workers; i++) {
+        strict_mutex_destroy(&Pool.deques[i].lock);
+        free(Pool.deques[i].ring);
+    }
+    free(Pool.deques);
+    free(Pool.threads);
+    Pool.workers = 0;
+}
+
+#ifdef _WIN32
+static INIT_ONCE PoolOnce = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK pool_init_lock(PINIT_ONCE once, PVOID arg, PVOID *ctx) {
+    strict_mutex_init(&PoolInitLock);
+    strict_mutex_init(&Pool.sleepLock);
+    strict_cond_init(&Pool.wake);
+    strict_cond_init(&Pool.done);
+    return TRUE;
+}
+#define strict_pool_once() InitOnceExecuteOnce(&PoolOnce, pool_init_lock, NULL, NULL)
+#else
+static pthread_once_t PoolOnce = PTHREAD_ONCE_INIT;
+static void pool_init_lock(void) {
+    strict_mutex_init(&PoolInitLock);
+    strict_mutex_init(&Pool.sleepLock);
+    strict_cond_init(&Pool.wake);
+    strict_cond_init(&Pool.done);
+}
+#define strict_pool_once() pthread_once(&PoolOnce, pool_init_lock)
+#endif
+
+static void pool_ensure(void) {
+    strict_pool_once();
+    strict_lock(&PoolInitLock);
+    if (Pool.workers == 0) pool_start(default_workers());
+    strict_unlock(&PoolInitLock);
+}
+
+// Restarts the pool with `workers` threads (<= 0 restores the default).
+// Only valid while no parallel work is running; used by benchmarks to
+// measure scaling.
+void __parallel_set_threads(int workers) {
+    strict_pool_once();
+    strict_lock(&PoolInitLock);
+    if (Pool.workers > 0) pool_stop();
+    pool_start(workers > 0 ? workers : default_workers());
+    strict_unlock(&PoolInitLock);
+}
+
+// === Parallel For ===
+// `Parallel For i = a..b` calls __parallel_for(a, b, body, env), where
+// body(env, lo, hi) runs iterations lo..hi of the outlined loop. The range
+// is split lazily: whoever runs a chunk larger than the grain pushes its
+// upper half as a task and keeps the lower half, so a worker only splits
+// as deep as thieves actually take work, and a stolen half is split again
+// by its thief. The call returns once every iteration has run.
+
+typedef struct {
+    void (*body)(void *env, int lo, int hi);
+    void *env;
+    long long grain;
+    long long pending;      // iterations not yet run
+} StrictParallelLoop;
+
+static void parallel_range(void *ctx, long long lo, long long hi) {
+    StrictParallelLoop *loop = (StrictParallelLoop*)ctx;
+    while (hi - lo + 1 > loop->grain) {
+        long long mid = lo + (hi - lo) / 2;
+        StrictTask upper = {parallel_range, loop, mid + 1, hi};
+        pool_push(upper);
+        hi = mid;
+    }
+    loop->body(loop->env, (int)lo, (int)hi);
+    // `loop` lives in the joining frame: not touched once pending is zero
+    if (strict_fetch_add(&loop->pending, -(hi - lo + 1)) == hi - lo + 1)
+        pool_notify_done();
+}
+
+void __parallel_for(int start, int end, void (*body)(void *env, int lo, int hi), void *env) {
+    if (start > end) return;
+    long long count = (long long)end - start + 1;
+    pool_ensure();
+    strict_flush();
+    if (Pool.workers == 1 || count == 1) {
+        body(env, start, end);
+        return;
+    }
+    // About eight chunks per worker: enough slack to balance uneven
+    // iterations without paying a task per iteration
+    StrictParallelLoop loop = {body, env, count / (8LL * Pool.workers), count};
+    if (loop.grain < 1) loop.grain = 1;
+    parallel_range(&loop, start, end);
+    pool_help_until_zero(&loop.pending);
+}
+
+// === Futures ===
+// `Future Call f(x)` calls __future_spawn(thunk, frame, size): the frame
+// holds the result slot followed by the arguments, and is copied into a
+// task record, so the caller's copy may go out of scope. `Sync` calls
+// __future_sync, which returns the result and releases the record. A
+// Future nobody has started yet is claimed and run inline by its Sync
+// rather than waited for; one already running elsewhere is waited for by
+// running other tasks meanwhile, and once there are none for a while, by
+// sleeping until it finishes, so syncing a call blocked on I/O leaves the
+// core idle. With a single worker, spawning runs the call on the spot.
+//
+// Records come from per-thread free lists refilled a slab at a time, so
+// spawning allocates nothing in the steady state. A record is referenced
+// by its handle and by its pool task, and freed by whichever lets go
+// last. Each Future must be synced once.
+
+enum { FUTURE_DONE = 0, FUTURE_RUNNING = 1, FUTURE_PENDING = 2 };
+
+typedef struct StrictFuture StrictFuture;
+struct StrictFuture {
+    void (*run)(void *frame);
+    void *frame;                // inlineFrame, or malloc'd when larger
+    long long state;            // counts down to FUTURE_DONE
+    long long refs;
+    StrictFuture *next;         // free list
+    long long inlineFrame[6];   // result and up to 11 arguments
+};
+
+enum { FUTURE_SLAB = 64 };
+static STRICT_THREAD_LOCAL StrictFuture *FreeFutures = NULL;
+
+static StrictFuture *future_alloc(int size) {
+    if (!FreeFutures) {
+        StrictFuture *slab = (StrictFuture*)malloc(FUTURE_SLAB * sizeof(StrictFuture));
+        for (int i = 0; i < FUTURE_SLAB; i++) slab[i].next = i + 1 < FUTURE_SLAB ? &slab[i + 1] : NULL;
+        FreeFutures = slab;
+    }
+    StrictFuture *f = FreeFutures;
+    FreeFutures = f->next;
+    f->frame = (size_t)size <= sizeof(f->inlineFrame) ? (void*)f->inlineFrame : malloc((size_t)size);
+    return f;
+}
+
+static void future_release(StrictFuture *f) {
+    if (strict_fetch_add(&f->refs, -1) != 1) return;
+    if (f->frame != (void*)f->inlineFrame) free(f->frame);
+    f->next = FreeFutures;
+    FreeFutures = f;
+}
+
+// PENDING -> RUNNING is taken by exactly one of the pool task and Sync
+static void future_claim_and_run(StrictFuture *f) {
+    if (!strict_cas(&f->state, FUTURE_PENDING, FUTURE_RUNNING)) return;
+    f->run(f->frame);
+    strict_fetch_add(&f->state, -1);
+    pool_notify_done();
+}
+
+static void future_task(void *ctx, long long lo, long long hi) {
+    (void)lo;
+    (void)hi;
+    future_claim_and_run((StrictFuture*)ctx);
+    future_release((StrictFuture*)ctx);
+}
+
+StrictFuture* __future_spawn(void (*run)(void *frame), const void *frame, int size) {
+    pool_ensure();
+    strict_flush();
+    StrictFuture *f = future_alloc(size);
+    memcpy(f->frame, frame, (size_t)size);
+    f->run = run;
+    if (Pool.workers == 1) {
+        run(f->frame);
+        f->state = FUTURE_DONE;
+        f->refs = 1;
+        return f;
+    }
+    f->state = FUTURE_PENDING;
+    f->refs = 2;
+    StrictTask task = {future_task, f, 0, 0};
+    pool_push(task);
+    return f;
+}
+
+int __future_sync(StrictFuture *f) {
+    future_claim_and_run(f);
+    pool_help_until_zero(&f->state);   // state counts down to FUTURE_DONE
+    int result;
+    memcpy(&result, f->frame, sizeof(result));
+    future_release(f);
+    return result;
+}
+
+// === Bulk Operations ===
+// Whole-sequence primitives over Lists and Arrays, which share their
+// leading {data, count} fields. Each operation has a scalar, an SSE2 and
+// an AVX2 kernel; the first call picks the widest the CPU supports, or the
+// one named by STRICT_SIMD=scalar|sse2|avx2 if the CPU has it. Arithmetic
+// wraps around like the compiled code's.
+
+typedef struct {
+    int *data;
+    size_t count;
+} StrictSeq;
+
+typedef struct {
+    const char *name;
+    void (*fill)(int *d, size_t n, int v);
+    int (*sum)(const int *d, size_t n);
+    int (*min)(const int *d, size_t n);     // n > 0
+    int (*max)(const int *d, size_t n);     // n > 0
+    size_t (*find)(const int *d, size_t n, int v);  // n when absent
+    size_t (*count)(const int *d, size_t n, int v);
+    void (*add)(int *d, size_t n, int k);
+    void (*mul)(int *d, size_t n, int k);
+    int (*dot)(const int *a, const int *b, size_t n);
+} BulkKernels;
+
+// Scalar kernels; the SIMD ones finish their tails with these
+static void scalar_fill(int *d, size_t n, int v) {
+    for (size_t i = 0; i < n; i++) d[i] = v;
+}
+
+static int scalar_sum(const int *d, size_t n) {
+    unsigned s = 0;
+    for (size_t i = 0; i < n; i++) s += (unsigned)d[i];
+    return (int)s;
+}
+
+static int scalar_min(const int *d, size_t n) {
+    int m = d[0];
+    for (size_t i = 1; i < n; i++) m = d[i] < m ? d[i] : m;
+    return m;
+}
+
+static int scalar_max(const int *d, size_t n) {
+    int m = d[0];
+    for (size_t i = 1; i < n; i++) m = d[i] > m ? d[i] : m;
+    return m;
+}
+
+static size_t scalar_find(const int *d, size_t n, int v) {
+    for (size_t i = 0; i < n; i++)
+        if (d[i] == v) return i;
+    return n;
+}
+
+static size_t scalar_count(const int *d, size_t n, int v) {
+    size_t c = 0;
+    for (size_t i = 0; i < n; i++) c += d[i] == v;
+    return c;
+}
+
+static void scalar_add(int *d, size_t n, int k) {
+    for (size_t i = 0; i < n; i++) d[i] = (int)((unsigned)d[i] + (unsigned)k);
+}
+
+static void scalar_mul(int *d, size_t n, int k) {
+    for (size_t i = 0; i < n; i++) d[i] = (int)((unsigned)d[i] * (unsigned)k);
+}
+
+static int scalar_dot(const int *a, const int *b, size_t n) {
+    unsigned s = 0;
+    for (size_t i = 0; i < n; i++) s += (unsigned)a[i] * (unsigned)b[i];
+    return (int)s;
+}
+
+static const BulkKernels ScalarKernels = {
+    "scalar", scalar_fill, scalar_sum, scalar_min, scalar_max,
+    scalar_find, scalar_count, scalar_add, scalar_mul, scalar_dot
+};
+
+#ifdef STRICT_X86_SIMD
+
+// --- SSE2 (4 lanes; baseline on x86-64) ---
+
+static int sse2_hsum(__m128i x) {
+    int lanes[4];
+    _mm_storeu_si128((__m128i*)lanes, x);
+    return scalar_sum(lanes, 4);
+}
+
+// SSE2 has neither pminsd/pmaxsd nor pmulld
+static __m128i sse2_select(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static __m128i sse2_mullo(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static void sse2_fill(int *d, size_t n, int v) {
+    __m128i x = _mm_set1_epi32(v);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(d + i), x);
+    scalar_fill(d + i, n - i, v);
+}
+
+static int sse2_sum(const int *d, size_t n) {
+    __m128i acc0 = _mm_setzero_si128(), acc1 = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_epi32(acc0, _mm_loadu_si128((const __m128i*)(d + i)));
+        acc1 = _mm_add_epi32(acc1, _mm_loadu_si128((const __m128i*)(d + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4) acc0 = _mm_add_epi32(acc0, _mm_loadu_si128((const __m128i*)(d + i)));
+    return (int)((unsigned)sse2_hsum(_mm_add_epi32(acc0, acc1)) + (unsigned)scalar_sum(d + i, n - i));
+}
+
+static int sse2_minmax(const int *d, size_t n, int wantMax) {
+    if (n < 4) return wantMax ? scalar_max(d, n) : scalar_min(d, n);
+    __m128i m = _mm_loadu_si128((const __m128i*)d);
+    size_t i = 4;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(d + i));
+        __m128i gt = _mm_cmpgt_epi32(x, m);
+        m = wantMax ? sse2_select(gt, x, m) : sse2_select(gt, m, x);
+    }
+    int lanes[8];
+    _mm_storeu_si128((__m128i*)lanes, m);
+    size_t k = 4;
+    for (; i < n; i++) lanes[k++] = d[i];   // at most 3 left
+    return wantMax ? scalar_max(lanes, k) : scalar_min(lanes, k);
+}
+
+static int sse2_min(const int *d, size_t n) { return sse2_minmax(d, n, 0); }
+static int sse2_max(const int *d, size_t n) { return sse2_minmax(d, n, 1); }
+
+static size_t sse2_find(const int *d, size_t n, int v) {
+    __m128i x = _mm_set1_epi32(v);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(d + i)), x);
+        unsigned mask = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (mask) return i + (size_t)lowest_bit(mask);
+    }
+    return i + scalar_find(d + i, n - i, v);
+}
+
+static size_t sse2_count(const int *d, size_t n, int v) {
+    __m128i x = _mm_set1_epi32(v), acc = _mm_setzero_si128();
+    size_t i = 0, c = 0;
+    while (i + 4 <= n) {
+        // Lanes count down by one per match; flushed before they can wrap
+        size_t stop = n - (n - i) % 4;
+        if (stop - i > ((size_t)1 << 32)) stop = i + ((size_t)1 << 32);
+        for (; i < stop; i += 4)
+            acc = _mm_add_epi32(acc, _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(d + i)), x));
+        int lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        for (int k = 0; k < 4; k++) c += (unsigned)-lanes[k];
+        acc = _mm_setzero_si128();
+    }
+    return c + scalar_count(d + i, n - i, v);
+}
+
+static void sse2_add(int *d, size_t n, int k) {
+    __m128i x = _mm_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128((__m128i*)(d + i), _mm_add_epi32(_mm_loadu_si128((const __m128i*)(d + i)), x));
+    scalar_add(d + i, n - i, k);
+}
+
+static void sse2_mul(int *d, size_t n, int k) {
+    __m128i x = _mm_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_si128((__m128i*)(d + i), sse2_mullo(_mm_loadu_si128((const __m128i*)(d + i)), x));
+    scalar_mul(d + i, n - i, k);
+}
+
+static int sse2_dot(const int *a, const int *b, size_t n) {
+    __m128i acc = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_add_epi32(acc, sse2_mullo(_mm_loadu_si128((const __m128i*)(a + i)),
+                                            _mm_loadu_si128((const __m128i*)(b + i))));
+    return (int)((unsigned)sse2_hsum(acc) + (unsigned)scalar_dot(a + i, b + i, n - i));
+}
+
+static const BulkKernels Sse2Kernels = {
+    "sse2", sse2_fill, sse2_sum, sse2_min, sse2_max,
+    sse2_find, sse2_count, sse2_add, sse2_mul, sse2_dot
+};
+
+// --- AVX2 (8 lanes) ---
+
+STRICT_AVX2 static int avx2_hsum(__m256i x) {
+    __m128i s = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+    return sse2_hsum(s);
+}
+
+STRICT_AVX2 static void avx2_fill(int *d, size_t n, int v) {
+    __m256i x = _mm256_set1_epi32(v);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i*)(d + i), x);
+    scalar_fill(d + i, n - i, v);
+}
+
+STRICT_AVX2 static int avx2_sum(const int *d, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_epi32(acc0, _mm256_loadu_si256((const __m256i*)(d + i)));
+        acc1 = _mm256_add_epi32(acc1, _mm256_loadu_si256((const __m256i*)(d + i + 8)));
+    }
+    for (; i + 8 <= n; i += 8) acc0 = _mm256_add_epi32(acc0, _mm256_loadu_si256((const __m256i*)(d + i)));
+    return (int)((unsigned)avx2_hsum(_mm256_add_epi32(acc0, acc1)) + (unsigned)scalar_sum(d + i, n - i));
+}
+
+STRICT_AVX2 static int avx2_minmax(const int *d, size_t n, int wantMax) {
+    if (n < 8) return wantMax ? scalar_max(d, n) : scalar_min(d, n);
+    __m256i m = _mm256_loadu_si256((const __m256i*)d);
+    size_t i = 8;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(d + i));
+        m = wantMax ? _mm256_max_epi32(m, x) : _mm256_min_epi32(m, x);
+    }
+    int lanes[16];
+    _mm256_storeu_si256((__m256i*)lanes, m);
+    size_t k = 8;
+    for (; i < n; i++) lanes[k++] = d[i];   // at most 7 left
+    return wantMax ? scalar_max(lanes, k) : scalar_min(lanes, k);
+}
+
+STRICT_AVX2 static int avx2_min(const int *d, size_t n) { return avx2_minmax(d, n, 0); }
+STRICT_AVX2 static int avx2_max(const int *d, size_t n) { return avx2_minmax(d, n, 1); }
+
+STRICT_AVX2 static size_t avx2_find(const int *d, size_t n, int v) {
+    __m256i x = _mm256_set1_epi32(v);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(d + i)), x);
+        unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask) return i + (size_t)lowest_bit(mask);
+    }
+    return i + scalar_find(d + i, n - i, v);
+}
+
+STRICT_AVX2 static size_t avx2_count(const int *d, size_t n, int v) {
+    __m256i x = _mm256_set1_epi32(v), acc = _mm256_setzero_si256();
+    size_t i = 0, c = 0;
+    while (i + 8 <= n) {
+        size_t stop = n - (n - i) % 8;
+        if (stop - i > ((size_t)1 << 33)) stop = i + ((size_t)1 << 33);
+        for (; i < stop; i += 8)
+            acc = _mm256_add_epi32(acc, _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(d + i)), x));
+        int lanes[8];
+        _mm256_storeu_si256((__m256i*)lanes, acc);
+        for (int k = 0; k < 8; k++) c += (unsigned)-lanes[k];
+        acc = _mm256_setzero_si256();
+    }
+    return c + scalar_count(d + i, n - i, v);
+}
+
+STRICT_AVX2 static void avx2_add(int *d, size_t n, int k) {
+    __m256i x = _mm256_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_add_epi32(_mm256_loadu_si256((const __m256i*)(d + i)), x));
+    scalar_add(d + i, n - i, k);
+}
+
+STRICT_AVX2 static void avx2_mul(int *d, size_t n, int k) {
+    __m256i x = _mm256_set1_epi32(k);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_si256((__m256i*)(d + i), _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(d + i)), x));
+    scalar_mul(d + i, n - i, k);
+}
+
+STRICT_AVX2 static int avx2_dot(const int *a, const int *b, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(a + i)),
+                                                       _mm256_loadu_si256((const __m256i*)(b + i))));
+    return (int)((unsigned)avx2_hsum(acc) + (unsigned)scalar_dot(a + i, b + i, n - i));
+}
+
+static const BulkKernels Avx2Kernels = {
+    "avx2", avx2_fill, avx2_sum, avx2_min, avx2_max,
+    avx2_find, avx2_count, avx2_add, avx2_mul, avx2_dot
+};
+
+static int cpu_has_avx2(void) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    // AVX and OSXSAVE, with the OS saving YMM state
+    if ((info[2] & (3 << 27)) != (3 << 27) || (_xgetbv(0) & 6) != 6) return 0;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+static const BulkKernels *Kernels = &ScalarKernels;
+
+static void bulk_select(void) {
+    const char *want = getenv("STRICT_SIMD");
+    if (want && !strcmp(want, "scalar")) return;
+#ifdef STRICT_X86_SIMD
+    Kernels = &Sse2Kernels;
+    if ((!want || strcmp(want, "sse2") != 0) && cpu_has_avx2()) Kernels = &Avx2Kernels;
+#endif
+}
+
+#ifdef _WIN32
+static INIT_ONCE BulkOnce = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK bulk_select_once(PINIT_ONCE once, PVOID arg, PVOID *ctx) {
+    bulk_select();
+    return TRUE;
+}
+static const BulkKernels *bulk(void) {
+    InitOnceExecuteOnce(&BulkOnce, bulk_select_once, NULL, NULL);
+    return Kernels;
+}
+#else
+static pthread_once_t BulkOnce = PTHREAD_ONCE_INIT;
+static const BulkKernels *bulk(void) {
+    pthread_once(&BulkOnce, bulk_select);
+    return Kernels;
+}
+#endif
+
+// Name of the kernel set in use, for benchmarks
+const char *__bulk_isa(void) {
+    return bulk()->name;
+}
+
+void __bulk_fill(StrictSeq *s, int value) {
+    bulk()->fill(s->data, s->count, value);
+}
+
+// Copies as many elements as both hold
+void __bulk_copy(StrictSeq *dst, const StrictSeq *src) {
+    size_t n = dst->count < src->count ? dst->count : src->count;
+    memmove(dst->data, src->data, n * sizeof(int));
+}
+
+int __bulk_sum(const StrictSeq *s) {
+    return bulk()->sum(s->data, s->count);
+}
+
+// 0 for an empty sequence
+int __bulk_min(const StrictSeq *s) {
+    return s->count ? bulk()->min(s->data, s->count) : 0;
+}
+
+int __bulk_max(const StrictSeq *s) {
+    return s->count ? bulk()->max(s->data, s->count) : 0;
+}
+
+// Index of the first element equal to `value`, or -1
+int __bulk_find(const StrictSeq *s, int value) {
+    size_t i = bulk()->find(s->data, s->count, value);
+    return i < s->count ? (int)i : -1;
+}
+
+int __bulk_count(const StrictSeq *s, int value) {
+    return (int)bulk()->count(s->data, s->count, value);
+}
+
+void __bulk_add(StrictSeq *s, int k) {
+    bulk()->add(s->data, s->count, k);
+}
+
+void __bulk_mul(StrictSeq *s, int k) {
+    bulk()->mul(s->data, s->count, k);
+}
+
+// Over as many elements as both hold
+int __bulk_dot(const StrictSeq *a, const StrictSeq *b) {
+    size_t n = a->count < b->count ? a->count : b->count;
+    return bulk()->dot(a->data, b->data, n);
+}
+
+// === Profiling ===
+// `strictc --profile` brackets every Func, and main, with __prof_enter and
+// __prof_exit. Each thread records into a call tree of its own, timed
+// with the cycle counter (rdtsc), so threads never contend; the lock is
+// only taken when a thread starts profiling and at exit. Then the flat
+// profile goes to $STRICT_PROFILE.txt and the folded stacks (one
+// "main;Outer;Inner cycles" line per call path, what flamegraph.pl and
+// speedscope read) to $STRICT_PROFILE.folded; STRICT_PROFILE defaults to
+// strict-profile. Cycles are converted to time with a rate measured
+// between the first call and exit.
+
+typedef struct {
+    const char *key;                    // as passed in: compared by address
+    char *name;                         // a copy; JIT'd code may be gone at exit
+    unsigned parent, child, sibling;    // node indices; 0 is the thread's root
+    unsigned long long calls, cycles, self;
+} ProfNode;
+
+typedef struct {
+    unsigned node;
+    unsigned long long start, nested;   // nested: cycles in callees
+} ProfFrame;
+
+typedef struct ProfThread ProfThread;
+struct ProfThread {
+    ProfNode *nodes;
+    unsigned count, capacity, current;
+    ProfFrame *frames;
+    unsigned depth, frameCapacity;
+    ProfThread *next;
+};
+
+static STRICT_THREAD_LOCAL ProfThread *Prof = NULL;
+static ProfThread *AllProf = NULL;
+static strict_mutex ProfLock;
+static unsigned long long ProfStartCycles;
+static double ProfStartSeconds;
+
+static double prof_seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#ifdef STRICT_X86_SIMD
+#define prof_cycles() __rdtsc()
+#else
+static unsigned long long prof_cycles(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+#endif
+
+static void prof_dump(void);
+
+static void prof_init(void) {
+    strict_mutex_init(&ProfLock);
+    ProfStartSeconds = prof_seconds();
+    ProfStartCycles = prof_cycles();
+    atexit(prof_dump);
+}
+
+#ifdef _WIN32
+static INIT_ONCE ProfOnce = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK prof_init_once(PINIT_ONCE once, PVOID arg, PVOID *ctx) {
+    prof_init();
+    return TRUE;
+}
+#define strict_prof_once() InitOnceExecuteOnce(&ProfOnce, prof_init_once, NULL, NULL)
+#else
+static pthread_once_t ProfOnce = PTHREAD_ONCE_INIT;
+#define strict_prof_once() pthread_once(&ProfOnce, prof_init)
+#endif
+
+static ProfThread *prof_thread(void) {
+    strict_prof_once();
+    ProfThread *t = (ProfThread*)calloc(1, sizeof(ProfThread));
+    t->capacity = 64;
+    t->nodes = (ProfNode*)calloc(t->capacity, sizeof(ProfNode));
+    t->count = 1;                       // the root
+    t->frameCapacity = 64;
+    t->frames = (ProfFrame*)malloc(t->frameCapacity * sizeof(ProfFrame));
+    strict_lock(&ProfLock);
+    t->next = AllProf;
+    AllProf = t;
+    strict_unlock(&ProfLock);
+    return Prof = t;
+}
+
+static unsigned prof_node(ProfThread *t, unsigned parent, const char *name) {
+    if (t->count == t->capacity) {
+        t->capacity *= 2;
+        t->nodes = (ProfNode*)realloc(t->nodes, t->capacity * sizeof(ProfNode));
+    }
+    unsigned n = t->count++;
+    ProfNode *node = &t->nodes[n];
+    memset(node, 0, sizeof(*node));
+    node->key = name;
+    node->name = (char*)malloc(strlen(name) + 1);
+    strcpy(node->name, name);
+    node->parent = parent;
+    node->sibling = t->nodes[parent].child;
+    t->nodes[parent].child = n;
+    return n;
+}
+
+// `name` is the Func's name, a constant of the calling module
+void __prof_enter(const char *name) {
+    ProfThread *t = Prof ? Prof : prof_thread();
+    unsigned n = t->nodes[t->current].child;
+    while (n && t->nodes[n].key != name) n = t->nodes[n].sibling;
+    if (!n) n = prof_node(t, t->current, name);
+    t->nodes[n].calls++;
+    if (t->depth == t->frameCapacity) {
+        t->frameCapacity *= 2;
+        t->frames = (ProfFrame*)realloc(t->frames, t->frameCapacity * sizeof(ProfFrame));
+    }
+    ProfFrame *f = &t->frames[t->depth++];
+    f->node = n;
+    f->nested = 0;
+    t->current = n;
+    f->start = prof_cycles();
+}
+
+void __prof_exit(void) {
+    unsigned long long now = prof_cycles();
+    ProfThread *t = Prof;
+    if (!t || !t->depth) return;
+    ProfFrame *f = &t->frames[--t->depth];
+    unsigned long long elapsed = now - f->start;
+    ProfNode *node = &t->nodes[f->node];
+    node->cycles += elapsed;
+    node->self += elapsed - f->nested;
+    if (t->depth) t->frames[t->depth - 1].nested += elapsed;
+    t->current = node->parent;
+}
+
+// Per-function totals, merged across threads and modules by name
+typedef struct {
+    const char *name;
+    unsigned long long calls, self, total;
+} ProfEntry;
+
+static size_t prof_hash(const char *s) {
+    size_t h = 14695981039346656037ull & (size_t)-1;
+    for (; *s; s++) h = (h ^ (unsigned char)*s) * (size_t)1099511628211ull;
+    return h;
+}
+
+static int prof_by_self(const void *a, const void *b) {
+    unsigned long long x = ((const ProfEntry*)a)->self, y = ((const ProfEntry*)b)->self;
+    return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Does an ancestor of node n run the same function? (Then n's time is
+// already in that caller's total.)
+static int prof_recursive(const ProfThread *t, unsigned n) {
+    for (unsigned p = t->nodes[n].parent; p; p = t->nodes[p].parent)
+        if (t->nodes[p].key == t->nodes[n].key || !strcmp(t->nodes[p].name, t->nodes[n].name))
+            return 1;
+    return 0;
+}
+
+static void prof_folded(FILE *out, const ProfThread *t, unsigned n, char *path, size_t len, size_t cap) {
+    for (unsigned c = t->nodes[n].child; c; c = t->nodes[c].sibling) {
+        const ProfNode *node = &t->nodes[c];
+        size_t add = strlen(node->name) + (len ? 1 : 0);
+        if (len + add + 1 > cap) continue;      // absurdly deep: dropped
+        char *end = path + len;
+        if (len) *end++ = ';';
+        strcpy(end, node->name);
+        if (node->self) fprintf(out, "%s %llu\n", path, node->self);
+        prof_folded(out, t, c, path, len + add, cap);
+        path[len] = '\0';
+    }
+}
+
+static void prof_dump(void) {
+    double seconds = prof_seconds() - ProfStartSeconds;
+    double cyclesPerMs = seconds > 0 ? (double)(prof_cycles() - ProfStartCycles) / (seconds * 1e3) : 0;
+    const char *prefix = getenv("STRICT_PROFILE");
+    if (!prefix || !*prefix) prefix = "strict-profile";
+    size_t prefixLen = strlen(prefix);
+    char *file = (char*)malloc(prefixLen + 8);
+
+    strict_lock(&ProfLock);
+    size_t nodes = 0;
+    for (ProfThread *t = AllProf; t; t = t->next) nodes += t->count;
+    size_t slots = 16;
+    while (slots < nodes * 2) slots *= 2;
+    ProfEntry *table = (ProfEntry*)calloc(slots, sizeof(ProfEntry));
+    unsigned long long allSelf = 0;
+    for (ProfThread *t = AllProf; t; t = t->next) {
+        for (unsigned n = 1; n < t->count; n++) {
+            const ProfNode *node = &t->nodes[n];
+            size_t i = prof_hash(node->name) & (slots - 1);
+            while (table[i].name && strcmp(table[i].name, node->name)) i = (i + 1) & (slots - 1);
+            table[i].name = node->name;
+            table[i].calls += node->calls;
+            table[i].self += node->self;
+            if (!prof_recursive(t, n)) table[i].total += node->cycles;
+            allSelf += node->self;
+        }
+    }
+    size_t used = 0;
+    for (size_t i = 0; i < slots; i++)
+        if (table[i].name) table[used++] = table[i];
+    qsort(table, used, sizeof(ProfEntry), prof_by_self);
+
+    memcpy(file, prefix, prefixLen);
+    strcpy(file + prefixLen, ".txt");
+    FILE *flat = fopen(file, "w");
+    if (flat) {
+        double perMs = cyclesPerMs > 0 ? cyclesPerMs : 1;
+        fprintf(flat, "Flat profile: %.3f ms wall, %.0f cycles per ms\n\n", seconds * 1e3, cyclesPerMs);
+        fprintf(flat, " %%self     self(ms)    total(ms)          calls  name\n");
+        for (size_t i = 0; i < used; i++)
+            fprintf(flat, "%6.2f %12.3f %12.3f %14llu  %s\n",
+                    allSelf ? 100.0 * (double)table[i].self / (double)allSelf : 0.0,
+                    (double)table[i].self / perMs, (double)table[i].total / perMs,
+                    table[i].calls, table[i].name);
+        fclose(flat);
+    }
+
+    strcpy(file + prefixLen, ".folded");
+    FILE *folded = fopen(file, "w");
+    if (folded) {
+        size_t cap = 16 * 1024;
+        char *path = (char*)malloc(cap);
+        path[0] = '\0';
+        for (ProfThread *t = AllProf; t; t = t->next) prof_folded(folded, t, 0, path, 0, cap);
+        free(path);
+        fclose(folded);
+    }
+    strict_unlock(&ProfLock);
+    if (flat && folded) fprintf(stderr, "profile: %s.txt, %s.folded\n", prefix, prefix);
+    free(table);
+    free(file);
+}
+
+// === PGO ===
+// `strictc --pgo-gen` counts how often each function is entered and how
+// often each way out of its branches and Match switches is taken. A
+// function registers its counters on the first call, by name and branch
+// shape, so copies of it in several modules share them. At exit the counts
+// are added to those already in $STRICT_PGO_FILE (default profile.data),
+// so training runs accumulate; records of functions this run never entered
+// are kept as they were, and those of an older shape of one it did are
+// dropped. The counters are plain increments: a ParallelFor body racing
+// on them may lose a few, which only blurs the weights.
+
+typedef struct PgoFunc PgoFunc;
+struct PgoFunc {
+    char *name;
+    unsigned long long hash;
+    int count;
+    long long *counters;
+    PgoFunc *next;                      // in its bucket
+};
+
+#define PGO_BUCKETS 4096
+static PgoFunc *PgoTable[PGO_BUCKETS];
+static unsigned PgoCount = 0;
+static strict_mutex PgoLock;
+
+static void pgo_dump(void);
+
+static void pgo_init(void) {
+    strict_mutex_init(&PgoLock);
+    atexit(pgo_dump);
+}
+
+#ifdef _WIN32
+static INIT_ONCE PgoOnce = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK pgo_init_once(PINIT_ONCE once, PVOID arg, PVOID *ctx) {
+    pgo_init();
+    return TRUE;
+}
+#define strict_pgo_once() InitOnceExecuteOnce(&PgoOnce, pgo_init_once, NULL, NULL)
+#else
+static pthread_once_t PgoOnce = PTHREAD_ONCE_INIT;
+#define strict_pgo_once() pthread_once(&PgoOnce, pgo_init)
+#endif
+
+// The record for `name` (the first `len` bytes), preferring one of the
+// given shape; caller holds PgoLock
+static PgoFunc *pgo_find(const char *name, size_t len, unsigned long long hash) {
+    size_t h = 14695981039346656037ull & (size_t)-1;
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)name[i]) * (size_t)1099511628211ull;
+    PgoFunc *named = NULL;
+    for (PgoFunc *f = PgoTable[h & (PGO_BUCKETS - 1)]; f; f = f->next) {
+        if (strncmp(f->name, name, len) || f->name[len]) continue;
+        if (f->hash == hash) return f;
+        named = f;
+    }
+    return named;
+}
+
+// Called once per function and module, from its entry block; `name` is a
+// constant of the calling module and is copied (JIT'd code may be gone at
+// exit)
+long long *__pgo_register(const char *name, long long hash, int count) {
+    strict_pgo_once();
+    size_t len = strlen(name);
+    strict_lock(&PgoLock);
+    PgoFunc *f = pgo_find(name, len, (unsigned long long)hash);
+    if (!f || f->hash != (unsigned long long)hash || f->count != count) {
+        f = (PgoFunc*)calloc(1, sizeof(PgoFunc));
+        f->name = (char*)malloc(len + 1);
+        memcpy(f->name, name, len + 1);
+        f->hash = (unsigned long long)hash;
+        f->count = count;
+        f->counters = (long long*)calloc((size_t)count, sizeof(long long));
+        size_t bucket = prof_hash(name) & (PGO_BUCKETS - 1);
+        f->next = PgoTable[bucket];
+        PgoTable[bucket] = f;
+        PgoCount++;
+    }
+    strict_unlock(&PgoLock);
+    return f->counters;
+}
+
+static const char PgoHeader[] = "# strict-pgo 1\n";
+
+static char *pgo_read(const char *path) {
+    FILE *in = fopen(path, "rb");
+    if (!in) return NULL;
+    char *data = NULL;
+    if (fseek(in, 0, SEEK_END) == 0) {
+        long size = ftell(in);
+        rewind(in);
+        if (size >= 0) {
+            data = (char*)malloc((size_t)size + 1);
+            data[fread(data, 1, (size_t)size, in)] = '\0';
+        }
+    }
+    fclose(in);
+    return data;
+}
+
+static void pgo_dump(void) {
+    const char *path = getenv("STRICT_PGO_FILE");
+    if (!path || !*path) path = "profile.data";
+
+    strict_lock(&PgoLock);
+    char *old = pgo_read(path);
+    if (old && strncmp(old, PgoHeader, sizeof(PgoHeader) - 1)) {
+        fprintf(stderr, "pgo: %s is not a Strict profile; replacing it\n", path);
+        free(old);
+        old = NULL;
+    }
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        strict_unlock(&PgoLock);
+        fprintf(stderr, "pgo: cannot write %s\n", path);
+        free(old);
+        return;
+    }
+    fputs(PgoHeader, out);
+
+    // Earlier runs: merged into this one's counters, or kept
+    char *line = old ? old + sizeof(PgoHeader) - 1 : NULL;
+    while (line && *line) {
+        char *eol = strchr(line, '\n');
+        char *next = eol ? eol + 1 : NULL;
+        if (eol) *eol = '\0';
+        size_t len = strcspn(line, " ");
+        char *p = line + len;
+        unsigned long long hash = strtoull(p, &p, 16);
+        long count = strtol(p, &p, 10);
+        PgoFunc *f = len ? pgo_find(line, len, hash) : NULL;
+        if (f && f->hash == hash && f->count == count) {
+            for (int i = 0; i < f->count; i++) f->counters[i] += (long long)strtoull(p, &p, 10);
+        } else if (!f && len) {
+            fprintf(out, "%s\n", line);
+        }
+        line = next;
+    }
+
+    for (size_t b = 0; b < PGO_BUCKETS; b++) {
+        for (PgoFunc *f = PgoTable[b]; f; f = f->next) {
+            fprintf(out, "%s %llx %d", f->name, f->hash, f->count);
+            for (int i = 0; i < f->count; i++) fprintf(out, " %llu", (unsigned long long)f->counters[i]);
+            fputc('\n', out);
+        }
+    }
+    fclose(out);
+    strict_unlock(&PgoLock);
+    fprintf(stderr, "pgo: %u functions profiled into %s\n", PgoCount, path);
+    free(old);
+}
+
+// === Symbol Table ===
+// Every entry point compiled code may call, by name. `strictc --run` binds
+// a module's runtime declarations through it: strictc is not linked with
+// -rdynamic, so the JIT cannot find them by a process-wide search. A new
+// runtime function needs a line here.
+
+typedef struct {
+    const char *name;
+    void *address;
+} StrictRuntimeSymbol;
+
+const StrictRuntimeSymbol strict_runtime_symbols[] = {
+    {"strict_print", (void*)strict_print},
+    {"strict_print_str", (void*)strict_print_str},
+    {"strict_print_i32", (void*)strict_print_i32},
+    {"strict_input", (void*)strict_input},
+    {"__list_new", (void*)__list_new},
+    {"__list_append", (void*)__list_append},
+    {"__list_remove", (void*)__list_remove},
+    {"__list_free", (void*)__list_free},
+    {"__list_reserve", (void*)__list_reserve},
+    {"__list_extend", (void*)__list_extend},
+    {"__list_remove_at", (void*)__list_remove_at},
+    {"__list_swap_remove", (void*)__list_swap_remove},
+    {"__list_set", (void*)__list_set},
+    {"__list_get", (void*)__list_get},
+    {"__list_size", (void*)__list_size},
+    {"__array_new", (void*)__array_new},
+    {"__array_store", (void*)__array_store},
+    {"__array_load", (void*)__array_load},
+    {"__array_length", (void*)__array_length},
+    {"__match_int", (void*)__match_int},
+    {"__match_range", (void*)__match_range},
+    {"__match_lt", (void*)__match_lt},
+    {"__match_gt", (void*)__match_gt},
+    {"__parallel_for", (void*)__parallel_for},
+    {"__parallel_set_threads", (void*)__parallel_set_threads},
+    {"__bulk_fill", (void*)__bulk_fill},
+    {"__bulk_copy", (void*)__bulk_copy},
+    {"__bulk_sum", (void*)__bulk_sum},
+    {"__bulk_min", (void*)__bulk_min},
+    {"__bulk_max", (void*)__bulk_max},
+    {"__bulk_find", (void*)__bulk_find},
+    {"__bulk_count", (void*)__bulk_count},
+    {"__bulk_add", (void*)__bulk_add},
+    {"__bulk_mul", (void*)__bulk_mul},
+    {"__bulk_dot", (void*)__bulk_dot},
+    {"__input_bulk", (void*)__input_bulk},
+    {"__prof_enter", (void*)__prof_enter},
+    {"__prof_exit", (void*)__prof_exit},
+    {"__pgo_register", (void*)__pgo_register},
+    {"__future_spawn", (void*)__future_spawn},
+    {"__future_sync", (void*)__future_sync},
+    {NULL, NULL},
+};
@@ -0,0 +1,89 @@
+#include "source.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+SourceFile::SourceFile()
+    : data(""), length(0), fileHandle(INVALID_HANDLE_VALUE), mapHandle(nullptr) {}
+
+bool SourceFile::open(const std::string &path) {
+    close();
+    HANDLE f = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                           OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (f == INVALID_HANDLE_VALUE) return false;
+    if (GetFileType(f) != FILE_TYPE_DISK) { CloseHandle(f); return false; }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(f, &size)) { CloseHandle(f); return false; }
+    fileHandle = f;
+    if (size.QuadPart == 0) return true; // empty file: nothing to map
+
+    HANDLE m = CreateFileMappingA(f, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m) { close(); return false; }
+    mapHandle = m;
+    void *view = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    if (!view) { close(); return false; }
+
+    data = static_cast<const char*>(view);
+    length = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void SourceFile::close() {
+    if (length) UnmapViewOfFile(data);
+    if (mapHandle) CloseHandle(mapHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+    data = "";
+    length = 0;
+    mapHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+SourceFile::SourceFile() : data(""), length(0) {}
+
+bool SourceFile::open(const std::string &path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+    if (st.st_size == 0) { // empty file: nothing to map
+        ::close(fd);
+        return true;
+    }
+
+    void *view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // the mapping keeps its own reference
+    if (view == MAP_FAILED) return false;
+    madvise(view, st.st_size, MADV_SEQUENTIAL);
+
+    data = static_cast<const char*>(view);
+    length = static_cast<size_t>(st.st_size);
+    return true;
+}
+
+void SourceFile::close() {
+    if (length) munmap(const_cast<char*>(data), length);
+    data = "";
+    length = 0;
+}
+
+#endif
+
+SourceFile::~SourceFile() {
+    close();
+}
@@ -0,0 +1,172 @@
+#include "stats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+double wallClockMs() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+double processCPUMs() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0;
+    auto ms = [](const FILETIME &t) {
+        return double((uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 1e4;
+    };
+    return ms(kernel) + ms(user);
+#else
+    // Finished child processes (nasm, the linker) count too
+    struct rusage self, children;
+    if (getrusage(RUSAGE_SELF, &self) != 0 || getrusage(RUSAGE_CHILDREN, &children) != 0) return 0;
+    auto ms = [](const struct timeval &t) { return t.tv_sec * 1e3 + t.tv_usec / 1e3; };
+    return ms(self.ru_utime) + ms(self.ru_stime) + ms(children.ru_utime) + ms(children.ru_stime);
+#endif
+}
+
+size_t peakRSSKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return size_t(usage.ru_maxrss) / 1024;     // bytes there
+#else
+    return size_t(usage.ru_maxrss);
+#endif
+#endif
+}
+
+PhaseTimer::PhaseTimer(CompileStats &s, std::string phase)
+    : stats(s), name(std::move(phase)), wall0(wallClockMs()), cpu0(processCPUMs()), rss0(peakRSSKb()) {}
+
+void PhaseTimer::stop() {
+    PhaseStats phase;
+    phase.name = name;
+    phase.wallMs = wallClockMs() - wall0;
+    phase.cpuMs = processCPUMs() - cpu0;
+    phase.peakRSSKb = peakRSSKb();
+    phase.rssGrowthKb = phase.peakRSSKb - rss0;
+    stats.phases.push_back(phase);
+}
+
+void PassTimer::begin(const std::string &pass) {
+    stack.push_back({pass, wallClockMs(), 0});
+}
+
+void PassTimer::end() {
+    if (stack.empty()) return;
+    Running pass = stack.back();
+    stack.pop_back();
+    double elapsed = wallClockMs() - pass.start;
+    if (!stack.empty()) stack.back().nested += elapsed;
+    auto it = std::find_if(totals.begin(), totals.end(),
+                           [&](const PassStats &p) { return p.name == pass.name; });
+    if (it == totals.end()) it = totals.insert(totals.end(), PassStats{pass.name, 0, 0});
+    it->runs++;
+    it->wallMs += elapsed - pass.nested;
+}
+
+void PassTimer::report(std::vector<PassStats> &out) const {
+    for (const PassStats &p : totals) {
+        if (p.name.find("PassManager") != std::string::npos ||
+            p.name.find("PassAdaptor") != std::string::npos)
+            continue;
+        out.push_back(p);
+    }
+    std::stable_sort(out.begin(), out.end(),
+                     [](const PassStats &a, const PassStats &b) { return a.wallMs > b.wallMs; });
+}
+
+void printStatsTable(const CompileStats &stats, std::ostream &out) {
+    std::ios flags(nullptr);
+    flags.copyfmt(out);
+    out << std::fixed << std::setprecision(2);
+    out << "phase                  wall(ms)    cpu(ms)  peak RSS(KB)   +RSS(KB)\n";
+    double wall = 0, cpu = 0;
+    for (const PhaseStats &p : stats.phases) {
+        out << std::left << std::setw(18) << p.name << std::right << std::setw(13) << p.wallMs
+            << std::setw(11) << p.cpuMs << std::setw(14) << p.peakRSSKb << std::setw(11)
+            << p.rssGrowthKb << "\n";
+        wall += p.wallMs;
+        cpu += p.cpuMs;
+    }
+    out << std::left << std::setw(18) << "total" << std::right << std::setw(13) << wall
+        << std::setw(11) << cpu << std::setw(14) << peakRSSKb() << "\n";
+    out << "tokens: " << stats.tokens << ", AST nodes: " << stats.astNodes << " ("
+        << stats.astBytes << " bytes), functions: " << stats.functions
+        << ", IR instructions: " << stats.irBefore << " -> " << stats.irAfter << "\n";
+    if (!stats.passes.empty()) {
+        // Template instances (RequireAnalysisPass<...>) just run past the column
+        size_t width = 4;
+        for (const PassStats &p : stats.passes) width = std::max(width, std::min<size_t>(p.name.size(), 40));
+        out << std::left << std::setw(int(width)) << "pass" << std::right << "     runs   wall(ms)\n";
+        for (const PassStats &p : stats.passes)
+            out << std::left << std::setw(int(width) + 2) << p.name << std::right << std::setw(7) << p.runs
+                << std::setw(11) << p.wallMs << "\n";
+    }
+    out.copyfmt(flags);
+}
+
+// Pass and file names are the only strings; escape what JSON requires
+static void jsonString(std::ostream &out, const std::string &s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out << buf;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+void writeStatsJSON(const std::vector<const CompileStats*> &files, double wallMs, std::ostream &out) {
+    std::ios flags(nullptr);
+    flags.copyfmt(out);
+    out << std::fixed << std::setprecision(3);
+    out << "{\n  \"files\": [";
+    for (size_t f = 0; f < files.size(); f++) {
+        const CompileStats &s = *files[f];
+        out << (f ? ",\n" : "\n") << "    {\n      \"input\": ";
+        jsonString(out, s.input);
+        out << ",\n      \"phases\": [";
+        for (size_t i = 0; i < s.phases.size(); i++) {
+            const PhaseStats &p = s.phases[i];
+            out << (i ? ",\n" : "\n") << "        {\"name\": ";
+            jsonString(out, p.name);
+            out << ", \"wall_ms\": " << p.wallMs << ", \"cpu_ms\": " << p.cpuMs
+                << ", \"peak_rss_kb\": " << p.peakRSSKb << ", \"rss_growth_kb\": " << p.rssGrowthKb << "}";
+        }
+        out << "\n      ],\n      \"counts\": {\"tokens\": " << s.tokens << ", \"ast_nodes\": " << s.astNodes
+            << ", \"ast_bytes\": " << s.astBytes << ", \"functions\": " << s.functions
+            << ", \"ir_instructions_before\": " << s.irBefore << ", \"ir_instructions_after\": " << s.irAfter
+            << ", \"cache_hits\": " << s.cacheHits << ", \"cache_misses\": " << s.cacheMisses << "},\n";
+        out << "      \"passes\": [";
+        for (size_t i = 0; i < s.passes.size(); i++) {
+            const PassStats &p = s.passes[i];
+            out << (i ? ",\n" : "\n") << "        {\"name\": ";
+            jsonString(out, p.name);
+            out << ", \"runs\": " << p.runs << ", \"wall_ms\": " << p.wallMs << "}";
+        }
+        out << (s.passes.empty() ? "]\n" : "\n      ]\n") << "    }";
+    }
+    out << "\n  ],\n  \"wall_ms\": " << wallMs << ",\n  \"peak_rss_kb\": " << peakRSSKb() << "\n}\n";
+    out.copyfmt(flags);
+}
@@ -0,0 +1,94 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+
+namespace {
+// Index of the pool worker running on this thread, or -1 elsewhere
+thread_local int CurrentWorker = -1;
+thread_local const void *CurrentPool = nullptr;
+}
+
+WorkStealingPool::WorkStealingPool(unsigned count) {
+    if (count == 0) count = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 0; i < count; i++) queues.push_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < count; i++) threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &t : threads) t.join();
+}
+
+void WorkStealingPool::submit(Job job) {
+    bool inside = CurrentPool == this;
+    unsigned target = inside ? unsigned(CurrentWorker) : nextQueue.fetch_add(1) % size();
+    pending.fetch_add(1);
+    {
+        // Outside jobs go on the front, so each worker still starts them
+        // in submission order
+        std::lock_guard<std::mutex> guard(queues[target]->lock);
+        if (inside) {
+            queues[target]->jobs.push_back(std::move(job));
+        } else {
+            queues[target]->jobs.push_front(std::move(job));
+        }
+    }
+    {
+        // Taking the lock orders this against a worker about to sleep
+        std::lock_guard<std::mutex> guard(sleepLock);
+        queued.fetch_add(1);
+    }
+    wake.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> guard(sleepLock);
+    drained.wait(guard, [this] { return pending.load() == 0; });
+}
+
+// Own deque from the back, then the others' from the front
+bool WorkStealingPool::take(unsigned self, Job &job) {
+    {
+        Queue &own = *queues[self];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.jobs.empty()) {
+            job = std::move(own.jobs.back());
+            own.jobs.pop_back();
+            return true;
+        }
+    }
+    for (unsigned i = 1; i < size(); i++) {
+        Queue &victim = *queues[(self + i) % size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.jobs.empty()) {
+            job = std::move(victim.jobs.front());
+            victim.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned self) {
+    CurrentWorker = int(self);
+    CurrentPool = this;
+    for (;;) {
+        Job job;
+        if (take(self, job)) {
+            queued.fetch_sub(1);
+            job();
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> guard(sleepLock);
+                drained.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] { return stopping || queued.load() > 0; });
+        if (stopping && queued.load() == 0) return;
+    }
+}
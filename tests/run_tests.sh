@@ -1,29 +1,57 @@
 #!/bin/bash
 set -e
 
-# Location of compiler
-COMPILER=../build/strictc
+# Location of compiler (STRICTC overrides it; STRICTC_FLAGS are passed
+# to every compile, e.g. --backend=llvm where NASM is not installed)
+COMPILER=${STRICTC:-../build/strictc}
 
-# Directory setup
-EXAMPLES=../examples
-EXPECTED=./expected_outputs
-OUTDIR=./out
+# Directory setup. Sources are found next to this script; everything the
+# tests write goes under OUTDIR (STRICT_TEST_OUT overrides it).
+TESTS=$(cd "$(dirname "$0")" && pwd)
+EXAMPLES=$TESTS/../examples
+EXPECTED=$TESTS/expected_outputs
+OUTDIR=${STRICT_TEST_OUT:-./out}
 
 mkdir -p $OUTDIR
 
 echo "=== Running Strict Tests ==="
 
-# Test each .strict file
+# Test each .strict file that has an expected output, or an expected
+# compile error (.err: the compile must fail with each of its lines)
 for src in $EXAMPLES/*.strict; do
     base=$(basename $src .strict)
     exe=$OUTDIR/$base.exe
     out=$OUTDIR/$base.out
     expect=$EXPECTED/$base.txt
+    diag=$EXPECTED/$base.err
+
+    if [[ ! -f $expect && ! -f $diag ]]; then
+        continue
+    fi
 
     echo ">> Testing $base"
 
-    # Compile
-    $COMPILER $src -o $exe
+    # Compile a copy, so the .ll/.dgm/.o written next to the source stay
+    # out of the source tree
+    cp $src $OUTDIR/$base.strict
+
+    if [[ -f $diag ]]; then
+        if $COMPILER $OUTDIR/$base.strict $STRICTC_FLAGS -o $exe > $out 2>&1; then
+            echo "   FAIL (compiled, expected an error)"
+            exit 1
+        fi
+        while IFS= read -r line; do
+            if ! grep -qF -- "$line" $out; then
+                echo "   FAIL (missing diagnostic: $line)"
+                cat $out
+                exit 1
+            fi
+        done < $diag
+        echo "   PASS"
+        continue
+    fi
+
+    $COMPILER $OUTDIR/$base.strict $STRICTC_FLAGS -o $exe
 
     # Run program (with no input, or redirect as needed)
     if [[ -f $EXPECTED/$base.in ]]; then